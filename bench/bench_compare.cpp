@@ -4,6 +4,12 @@
  * Usage:
  *   bench_compare --library <name> --workload <name> --size <N>
  *   bench_compare --all
+ *   bench_compare ... --no-thp      (opt out of transparent huge pages)
+ *   bench_compare ... --cold        (also run each workload cache-cold)
+ *   bench_compare ... --tight-separators  (matryoshka variants keep
+ *                                          separators at leaf minima)
+ *   bench_compare --library <name> --workload soak --size <N>
+ *                 [--soak-churn F] [--soak-samples K] [--soak-insert-pct P]
  *
  * Outputs JSON lines to stdout (one per benchmark run).
  */
@@ -14,6 +20,10 @@
 #include <string>
 #include <vector>
 
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
 #include "wrappers.h"
 #include "workloads.h"
 
@@ -38,6 +48,7 @@ static const char *ALL_LIBRARIES[] = {
 static const char *ALL_WORKLOADS[] = {
     "seq_insert", "rand_insert", "rand_delete",
     "mixed", "ycsb_a", "ycsb_b", "search_after_churn",
+    "batch_insert", "batch_delete", "batch_mixed",
     nullptr
 };
 
@@ -81,11 +92,36 @@ static void dispatch_library(const std::string &lib,
     }
 }
 
+/* PR_SET_THP_DISABLE overrides the arena's MADV_HUGEPAGE for the whole
+   process, so one binary can be measured with and without THP. */
+static void disable_thp()
+{
+#if defined(__linux__) && defined(PR_SET_THP_DISABLE)
+    if (prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) != 0)
+        perror("prctl(PR_SET_THP_DISABLE)");
+#else
+    fprintf(stderr, "--no-thp: not supported on this platform\n");
+#endif
+}
+
 static void usage(const char *prog)
 {
     fprintf(stderr,
         "Usage: %s --library <name> --workload <name> --size <N>\n"
-        "       %s --all\n\n"
+        "       %s --all\n"
+        "Options:   --no-thp  disable transparent huge pages for this run\n"
+        "           --cold    run each workload warm, then with caches evicted\n"
+        "                     between timed batches (\"cache\":\"warm\"/\"cold\")\n"
+        "           --cold-batch K       ops timed between evictions (default 10000)\n"
+        "           --cold-bytes B       eviction buffer size (default 4 x LLC)\n"
+        "           --tight-separators   matryoshka trees raise a leaf's separator\n"
+        "                                when its minimum is deleted\n"
+        "           --batch-sizes B,B,...  batch workload chunk sizes\n"
+        "                                (default 16,256,4096,65536,1048576)\n"
+        "           --soak-churn F       soak churn ops = F x N (default 20)\n"
+        "           --soak-samples K     time-series points (default 20)\n"
+        "           --soak-insert-pct P  insert share of churn (default 50)\n"
+        "           --soak-queries Q     searches per point (default 1000000)\n\n"
         "Libraries: matryoshka, matryoshka_fence, matryoshka_eytz,\n"
         "           matryoshka_fence_sp, std_set"
 #ifdef HAS_ABSEIL
@@ -99,7 +135,9 @@ static void usage(const char *prog)
 #endif
         "\n"
         "Workloads: seq_insert, rand_insert, rand_delete, mixed,\n"
-        "           ycsb_a, ycsb_b, search_after_churn\n",
+        "           ycsb_a, ycsb_b, search_after_churn,\n"
+        "           batch_insert, batch_delete, batch_mixed,\n"
+        "           soak (time series; not included in --all)\n",
         prog, prog);
 }
 
@@ -119,6 +157,31 @@ int main(int argc, char **argv)
             workloads.push_back(argv[++i]);
         } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
             sizes.push_back((size_t)atol(argv[++i]));
+        } else if (strcmp(argv[i], "--batch-sizes") == 0 && i + 1 < argc) {
+            g_opts.batch_sizes.clear();
+            for (char *p = argv[++i]; *p; ) {
+                g_opts.batch_sizes.push_back((size_t)strtoul(p, &p, 10));
+                if (*p == ',') p++;
+                else break;
+            }
+        } else if (strcmp(argv[i], "--soak-churn") == 0 && i + 1 < argc) {
+            g_opts.soak_churn = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--soak-samples") == 0 && i + 1 < argc) {
+            g_opts.soak_samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--soak-insert-pct") == 0 && i + 1 < argc) {
+            g_opts.soak_insert_pct = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--soak-queries") == 0 && i + 1 < argc) {
+            g_opts.soak_queries = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--cold") == 0) {
+            g_opts.cold = true;
+        } else if (strcmp(argv[i], "--cold-batch") == 0 && i + 1 < argc) {
+            g_opts.cold_batch = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--cold-bytes") == 0 && i + 1 < argc) {
+            g_opts.cold_bytes = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--tight-separators") == 0) {
+            g_mt_tight_separators = true;
+        } else if (strcmp(argv[i], "--no-thp") == 0) {
+            disable_thp();
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             usage(argv[0]);
             return 0;
@@ -1,7 +1,13 @@
 /*
  * bench_matryoshka.c — Throughput benchmark for the matryoshka B+ tree.
+ *
+ * The runahead column repeats the search loop with a helper thread on
+ * the SMT sibling of the benchmark's CPU (matryoshka_runahead_start);
+ * it reads "-" where the CPU has no sibling.
  */
 
+#define _GNU_SOURCE
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -27,15 +33,25 @@ static uint32_t xorshift32(uint32_t *state)
 
 int main(void)
 {
-    int sizes[] = {1000, 10000, 100000, 1000000, 10000000};
+    /* The last size is several times a typical LLC. */
+    int sizes[] = {1000, 10000, 100000, 1000000, 10000000, 50000000};
     int nsizes = (int)(sizeof(sizes) / sizeof(sizes[0]));
     int nqueries = 5000000;
 
+    /* Stay on one CPU so the runahead helper keeps sharing its core. */
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
     printf("Matryoshka B+ tree benchmark\n");
-    printf("%-12s  %-12s  %-10s  %-10s\n",
-           "Size", "Build (ms)", "Mq/s", "ns/query");
-    printf("%-12s  %-12s  %-10s  %-10s\n",
-           "----", "----------", "----", "--------");
+    printf("%-12s  %-12s  %-10s  %-10s  %-10s  %-10s\n",
+           "Size", "Build (ms)", "Mq/s", "ns/query", "sampled", "runahead");
+    printf("%-12s  %-12s  %-10s  %-10s  %-10s  %-10s\n",
+           "----", "----------", "----", "--------", "-------", "--------");
 
     for (int si = 0; si < nsizes; si++) {
         int n = sizes[si];
@@ -73,8 +89,37 @@ int main(void)
         double mqs = nqueries / elapsed / 1e6;
         double ns_per = elapsed / nqueries * 1e9;
 
-        printf("%-12d  %-12.1f  %-10.2f  %-10.1f\n",
-               n, build_ms, mqs, ns_per);
+        /* Same queries with a runahead helper on the sibling CPU. */
+        char ns_run[16] = "-";
+        matryoshka_runahead_t *ra =
+            matryoshka_runahead_start(tree, queries, (size_t)nqueries, 0, -1);
+        if (ra) {
+            t0 = now_sec();
+            for (int i = 0; i < nqueries; i++) {
+                if (i % 8 == 0)
+                    matryoshka_runahead_advance(ra, (size_t)i);
+                int32_t r;
+                if (matryoshka_search(tree, queries[i], &r))
+                    sink = r;
+            }
+            snprintf(ns_run, sizeof(ns_run), "%.1f",
+                     (now_sec() - t0) / nqueries * 1e9);
+            matryoshka_runahead_advance(ra, (size_t)nqueries);
+            matryoshka_runahead_stop(ra);
+        }
+
+        /* Same queries with the access heatmap sampling 1 in 1024. */
+        matryoshka_heatmap_enable(tree, 1024);
+        t0 = now_sec();
+        for (int i = 0; i < nqueries; i++) {
+            int32_t r;
+            if (matryoshka_search(tree, queries[i], &r))
+                sink = r;
+        }
+        double ns_heat = (now_sec() - t0) / nqueries * 1e9;
+
+        printf("%-12d  %-12.1f  %-10.2f  %-10.1f  %-10.1f  %-10s\n",
+               n, build_ms, mqs, ns_per, ns_heat, ns_run);
 
         matryoshka_destroy(tree);
         free(keys);
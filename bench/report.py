@@ -9,6 +9,7 @@ generates matplotlib charts, and compiles a LaTeX PDF report.
 Usage:
     python3 bench/report.py [--build-dir build] [--output matryoshka_report.pdf]
                              [--no-perf] [--sizes 65536 1048576 4194304]
+                             [--sweep sweep.jsonl [--sweep-only]]
 
 Prerequisites:
     - The matryoshka library must be built (bench_compare in build_dir)
@@ -258,6 +259,105 @@ def run_all_benchmarks(bench_binary, libraries, workloads, sizes):
     return results
 
 
+# ── Configuration Sweep ──────────────────────────────────────────
+
+SWEEP_SIMD_ORDER = ["sse2", "avx2", "avx512"]
+
+
+def load_sweep(path):
+    """Load the merged JSON lines written by bench/sweep.py."""
+    records = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith("{"):
+                try:
+                    records.append(json.loads(line))
+                except json.JSONDecodeError:
+                    pass
+    return records
+
+
+def sweep_config_name(simd, thp):
+    return f"{simd}/{'thp' if thp else 'nothp'}"
+
+
+def compute_sensitivity(records):
+    """Tabulate Mop/s per (library, workload, n) across build configs.
+
+    Returns (configs, rows, summary).  Each row holds the Mop/s for every
+    config plus the best one; summary holds, per config, the geometric
+    mean of its throughput relative to the first config over all rows
+    where both were measured.
+    """
+    seen = {(r.get("simd"), bool(r.get("thp"))) for r in records}
+    configs = [(s, thp) for s in SWEEP_SIMD_ORDER for thp in (True, False)
+               if (s, thp) in seen]
+
+    cells = defaultdict(dict)
+    for r in records:
+        key = (r.get("library", ""), r.get("workload", ""), r.get("n", 0))
+        cells[key][(r.get("simd"), bool(r.get("thp")))] = r.get("mops", 0.0)
+
+    rows = []
+    for key in sorted(cells):
+        mops = cells[key]
+        best = max(mops, key=mops.get)
+        rows.append({
+            "library": key[0], "workload": key[1], "n": key[2],
+            "mops": [mops.get(c) for c in configs],
+            "best": sweep_config_name(*best),
+        })
+
+    summary = []
+    base = configs[0] if configs else None
+    for c in configs:
+        logs = [np.log(cells[k][c] / cells[k][base]) for k in cells
+                if cells[k].get(c) and cells[k].get(base)]
+        summary.append(float(np.exp(np.mean(logs))) if logs else None)
+
+    return configs, rows, summary
+
+
+def print_sensitivity_table(configs, rows, summary):
+    """Print the sensitivity table as plain text."""
+    names = [sweep_config_name(*c) for c in configs]
+    head = f"{'library':<20} {'workload':<19} {'N':>9}"
+    head += "".join(f" {n:>12}" for n in names) + "  best"
+    print(head)
+    print("-" * len(head))
+    for r in rows:
+        line = f"{r['library']:<20} {r['workload']:<19} {fmt_size(r['n']):>9}"
+        for m in r["mops"]:
+            line += f" {m:>12.2f}" if m is not None else f" {'-':>12}"
+        print(line + f"  {r['best']}")
+    print("-" * len(head))
+    line = f"{'geomean vs ' + names[0]:<50}" if names else ""
+    for g in summary:
+        line += f" {g:>11.3f}x" if g is not None else f" {'-':>12}"
+    print(line)
+
+
+def sensitivity_context(configs, rows, summary):
+    """LaTeX-escaped sensitivity table for the report template."""
+    return {
+        "configs": [tex_escape(sweep_config_name(*c)) for c in configs],
+        "colspec": "llr" + "r" * len(configs) + "l",
+        "rows": [
+            {
+                "library": tex_escape(r["library"]),
+                "workload": tex_escape(r["workload"]),
+                "n": fmt_size(r["n"]),
+                "mops": [f"{m:.2f}" if m is not None else "--"
+                         for m in r["mops"]],
+                "best": tex_escape(r["best"]),
+            }
+            for r in rows
+        ],
+        "summary": [f"{g:.3f}" if g is not None else "--" for g in summary],
+    }
+
+
 # ── Perf Stat (Hardware Counters) ─────────────────────────────────
 
 def have_perf():
@@ -975,7 +1075,7 @@ def _compute_analysis_vars(results, perf_data, profile_top, libraries, sizes):
 
 def generate_report(results, sys_info, libraries, sizes, output_path,
                     build_dir, perf_data=None, profile_top=None,
-                    cache_miss_top=None):
+                    cache_miss_top=None, sweep=None):
     """Orchestrate chart generation, LaTeX rendering, and PDF compilation."""
     if not results:
         print("No benchmark results to report.")
@@ -1078,6 +1178,9 @@ def generate_report(results, sys_info, libraries, sizes, output_path,
             "ns_per_op": f"{r.get('ns_per_op', 0):.1f}",
         })
 
+    # Configuration sweep sensitivity table (None hides the section)
+    context["sweep"] = sensitivity_context(*sweep) if sweep else None
+
     # Data-driven analysis variables
     analysis = _compute_analysis_vars(results, perf_data, profile_top,
                                       libraries, sizes)
@@ -1110,8 +1213,26 @@ def main():
     parser.add_argument(
         "--sizes", nargs="+", type=int, default=DEFAULT_SIZES,
         help="Tree sizes to test (default: %(default)s)")
+    parser.add_argument(
+        "--sweep", metavar="JSONL",
+        help="Merged output of bench/sweep.py; adds a sensitivity table")
+    parser.add_argument(
+        "--sweep-only", action="store_true",
+        help="Print the --sweep sensitivity table and exit")
     args = parser.parse_args()
 
+    sweep = None
+    if args.sweep:
+        sweep = compute_sensitivity(load_sweep(args.sweep))
+        if not sweep[1]:
+            print(f"Error: no sweep records in {args.sweep}.")
+            sys.exit(1)
+        print_sensitivity_table(*sweep)
+        if args.sweep_only:
+            return
+    elif args.sweep_only:
+        parser.error("--sweep-only requires --sweep")
+
     build_dir = Path(args.build_dir)
     bench_binary = ROOT / build_dir / "bench_compare"
 
@@ -1232,6 +1353,7 @@ def main():
         perf_data=perf_data,
         profile_top=profile_top,
         cache_miss_top=cache_miss_top,
+        sweep=sweep,
     )
 
     if ok:
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+Matryoshka configuration sweep.
+
+Builds one bench_compare per SIMD level (the MT_BENCH_SWEEP targets),
+runs each against every hierarchy wrapper with transparent huge pages
+on and off, and merges the JSON lines into one file tagged with
+"simd" and "thp".  The sensitivity table is then rendered by report.py.
+
+Usage:
+    python3 bench/sweep.py [--build-dir build-sweep] [--output sweep.jsonl]
+                           [--simd sse2 avx2 avx512] [--sizes 1048576]
+                           [--workloads rand_insert search_after_churn]
+                           [--no-build]
+
+A SIMD level the CPU cannot execute is skipped rather than run into
+SIGILL.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+from pathlib import Path
+
+
+# ── Configuration ─────────────────────────────────────────────────
+
+ROOT = Path(__file__).resolve().parent.parent
+
+SIMD_LEVELS = ["sse2", "avx2", "avx512"]
+HIERARCHIES = [
+    "matryoshka", "matryoshka_fence", "matryoshka_eytz", "matryoshka_fence_sp",
+]
+WORKLOADS = [
+    "seq_insert", "rand_insert", "rand_delete",
+    "mixed", "ycsb_a", "ycsb_b", "search_after_churn",
+]
+DEFAULT_SIZES = [1048576]
+
+# /proc/cpuinfo flags each SIMD level needs at run time.
+SIMD_CPU_FLAGS = {
+    "sse2":   ["sse2"],
+    "avx2":   ["avx2"],
+    "avx512": ["avx512f", "avx512bw"],
+}
+
+
+# ── Helpers ───────────────────────────────────────────────────────
+
+def cpu_flags():
+    """Return the set of CPU feature flags, or None if unknown."""
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("flags"):
+                    return set(line.split(":", 1)[1].split())
+    except OSError:
+        pass
+    return None
+
+
+def build_variants(build_dir, simd_levels):
+    """Configure with MT_BENCH_SWEEP=ON and build the requested variants."""
+    subprocess.run(
+        ["cmake", "-S", str(ROOT), "-B", str(build_dir),
+         "-DMT_BENCH_SWEEP=ON"],
+        check=True)
+    targets = [f"bench_compare_{s}" for s in simd_levels]
+    subprocess.run(
+        ["cmake", "--build", str(build_dir), "--target", *targets],
+        check=True)
+
+
+def run_variant(binary, library, workload, size, thp):
+    """Run one bench_compare invocation; return its parsed JSON records."""
+    cmd = [str(binary), "--library", library, "--workload", workload,
+           "--size", str(size)]
+    if not thp:
+        cmd.append("--no-thp")
+    try:
+        proc = subprocess.run(cmd, capture_output=True, text=True,
+                              timeout=600)
+    except (subprocess.TimeoutExpired, OSError):
+        return []
+    records = []
+    for line in proc.stdout.splitlines():
+        line = line.strip()
+        if line.startswith("{"):
+            try:
+                records.append(json.loads(line))
+            except json.JSONDecodeError:
+                pass
+    return records
+
+
+# ── Main ──────────────────────────────────────────────────────────
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Sweep SIMD level x hierarchy x THP for bench_compare")
+    parser.add_argument(
+        "--build-dir", default="build-sweep",
+        help="CMake build directory (default: build-sweep)")
+    parser.add_argument(
+        "--output", default="sweep.jsonl",
+        help="Merged JSON-lines output (default: sweep.jsonl)")
+    parser.add_argument(
+        "--simd", nargs="+", choices=SIMD_LEVELS, default=SIMD_LEVELS,
+        help="SIMD levels to sweep (default: all)")
+    parser.add_argument(
+        "--libraries", nargs="+", default=HIERARCHIES,
+        help="Hierarchy wrappers to sweep (default: %(default)s)")
+    parser.add_argument(
+        "--workloads", nargs="+", default=WORKLOADS,
+        help="Workloads to run (default: all)")
+    parser.add_argument(
+        "--sizes", nargs="+", type=int, default=DEFAULT_SIZES,
+        help="Tree sizes to test (default: %(default)s)")
+    parser.add_argument(
+        "--no-build", action="store_true",
+        help="Reuse the variants already in --build-dir")
+    args = parser.parse_args()
+
+    build_dir = Path(args.build_dir)
+    if not build_dir.is_absolute():
+        build_dir = ROOT / build_dir
+
+    flags = cpu_flags()
+    simd_levels = []
+    for s in args.simd:
+        if flags is not None and not all(f in flags for f in SIMD_CPU_FLAGS[s]):
+            print(f"Skipping {s}: not supported by this CPU.")
+            continue
+        simd_levels.append(s)
+    if not simd_levels:
+        print("Error: no runnable SIMD level selected.")
+        sys.exit(1)
+
+    if not args.no_build:
+        build_variants(build_dir, simd_levels)
+
+    configs = [(s, thp) for s in simd_levels for thp in (True, False)]
+    total = (len(configs) * len(args.libraries) * len(args.workloads)
+             * len(args.sizes))
+    done = 0
+    merged = []
+
+    for simd, thp in configs:
+        binary = build_dir / f"bench_compare_{simd}"
+        if not binary.exists():
+            print(f"Error: {binary} not found.")
+            sys.exit(1)
+        for lib in args.libraries:
+            for wl in args.workloads:
+                for sz in args.sizes:
+                    done += 1
+                    label = (f"{simd}/{'thp' if thp else 'nothp'} "
+                             f"{lib}/{wl} N={sz}")
+                    print(f"  [{done:3d}/{total}] {label}...", end="",
+                          flush=True)
+                    records = run_variant(binary, lib, wl, sz, thp)
+                    for r in records:
+                        r["simd"] = simd
+                        r["thp"] = thp
+                        merged.append(r)
+                    if records:
+                        print(f" {records[-1].get('mops', 0):.2f} Mop/s")
+                    else:
+                        print(" FAILED")
+
+    with open(args.output, "w") as f:
+        for r in merged:
+            f.write(json.dumps(r) + "\n")
+    print(f"\nWrote {len(merged)} records to {args.output}")
+    print(f"Render with: python3 bench/report.py --sweep {args.output} "
+          f"--sweep-only")
+
+
+if __name__ == "__main__":
+    main()
@@ -2,8 +2,10 @@
  * workloads.h -- Benchmark workload functions, templated on wrapper type.
  *
  * Each workload generates keys outside the timed section, then measures
- * the hot loop with clock_gettime(CLOCK_MONOTONIC).  A volatile sink
- * prevents dead-code elimination.
+ * the hot loop with clock_gettime(CLOCK_MONOTONIC) via time_ops().  A
+ * volatile sink prevents dead-code elimination.  With --cold every
+ * workload runs twice, warm and then with caches evicted between timed
+ * batches, and each JSON line carries "cache":"warm" or "cold".
  */
 
 #pragma once
@@ -13,10 +15,31 @@
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <memory>
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <numeric>
 
+#include <unistd.h>
+
+/* ── Options ────────────────────────────────────────────────── */
+
+/* Workload knobs, set from the bench_compare command line. */
+struct BenchOptions {
+    size_t soak_churn      = 20;       /* soak churn ops = soak_churn × N */
+    int    soak_samples    = 20;       /* time-series points per soak run */
+    int    soak_insert_pct = 50;       /* insert share of soak churn (%) */
+    size_t soak_queries    = 1000000;  /* searches per soak throughput point */
+    std::vector<size_t> batch_sizes = {16, 256, 4096, 65536, 1048576};
+    bool   cold            = false;    /* also run every workload cold */
+    size_t cold_batch      = 10000;    /* ops timed between evictions */
+    size_t cold_bytes      = 0;        /* eviction buffer; 0 = 4 × LLC */
+};
+
+static BenchOptions g_opts;
+static bool g_cold_pass;               /* current pass evicts caches */
+
 /* ── Timing ─────────────────────────────────────────────────── */
 
 static inline double now_sec()
@@ -26,6 +49,53 @@ static inline double now_sec()
     return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
+/* ── Cache eviction ─────────────────────────────────────────── */
+
+/* Write one byte per cache line of a buffer several times the LLC, so
+   the next timed batch starts with the tree (upper levels included)
+   out of every cache level, as when it competes with other data. */
+static inline void evict_caches()
+{
+    static std::unique_ptr<unsigned char[]> buf;
+    static size_t size;
+    if (!buf) {
+        size = g_opts.cold_bytes;
+        if (size == 0) {
+            long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+            size = (llc > 0 ? (size_t)llc : (size_t)32 << 20) * 4;
+        }
+        buf.reset(new unsigned char[size]());
+    }
+    for (size_t i = 0; i < size; i += 64)
+        buf[i]++;
+    __asm__ __volatile__("" ::: "memory");
+}
+
+/* Time ops calls of op(i), each performing `per` operations.  On the
+   cold pass, caches are evicted (untimed) before every cold_batch
+   operations and only the batches themselves are timed. */
+template<typename F>
+static inline double time_ops(size_t ops, F &&op, size_t per = 1)
+{
+    if (!g_cold_pass) {
+        double t0 = now_sec();
+        for (size_t i = 0; i < ops; i++)
+            op(i);
+        return now_sec() - t0;
+    }
+    size_t batch = std::max<size_t>(1, g_opts.cold_batch / per);
+    double elapsed = 0;
+    for (size_t i = 0; i < ops; ) {
+        size_t end = std::min(ops, i + batch);
+        evict_caches();
+        double t0 = now_sec();
+        for (; i < end; i++)
+            op(i);
+        elapsed += now_sec() - t0;
+    }
+    return elapsed;
+}
+
 /* ── PRNG (xorshift64) ──────────────────────────────────────── */
 
 struct Rng {
@@ -44,15 +114,26 @@ struct Rng {
 
 /* ── JSON output ────────────────────────────────────────────── */
 
+/* ",\"cache\":..." when --cold is on, so warm and cold lines pair up. */
+static inline const char *cache_tag()
+{
+    if (!g_opts.cold) return "";
+    return g_cold_pass ? ",\"cache\":\"cold\"" : ",\"cache\":\"warm\"";
+}
+
+/* `extra`, if given, is appended verbatim as further "key":value
+   members, e.g. "\"batch\":256". */
 static inline void emit_json(const char *library, const char *workload,
-                              size_t n, size_t ops, double elapsed)
+                              size_t n, size_t ops, double elapsed,
+                              const char *extra = nullptr)
 {
     double mops = (double)ops / elapsed / 1e6;
     double ns   = elapsed / (double)ops * 1e9;
     printf("{\"library\":\"%s\",\"workload\":\"%s\","
            "\"n\":%zu,\"ops\":%zu,"
-           "\"elapsed_sec\":%.6f,\"mops\":%.4f,\"ns_per_op\":%.2f}\n",
-           library, workload, n, ops, elapsed, mops, ns);
+           "\"elapsed_sec\":%.6f,\"mops\":%.4f,\"ns_per_op\":%.2f%s%s%s}\n",
+           library, workload, n, ops, elapsed, mops, ns,
+           extra ? "," : "", extra ? extra : "", cache_tag());
     fflush(stdout);
 }
 
@@ -93,10 +174,7 @@ void workload_seq_insert(size_t n)
     auto keys = make_sorted_keys(n);
     W w;
 
-    double t0 = now_sec();
-    for (size_t i = 0; i < n; i++)
-        w.insert(keys[i]);
-    double elapsed = now_sec() - t0;
+    double elapsed = time_ops(n, [&](size_t i) { w.insert(keys[i]); });
 
     emit_json(W::name(), "seq_insert", n, n, elapsed);
 }
@@ -110,10 +188,7 @@ void workload_rand_insert(size_t n)
     auto keys = make_shuffled_keys(n, 42);
     W w;
 
-    double t0 = now_sec();
-    for (size_t i = 0; i < n; i++)
-        w.insert(keys[i]);
-    double elapsed = now_sec() - t0;
+    double elapsed = time_ops(n, [&](size_t i) { w.insert(keys[i]); });
 
     emit_json(W::name(), "rand_insert", n, n, elapsed);
 }
@@ -130,10 +205,7 @@ void workload_rand_delete(size_t n)
     W w;
     w.bulk_load(sorted.data(), n);
 
-    double t0 = now_sec();
-    for (size_t i = 0; i < n; i++)
-        w.remove(shuffled[i]);
-    double elapsed = now_sec() - t0;
+    double elapsed = time_ops(n, [&](size_t i) { w.remove(shuffled[i]); });
 
     emit_json(W::name(), "rand_delete", n, n, elapsed);
 }
@@ -165,8 +237,7 @@ void workload_mixed(size_t n)
     size_t ops = n;
     volatile bool sink = false;
 
-    double t0 = now_sec();
-    for (size_t i = 0; i < ops; i++) {
+    double elapsed = time_ops(ops, [&](size_t i) {
         if (i % 2 == 0) {
             /* insert a new key */
             sink = w.insert(next_new);
@@ -177,8 +248,7 @@ void workload_mixed(size_t n)
                 sink = w.remove(existing[del_idx++]);
             }
         }
-    }
-    double elapsed = now_sec() - t0;
+    });
     (void)sink;
 
     emit_json(W::name(), "mixed", n, ops, elapsed);
@@ -196,8 +266,7 @@ void workload_ycsb_a(size_t n)
     size_t ops = n;
     volatile bool sink = false;
 
-    double t0 = now_sec();
-    for (size_t i = 0; i < ops; i++) {
+    double elapsed = time_ops(ops, [&](size_t) {
         if (rng.next() % 100 < 95) {
             w.insert(next_key);
             next_key += 2;
@@ -205,8 +274,7 @@ void workload_ycsb_a(size_t n)
             int32_t q = rng.next_in(0, next_key);
             sink = w.search(q);
         }
-    }
-    double elapsed = now_sec() - t0;
+    });
     (void)sink;
 
     emit_json(W::name(), "ycsb_a", n, ops, elapsed);
@@ -229,16 +297,14 @@ void workload_ycsb_b(size_t n)
     size_t ops = n;
     volatile bool sink = false;
 
-    double t0 = now_sec();
-    for (size_t i = 0; i < ops; i++) {
+    double elapsed = time_ops(ops, [&](size_t i) {
         if (i % 2 == 0 && del_idx < shuffled.size()) {
             sink = w.remove(shuffled[del_idx++]);
         } else {
             int32_t q = rng.next_in(0, (int32_t)(n * 2));
             sink = w.search(q);
         }
-    }
-    double elapsed = now_sec() - t0;
+    });
     (void)sink;
 
     emit_json(W::name(), "ycsb_b", n, ops, elapsed);
@@ -280,13 +346,199 @@ void workload_search_after_churn(size_t n)
     for (size_t i = 0; i < 100000 && i < nq; i++)
         sink = w.search(queries[i]);
 
-    double t0 = now_sec();
+    double elapsed = time_ops(nq, [&](size_t i) { sink = w.search(queries[i]); });
+    (void)sink;
+
+    emit_json(W::name(), "search_after_churn", n, nq, elapsed);
+}
+
+/*
+ * 8–10. Batch variants of insert, delete and mixed: the same key streams
+ *    as workloads 2–4, handed to insert_batch / remove_batch in chunks
+ *    of every size in g_opts.batch_sizes (sizes above N are skipped).
+ *    Each chunk is unsorted; sorting is part of the measured cost.
+ */
+static inline void emit_batch_json(const char *library, const char *workload,
+                                   size_t n, size_t ops, double elapsed,
+                                   size_t batch)
+{
+    char extra[32];
+    snprintf(extra, sizeof(extra), "\"batch\":%zu", batch);
+    emit_json(library, workload, n, ops, elapsed, extra);
+}
+
+template<typename W>
+void workload_batch_insert(size_t n)
+{
+    auto keys = make_shuffled_keys(n, 42);
+    for (size_t b : g_opts.batch_sizes) {
+        if (b == 0 || b > n) continue;
+        W w;
+
+        double elapsed = time_ops((n + b - 1) / b, [&](size_t c) {
+            w.insert_batch(&keys[c * b], std::min(b, n - c * b));
+        }, b);
+
+        emit_batch_json(W::name(), "batch_insert", n, n, elapsed, b);
+    }
+}
+
+template<typename W>
+void workload_batch_delete(size_t n)
+{
+    auto sorted = make_sorted_keys(n);
+    auto shuffled = make_shuffled_keys(n, 99);
+    for (size_t b : g_opts.batch_sizes) {
+        if (b == 0 || b > n) continue;
+        W w;
+        w.bulk_load(sorted.data(), n);
+
+        double elapsed = time_ops((n + b - 1) / b, [&](size_t c) {
+            w.remove_batch(&shuffled[c * b], std::min(b, n - c * b));
+        }, b);
+
+        emit_batch_json(W::name(), "batch_delete", n, n, elapsed, b);
+    }
+}
+
+/* Each chunk of b operations is b/2 new keys then b/2 deletes of
+   existing keys, matching workload 4's 50/50 mix. */
+template<typename W>
+void workload_batch_mixed(size_t n)
+{
+    auto keys = make_sorted_keys(n);
+    std::vector<int32_t> existing(keys);
+    Rng rng(77);
+    for (size_t i = existing.size() - 1; i > 0; i--) {
+        size_t j = rng.next() % (i + 1);
+        std::swap(existing[i], existing[j]);
+    }
+    std::vector<int32_t> fresh(n / 2 + 1);
+    for (size_t i = 0; i < fresh.size(); i++)
+        fresh[i] = (int32_t)((n + i) * 2 + 1);
+
+    for (size_t b : g_opts.batch_sizes) {
+        if (b < 2 || b > n) continue;
+        W w;
+        w.bulk_load(keys.data(), n);
+        size_t half = b / 2, ins = 0, del = 0;
+
+        double elapsed = time_ops((n + b - 1) / (2 * half), [&](size_t) {
+            if (ins + del >= n) return;
+            size_t k = std::min(half, fresh.size() - ins);
+            w.insert_batch(&fresh[ins], k);
+            ins += k;
+            k = std::min(half, n - ins - del);
+            w.remove_batch(&existing[del], k);
+            del += k;
+        }, 2 * half);
+
+        emit_batch_json(W::name(), "batch_mixed", n, ins + del, elapsed, b);
+    }
+}
+
+/*
+ * 11. Soak: bulk-load N keys, then soak_churn × N random inserts and
+ *    deletes (soak_insert_pct % inserts) over [0, 4N).  Every 1/samples
+ *    of the churn, emit one time-series point: search throughput, p99
+ *    search latency and, where the wrapper reports stats, bytes/key,
+ *    height and the page fill histogram.  A final "rebuilt" point
+ *    bulk-loads the surviving keys: the level compaction should recover.
+ *    Not part of --all; select it with --workload soak.
+ */
+template<typename W>
+static void soak_sample(W &w, Rng &rng, size_t n, const char *phase,
+                        size_t churn_ops, double churn_mops, size_t live)
+{
+    int32_t space = (int32_t)(n * 4);
+    size_t nq = g_opts.soak_queries;
+    std::vector<int32_t> queries(nq);
     for (size_t i = 0; i < nq; i++)
+        queries[i] = rng.next_in(0, space);
+
+    volatile bool sink = false;
+    double elapsed = time_ops(nq, [&](size_t i) { sink = w.search(queries[i]); });
+
+    /* Per-op latency on a subset; includes clock_gettime overhead. */
+    size_t nl = nq < 10000 ? nq : 10000;
+    std::vector<double> lat(nl);
+    for (size_t i = 0; i < nl; i++) {
+        double t = now_sec();
         sink = w.search(queries[i]);
-    double elapsed = now_sec() - t0;
+        lat[i] = (now_sec() - t) * 1e9;
+    }
     (void)sink;
+    double p99 = 0;
+    if (nl > 0) {
+        std::nth_element(lat.begin(), lat.begin() + nl * 99 / 100, lat.end());
+        p99 = lat[nl * 99 / 100];
+    }
 
-    emit_json(W::name(), "search_after_churn", n, nq, elapsed);
+    printf("{\"library\":\"%s\",\"workload\":\"soak\",\"phase\":\"%s\","
+           "\"n\":%zu,\"ops\":%zu,\"elapsed_sec\":%.6f,"
+           "\"mops\":%.4f,\"ns_per_op\":%.2f,\"p99_ns\":%.1f,"
+           "\"churn_ops\":%zu,\"churn_mops\":%.4f,\"live\":%zu%s",
+           W::name(), phase, n, nq, elapsed,
+           nq / elapsed / 1e6, elapsed / (double)nq * 1e9, p99,
+           churn_ops, churn_mops, live, cache_tag());
+
+    matryoshka_stats_t st;
+    if (w.stats(&st)) {
+        printf(",\"height\":%d,\"pages\":%zu,\"bytes_per_key\":%.2f,"
+               "\"fill\":[",
+               st.height, st.pages,
+               st.keys ? (double)st.node_bytes / (double)st.keys : 0.0);
+        for (int b = 0; b < MATRYOSHKA_FILL_BUCKETS; b++)
+            printf("%s%llu", b ? "," : "", (unsigned long long)st.fill[b]);
+        printf("]");
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+template<typename W>
+void workload_soak(size_t n)
+{
+    auto keys = make_sorted_keys(n);
+    W w;
+    w.bulk_load(keys.data(), n);
+
+    /* Live keys, for picking delete victims uniformly. */
+    std::vector<int32_t> live(keys);
+    Rng rng(123);
+    int32_t space = (int32_t)(n * 4);
+    size_t total = g_opts.soak_churn * n;
+    int samples = g_opts.soak_samples > 0 ? g_opts.soak_samples : 1;
+    size_t done = 0;
+
+    soak_sample(w, rng, n, "churn", 0, 0.0, live.size());
+    for (int s = 1; s <= samples; s++) {
+        size_t target = total * (size_t)s / (size_t)samples;
+        size_t start = done;
+        double t0 = now_sec();
+        for (; done < target; done++) {
+            if (live.empty() ||
+                (int)(rng.next() % 100) < g_opts.soak_insert_pct) {
+                /* Retry duplicates a few times to hold the mix. */
+                for (int tries = 0; tries < 8; tries++) {
+                    int32_t k = rng.next_in(0, space);
+                    if (w.insert(k)) { live.push_back(k); break; }
+                }
+            } else {
+                size_t j = rng.next() % live.size();
+                w.remove(live[j]);
+                live[j] = live.back();
+                live.pop_back();
+            }
+        }
+        double elapsed = now_sec() - t0;
+        double churn_mops = elapsed > 0 ? (done - start) / elapsed / 1e6 : 0;
+        soak_sample(w, rng, n, "churn", done, churn_mops, live.size());
+    }
+
+    std::sort(live.begin(), live.end());
+    w.bulk_load(live.data(), live.size());
+    soak_sample(w, rng, n, "rebuilt", done, 0.0, live.size());
 }
 
 /* ── Workload dispatch ──────────────────────────────────────── */
@@ -298,20 +550,36 @@ struct WorkloadEntry {
     workload_fn_t fn;
 };
 
+template<typename W>
+void run_workload(const std::string &wl, size_t n)
+{
+    if (wl == "seq_insert")          workload_seq_insert<W>(n);
+    else if (wl == "rand_insert")    workload_rand_insert<W>(n);
+    else if (wl == "rand_delete")    workload_rand_delete<W>(n);
+    else if (wl == "mixed")          workload_mixed<W>(n);
+    else if (wl == "ycsb_a")         workload_ycsb_a<W>(n);
+    else if (wl == "ycsb_b")         workload_ycsb_b<W>(n);
+    else if (wl == "search_after_churn") workload_search_after_churn<W>(n);
+    else if (wl == "batch_insert")   workload_batch_insert<W>(n);
+    else if (wl == "batch_delete")   workload_batch_delete<W>(n);
+    else if (wl == "batch_mixed")    workload_batch_mixed<W>(n);
+    else if (wl == "soak")           workload_soak<W>(n);
+    else fprintf(stderr, "Unknown workload: %s\n", wl.c_str());
+}
+
+/* With --cold, each workload runs a warm pass and then a cold pass. */
 template<typename W>
 void run_workloads(const std::vector<std::string> &workloads,
                    const std::vector<size_t> &sizes)
 {
     for (size_t n : sizes) {
         for (const auto &wl : workloads) {
-            if (wl == "seq_insert")          workload_seq_insert<W>(n);
-            else if (wl == "rand_insert")    workload_rand_insert<W>(n);
-            else if (wl == "rand_delete")    workload_rand_delete<W>(n);
-            else if (wl == "mixed")          workload_mixed<W>(n);
-            else if (wl == "ycsb_a")         workload_ycsb_a<W>(n);
-            else if (wl == "ycsb_b")         workload_ycsb_b<W>(n);
-            else if (wl == "search_after_churn") workload_search_after_churn<W>(n);
-            else fprintf(stderr, "Unknown workload: %s\n", wl.c_str());
+            g_cold_pass = false;
+            run_workload<W>(wl, n);
+            if (g_opts.cold) {
+                g_cold_pass = true;
+                run_workload<W>(wl, n);
+            }
         }
     }
 }
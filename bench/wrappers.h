@@ -2,8 +2,10 @@
  * wrappers.h -- Uniform wrapper classes for tree/map libraries.
  *
  * Each wrapper provides: insert, remove, search (predecessor),
- * contains, bulk_load, size, clear, name.  All inline for the
- * compiler to optimize the hot loop.
+ * contains, insert_batch / remove_batch (unsorted chunks; each
+ * library's best batch equivalent), bulk_load, size, clear, name, and
+ * stats (tree shape for the soak workload; false for non-matryoshka
+ * libraries).  All inline for the compiler to optimize the hot loop.
  */
 
 #pragma once
@@ -13,6 +15,7 @@
 #include <cstring>
 #include <string>
 #include <set>
+#include <vector>
 #include <algorithm>
 
 /* ── matryoshka (C API) ─────────────────────────────────────── */
@@ -20,13 +23,26 @@
 #include "matryoshka.h"
 #include "matryoshka_internal.h"
 
+/* Hierarchy options bench_compare applies to every matryoshka variant. */
+static bool g_mt_tight_separators = false;
+
+static inline void mt_bench_tune(mt_hierarchy_t *h)
+{
+    h->tight_separators = g_mt_tight_separators;
+}
+
 class WrapperMatryoshka {
     matryoshka_tree_t *tree_ = nullptr;
 public:
     static const char *name() { return "matryoshka"; }
     static const char *label() { return "Matryoshka B+ tree"; }
 
-    WrapperMatryoshka() { tree_ = matryoshka_create(); }
+    WrapperMatryoshka() {
+        mt_hierarchy_t h;
+        mt_hierarchy_init_default(&h);
+        mt_bench_tune(&h);
+        tree_ = matryoshka_create_with(&h);
+    }
     ~WrapperMatryoshka() { if (tree_) matryoshka_destroy(tree_); }
 
     WrapperMatryoshka(const WrapperMatryoshka &) = delete;
@@ -41,15 +57,25 @@ public:
     bool contains(int32_t key) const {
         return matryoshka_contains(tree_, key);
     }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return matryoshka_insert_batch(tree_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return matryoshka_delete_batch(tree_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         if (tree_) matryoshka_destroy(tree_);
-        tree_ = matryoshka_bulk_load(keys, n);
+        mt_hierarchy_t h;
+        mt_hierarchy_init_default(&h);
+        mt_bench_tune(&h);
+        tree_ = matryoshka_bulk_load_with(keys, n, &h);
     }
     size_t size() const { return matryoshka_size(tree_); }
-    void clear() {
-        if (tree_) matryoshka_destroy(tree_);
-        tree_ = matryoshka_create();
+    bool stats(matryoshka_stats_t *s) const {
+        matryoshka_stats(tree_, s);
+        return true;
     }
+    void clear() { matryoshka_clear(tree_, true); }
 };
 
 /* ── matryoshka + fence keys ────────────────────────────────── */
@@ -63,6 +89,7 @@ public:
     WrapperMatryoshkaFence() {
         mt_hierarchy_t h;
         mt_hierarchy_init_fence(&h);
+        mt_bench_tune(&h);
         tree_ = matryoshka_create_with(&h);
     }
     ~WrapperMatryoshkaFence() { if (tree_) matryoshka_destroy(tree_); }
@@ -79,19 +106,25 @@ public:
     bool contains(int32_t key) const {
         return matryoshka_contains(tree_, key);
     }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return matryoshka_insert_batch(tree_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return matryoshka_delete_batch(tree_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         if (tree_) matryoshka_destroy(tree_);
         mt_hierarchy_t h;
         mt_hierarchy_init_fence(&h);
+        mt_bench_tune(&h);
         tree_ = matryoshka_bulk_load_with(keys, n, &h);
     }
     size_t size() const { return matryoshka_size(tree_); }
-    void clear() {
-        if (tree_) matryoshka_destroy(tree_);
-        mt_hierarchy_t h;
-        mt_hierarchy_init_fence(&h);
-        tree_ = matryoshka_create_with(&h);
+    bool stats(matryoshka_stats_t *s) const {
+        matryoshka_stats(tree_, s);
+        return true;
     }
+    void clear() { matryoshka_clear(tree_, true); }
 };
 
 /* ── matryoshka + Eytzinger layout ─────────────────────────── */
@@ -105,6 +138,7 @@ public:
     WrapperMatryoshkaEytzinger() {
         mt_hierarchy_t h;
         mt_hierarchy_init_eytzinger(&h);
+        mt_bench_tune(&h);
         tree_ = matryoshka_create_with(&h);
     }
     ~WrapperMatryoshkaEytzinger() { if (tree_) matryoshka_destroy(tree_); }
@@ -121,19 +155,25 @@ public:
     bool contains(int32_t key) const {
         return matryoshka_contains(tree_, key);
     }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return matryoshka_insert_batch(tree_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return matryoshka_delete_batch(tree_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         if (tree_) matryoshka_destroy(tree_);
         mt_hierarchy_t h;
         mt_hierarchy_init_eytzinger(&h);
+        mt_bench_tune(&h);
         tree_ = matryoshka_bulk_load_with(keys, n, &h);
     }
     size_t size() const { return matryoshka_size(tree_); }
-    void clear() {
-        if (tree_) matryoshka_destroy(tree_);
-        mt_hierarchy_t h;
-        mt_hierarchy_init_eytzinger(&h);
-        tree_ = matryoshka_create_with(&h);
+    bool stats(matryoshka_stats_t *s) const {
+        matryoshka_stats(tree_, s);
+        return true;
     }
+    void clear() { matryoshka_clear(tree_, true); }
 };
 
 /* ── matryoshka + fence keys + superpages ───────────────────── */
@@ -147,6 +187,7 @@ public:
     WrapperMatryoshkaFenceSP() {
         mt_hierarchy_t h;
         mt_hierarchy_init_fence_sp(&h);
+        mt_bench_tune(&h);
         tree_ = matryoshka_create_with(&h);
     }
     ~WrapperMatryoshkaFenceSP() { if (tree_) matryoshka_destroy(tree_); }
@@ -163,25 +204,65 @@ public:
     bool contains(int32_t key) const {
         return matryoshka_contains(tree_, key);
     }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return matryoshka_insert_batch(tree_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return matryoshka_delete_batch(tree_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         if (tree_) matryoshka_destroy(tree_);
         mt_hierarchy_t h;
         mt_hierarchy_init_fence_sp(&h);
+        mt_bench_tune(&h);
         tree_ = matryoshka_bulk_load_with(keys, n, &h);
     }
     size_t size() const { return matryoshka_size(tree_); }
-    void clear() {
-        if (tree_) matryoshka_destroy(tree_);
-        mt_hierarchy_t h;
-        mt_hierarchy_init_fence_sp(&h);
-        tree_ = matryoshka_create_with(&h);
+    bool stats(matryoshka_stats_t *s) const {
+        matryoshka_stats(tree_, s);
+        return true;
     }
+    void clear() { matryoshka_clear(tree_, true); }
 };
 
+/* ── Ordered-set batch helpers ──────────────────────────────── */
+
+/* Batch equivalent for std::set-like containers: sort the chunk, then
+   insert each key with the position after the previous one as hint,
+   which is exact whenever no existing key falls in between. */
+template<typename Set>
+static inline size_t set_insert_batch(Set &set, std::vector<int32_t> &scratch,
+                                      const int32_t *keys, size_t n)
+{
+    scratch.assign(keys, keys + n);
+    std::sort(scratch.begin(), scratch.end());
+    size_t before = set.size();
+    auto hint = set.end();
+    for (int32_t k : scratch) {
+        hint = set.insert(hint, k);
+        ++hint;
+    }
+    return set.size() - before;
+}
+
+/* Deletes in key order, so consecutive erases touch adjacent nodes. */
+template<typename Set>
+static inline size_t set_remove_batch(Set &set, std::vector<int32_t> &scratch,
+                                      const int32_t *keys, size_t n)
+{
+    scratch.assign(keys, keys + n);
+    std::sort(scratch.begin(), scratch.end());
+    size_t removed = 0;
+    for (int32_t k : scratch)
+        removed += set.erase(k);
+    return removed;
+}
+
 /* ── std::set (red-black tree) ──────────────────────────────── */
 
 class WrapperStdSet {
     std::set<int32_t> set_;
+    std::vector<int32_t> scratch_;
 public:
     static const char *name() { return "std_set"; }
     static const char *label() { return "std::set (RB tree)"; }
@@ -193,11 +274,18 @@ public:
         return it != set_.begin();
     }
     bool contains(int32_t key) const { return set_.count(key) > 0; }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return set_insert_batch(set_, scratch_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return set_remove_batch(set_, scratch_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         set_.clear();
         set_.insert(keys, keys + n);
     }
     size_t size() const { return set_.size(); }
+    bool stats(matryoshka_stats_t *) const { return false; }
     void clear() { set_.clear(); }
 };
 
@@ -208,6 +296,7 @@ public:
 
 class WrapperAbseil {
     absl::btree_set<int32_t> set_;
+    std::vector<int32_t> scratch_;
 public:
     static const char *name() { return "abseil_btree"; }
     static const char *label() { return "Abseil btree_set"; }
@@ -219,11 +308,18 @@ public:
         return it != set_.begin();
     }
     bool contains(int32_t key) const { return set_.count(key) > 0; }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return set_insert_batch(set_, scratch_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return set_remove_batch(set_, scratch_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         set_.clear();
         set_.insert(keys, keys + n);
     }
     size_t size() const { return set_.size(); }
+    bool stats(matryoshka_stats_t *) const { return false; }
     void clear() { set_.clear(); }
 };
 #endif
@@ -235,6 +331,7 @@ public:
 
 class WrapperTlx {
     tlx::btree_set<int32_t> set_;
+    std::vector<int32_t> scratch_;
 public:
     static const char *name() { return "tlx_btree"; }
     static const char *label() { return "TLX btree_set"; }
@@ -246,11 +343,18 @@ public:
         return it != set_.begin();
     }
     bool contains(int32_t key) const { return set_.count(key) > 0; }
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        return set_insert_batch(set_, scratch_, keys, n);
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        return set_remove_batch(set_, scratch_, keys, n);
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         set_.clear();
         set_.insert(keys, keys + n);
     }
     size_t size() const { return set_.size(); }
+    bool stats(matryoshka_stats_t *) const { return false; }
     void clear() { set_.clear(); }
 };
 #endif
@@ -306,12 +410,24 @@ public:
         to_key(key, buf);
         return art_search(&tree_, buf, 4) != nullptr;
     }
+    /* No batch API: ART inserts are position-independent anyway. */
+    size_t insert_batch(const int32_t *keys, size_t n) {
+        size_t added = 0;
+        for (size_t i = 0; i < n; i++) added += insert(keys[i]);
+        return added;
+    }
+    size_t remove_batch(const int32_t *keys, size_t n) {
+        size_t removed = 0;
+        for (size_t i = 0; i < n; i++) removed += remove(keys[i]);
+        return removed;
+    }
     void bulk_load(const int32_t *keys, size_t n) {
         art_tree_destroy(&tree_);
         art_tree_init(&tree_);
         for (size_t i = 0; i < n; i++) insert(keys[i]);
     }
     size_t size() const { return art_size(const_cast<art_tree *>(&tree_)); }
+    bool stats(matryoshka_stats_t *) const { return false; }
     void clear() {
         art_tree_destroy(&tree_);
         art_tree_init(&tree_);
@@ -54,6 +54,14 @@ matryoshka_tree_t *matryoshka_bulk_load_with(const int32_t *sorted_keys,
 /* Destroy a tree and free all associated memory. */
 void matryoshka_destroy(matryoshka_tree_t *tree);
 
+/* Remove every key, leaving an empty tree with the same hierarchy.
+   With keep_memory, the leaf arenas stay mapped and are handed out
+   again by later inserts, so a reused scratch tree pays no mmap or page
+   faults; otherwise they are released as by matryoshka_destroy.
+   Returns false, with the tree untouched, if the new root page cannot
+   be allocated. */
+bool matryoshka_clear(matryoshka_tree_t *tree, bool keep_memory);
+
 /* ── Query ──────────────────────────────────────────────────── */
 
 /* Predecessor search: find the largest key <= query.
@@ -65,23 +73,114 @@ bool matryoshka_search(const matryoshka_tree_t *tree, int32_t key,
 /* Membership test. */
 bool matryoshka_contains(const matryoshka_tree_t *tree, int32_t key);
 
+/* Gap search: find the smallest key >= x that is NOT in the tree.
+   Writes it to *result and returns true; returns false only if every
+   key in [x, INT32_MAX] is present.  Dense pages and cache lines are
+   skipped by comparing key counts against key extents. */
+bool matryoshka_first_absent(const matryoshka_tree_t *tree, int32_t x,
+                              int32_t *result);
+
 /* Return the number of keys in the tree. */
 size_t matryoshka_size(const matryoshka_tree_t *tree);
 
+/* Page fill histogram: bucket b counts leaf pages holding between
+   b/10 and (b+1)/10 of page capacity (full pages land in the last). */
+#define MATRYOSHKA_FILL_BUCKETS 10
+
+/* Shape and memory footprint of a tree, for monitoring aging. */
+typedef struct matryoshka_stats {
+    size_t   keys;
+    int      height;          /* outer tree height (0 = root is a leaf) */
+    size_t   inodes;          /* outer internal nodes, 4 KiB each */
+    size_t   leaves;          /* outer leaves: pages, or superpages */
+    size_t   pages;           /* leaf pages, counting inside superpages */
+    size_t   cl_slots;        /* CL sub-nodes allocated across all pages */
+    size_t   node_bytes;      /* inodes + leaves at allocation size */
+    size_t   arena_bytes;     /* reserved by the leaf arena allocator */
+    uint64_t fill[MATRYOSHKA_FILL_BUCKETS];
+} matryoshka_stats_t;
+
+/* Walk the whole tree and fill *out.  O(number of nodes). */
+void matryoshka_stats(const matryoshka_tree_t *tree, matryoshka_stats_t *out);
+
+/* ── Pipelined lookup ───────────────────────────────────────── */
+
+/* Prefetch hint for a later search of `key`; never blocks on the
+   prefetched lines.  Walks `depth` outer levels from the root, reading
+   nodes the caller expects to be cached (say, hot upper levels), then
+   prefetches the node reached: an internal node's header line, or a
+   leaf's header and CL root line taken from the parent's tagged
+   pointer.  depth 0 prefetches the root; a negative depth walks to the
+   leaf. */
+void matryoshka_prefetch(const matryoshka_tree_t *tree, int32_t key,
+                          int depth);
+
+/* Resumable predecessor search, one node per step.  Each step searches
+   the node the previous step prefetched and prefetches the next one,
+   so a caller can interleave steps of several lookups with its own
+   work while the misses are in flight.  Superpage trees step through
+   the superpage's internal pages too.  The fields after `result` are
+   private.  The tree must not be modified while a lookup is live. */
+typedef struct matryoshka_lookup {
+    int32_t     key;
+    bool        done;
+    bool        found;         /* valid once done: as matryoshka_search */
+    int32_t     result;
+    const matryoshka_tree_t *tree;
+    const void *node;          /* node to search at the next step */
+    const void *sp;            /* enclosing superpage, if any */
+    int         state;
+    int         level;
+} matryoshka_lookup_t;
+
+/* Start a lookup of `key`: prefetch the root, read nothing else. */
+void matryoshka_lookup_start(const matryoshka_tree_t *tree, int32_t key,
+                              matryoshka_lookup_t *lk);
+
+/* Advance one level.  Returns true once lk->done; further calls do
+   nothing. */
+bool matryoshka_lookup_step(matryoshka_lookup_t *lk);
+
+/* ── Runahead ───────────────────────────────────────────────── */
+
+/* A helper thread that warms the caches for a stream of lookups the
+   caller makes one at a time, in the order of keys[0..n).  It walks
+   each key down the tree (reading internal nodes, prefetching the CL
+   leaf) up to `distance` keys (0: 256) ahead of the position the caller
+   reports, so it pays off when it shares L1/L2 with the caller: pin the
+   caller, and pass cpu < 0 to place the helper on its SMT sibling.
+   Returns NULL, with errno ENODEV, if that CPU has no sibling.  The
+   tree and keys[] must not change until the helper is stopped. */
+typedef struct matryoshka_runahead matryoshka_runahead_t;
+
+matryoshka_runahead_t *matryoshka_runahead_start(const matryoshka_tree_t *tree,
+                                                 const int32_t *keys,
+                                                 size_t n, size_t distance,
+                                                 int cpu);
+
+/* Report that the caller has reached keys[pos].  A relaxed store;
+   calling it every few keys is enough. */
+void matryoshka_runahead_advance(matryoshka_runahead_t *r, size_t pos);
+
+/* Stop and join the helper.  Returns how many keys it walked. */
+size_t matryoshka_runahead_stop(matryoshka_runahead_t *r);
+
 /* ── Modification ───────────────────────────────────────────── */
 
 /* Insert a key.  Returns true if the key was inserted, false if it
-   already existed.  O(log b · log_B n) where b is the CL branching
+   already existed or memory ran out (tree unchanged).  O(log b · log_B n) where b is the CL branching
    factor and B is the page-level key capacity. */
 bool matryoshka_insert(matryoshka_tree_t *tree, int32_t key);
 
 /* Delete a key.  Returns true if the key was found and removed, false
-   if it was not present.  O(log b · log_B n). */
+   if it was not present or, during matryoshka_convert, memory ran out
+   (tree unchanged).  O(log b · log_B n). */
 bool matryoshka_delete(matryoshka_tree_t *tree, int32_t key);
 
 /* Batch insert: insert n keys at once, amortizing tree traversal.
    Keys need not be sorted or unique (sorted internally, duplicates skipped).
-   Returns the number of keys actually inserted. */
+   Returns the number of keys actually inserted; if memory runs out
+   the batch stops there, with the keys so far in the tree. */
 size_t matryoshka_insert_batch(matryoshka_tree_t *tree,
                                 const int32_t *keys, size_t n);
 
@@ -90,6 +189,98 @@ size_t matryoshka_insert_batch(matryoshka_tree_t *tree,
 size_t matryoshka_delete_batch(matryoshka_tree_t *tree,
                                 const int32_t *keys, size_t n);
 
+/* Batch insert and delete that sort the caller's array in place rather
+   than a copy of it.  Same results as the copying versions; keys[] is
+   left sorted. */
+size_t matryoshka_insert_batch_inplace(matryoshka_tree_t *tree,
+                                        int32_t *keys, size_t n);
+size_t matryoshka_delete_batch_inplace(matryoshka_tree_t *tree,
+                                        int32_t *keys, size_t n);
+
+/* Range replace: make the keys in [lo, hi) exactly keys[0..n), which
+   must be strictly ascending and lie within [lo, hi).  Affected leaf
+   pages are rebuilt once from the surviving keys plus the new run and
+   spliced into the leaf chain and parent nodes, so a refresh costs
+   O(n / B) page writes rather than a delete and an insert per key.
+   Returns false (tree unchanged) if the run is unsorted or out of range.
+   Out of memory it also returns false, with the tree consistent: each
+   leaf parent's share of the range is replaced whole or not at all.
+   Superpage trees fall back to a batch delete and insert, which offer
+   no such guarantee: there false means part of the old range may be
+   gone and only part of the new run inserted. */
+bool matryoshka_replace_range(matryoshka_tree_t *tree, int32_t lo,
+                               int32_t hi, const int32_t *keys, size_t n);
+
+/* ── Online conversion ──────────────────────────────────────── */
+
+/* Switch a live tree to another hierarchy without rebuilding it.  From
+   this call on, pages written by inserts, deletes and range replaces
+   take the new layout; leaves still in the old one keep serving until
+   matryoshka_convert_step reaches them, and searches go by each page's
+   own layout.  Both hierarchies must use the same kind of leaf: page
+   trees convert between default, fence and Eytzinger layouts, colouring,
+   inode compression and separator policy; superpage trees between
+   superpage and fence_sp.  Returns false (tree unchanged) otherwise. */
+bool matryoshka_convert(matryoshka_tree_t *tree, const mt_hierarchy_t *hier);
+
+/* Advance a conversion by up to max_leaves leaves (pages, or superpages)
+   in key order, rewriting those still in the old layout.  Returns true
+   once every leaf has the new layout, or if no conversion is under way. */
+bool matryoshka_convert_step(matryoshka_tree_t *tree, size_t max_leaves);
+
+/* ── Workspace ──────────────────────────────────────────────── */
+
+/* Bytes of scratch memory that let this tree's superpage splits and
+   merges, and copying batches of up to batch_keys keys, run without
+   calling the allocator.  Page-leaf trees only need the batch part. */
+size_t matryoshka_workspace_size(const matryoshka_tree_t *tree,
+                                  size_t batch_keys);
+
+/* Lend the tree `size` bytes of caller memory as scratch, replacing any
+   earlier workspace; NULL detaches.  The memory must stay valid until
+   detached or the tree is destroyed, and the tree does not free it.
+   Work that does not fit falls back to malloc. */
+void matryoshka_set_workspace(matryoshka_tree_t *tree, void *buf,
+                               size_t size);
+
+/* ── Transactions ───────────────────────────────────────────── */
+
+/* Optimistic multi-key transaction.  Reads record the version of the
+   leaf they looked at; writes are buffered.  Commit latches the written
+   leaves in a fixed order, checks that nothing read has changed, and
+   applies the writes so that other transactions see all of them or
+   none.  Writes that fit their leaf run concurrently with other
+   commits; one that needs a split or merge waits for exclusive access
+   to the tree.
+
+   While any thread uses transactions on a tree, every access to it
+   from other threads must also go through transactions. */
+typedef struct matryoshka_txn matryoshka_txn_t;
+
+/* Start a transaction.  Returns NULL on allocation failure. */
+matryoshka_txn_t *matryoshka_txn_begin(matryoshka_tree_t *tree);
+
+/* Membership test inside the transaction, seeing its own writes.  If
+   the read cannot be recorded for lack of memory it returns false and
+   the transaction's commit will fail. */
+bool matryoshka_txn_contains(matryoshka_txn_t *txn, int32_t key);
+
+/* Buffer an insert or delete.  Inserting a present key or deleting an
+   absent one is a no-op at commit.  Return false on allocation failure. */
+bool matryoshka_txn_insert(matryoshka_txn_t *txn, int32_t key);
+bool matryoshka_txn_delete(matryoshka_txn_t *txn, int32_t key);
+
+/* Commit.  Returns false, with nothing applied, if a leaf the
+   transaction read was changed by another commit since, or if one of
+   its calls ran out of memory; re-run the transaction to retry.  Either way the transaction is emptied and can
+   be reused. */
+bool matryoshka_txn_commit(matryoshka_txn_t *txn);
+
+/* Drop buffered writes and recorded reads. */
+void matryoshka_txn_abort(matryoshka_txn_t *txn);
+
+void matryoshka_txn_destroy(matryoshka_txn_t *txn);
+
 /* ── Iteration ──────────────────────────────────────────────── */
 
 /* Iterator for in-order traversal. */
@@ -107,6 +298,279 @@ bool matryoshka_iter_next(matryoshka_iter_t *iter, int32_t *key);
 /* Destroy an iterator. */
 void matryoshka_iter_destroy(matryoshka_iter_t *iter);
 
+/* ── Access sampling ────────────────────────────────────────── */
+
+/* Sampled traffic of one leaf (page, or superpage in superpage trees).
+   [lo, hi] spans the sampled keys that reached it.  Counts are samples:
+   multiply by the sampling period to estimate operations. */
+typedef struct matryoshka_heat_leaf {
+    const void *leaf;
+    int32_t     lo, hi;
+    uint64_t    reads, writes;
+} matryoshka_heat_leaf_t;
+
+/* Key buckets for matryoshka_heatmap_buckets: bucket b holds the keys
+   whose top 8 bits, counted from INT32_MIN, equal b (2^24 keys each). */
+#define MATRYOSHKA_HEAT_BUCKETS 256
+
+/* Sample about one in `period` searches, membership tests, inserts and
+   deletes on each thread (jittered), recording the leaf and key into a
+   small lossy per-thread table.  period == 0 stops sampling and drops
+   the tables.  Must not race with operations on the tree. */
+bool matryoshka_heatmap_enable(matryoshka_tree_t *tree, uint32_t period);
+
+/* Merge all threads' tables into per-leaf rows ordered by lo.  Writes up
+   to `cap` rows and returns the number of distinct leaves.  Safe to call
+   while other threads are searching. */
+size_t matryoshka_heatmap_leaves(const matryoshka_tree_t *tree,
+                                  matryoshka_heat_leaf_t *out, size_t cap);
+
+/* Sampled reads and writes per key bucket, summed over threads. */
+void matryoshka_heatmap_buckets(const matryoshka_tree_t *tree,
+                                 uint64_t reads[MATRYOSHKA_HEAT_BUCKETS],
+                                 uint64_t writes[MATRYOSHKA_HEAT_BUCKETS]);
+
+/* Zero every counter, e.g. after each periodic export. */
+void matryoshka_heatmap_reset(const matryoshka_tree_t *tree);
+
+/* ── Explain ────────────────────────────────────────────────── */
+
+/* What one step of an explained search visited. */
+typedef enum matryoshka_step_kind {
+    MATRYOSHKA_STEP_INODE,     /* outer 4 KiB internal node */
+    MATRYOSHKA_STEP_SUPERPAGE, /* superpage header: root page and height */
+    MATRYOSHKA_STEP_SP_INODE,  /* page-level internal inside a superpage */
+    MATRYOSHKA_STEP_PAGE,      /* leaf page header */
+    MATRYOSHKA_STEP_CL_INODE,  /* CL internal node within the page */
+    MATRYOSHKA_STEP_CL_LEAF,   /* CL leaf: predecessor within the line */
+    MATRYOSHKA_STEP_CL_PREV,   /* descent to the previous CL leaf */
+    MATRYOSHKA_STEP_PREV_LEAF  /* fallback to the header.prev page */
+} matryoshka_step_kind_t;
+
+/* How a CL internal step was resolved. */
+typedef enum matryoshka_step_path {
+    MATRYOSHKA_PATH_SEARCH,    /* ordinary search of the node */
+    MATRYOSHKA_PATH_FENCE,     /* fence keys in the page header */
+    MATRYOSHKA_PATH_EYTZ       /* Eytzinger SIMD, children by position */
+} matryoshka_step_path_t;
+
+typedef struct matryoshka_explain_step {
+    matryoshka_step_kind_t kind;
+    matryoshka_step_path_t path;
+    const void *node;          /* inode, superpage page or leaf page */
+    int         slot;          /* CL slot or superpage page index, else -1 */
+    int         idx;           /* child taken, or position in the CL leaf */
+    uint32_t    lines;         /* cache lines first touched by this step */
+    uint64_t    cycles;        /* TSC cycles of the step's search kernel */
+} matryoshka_explain_step_t;
+
+#define MATRYOSHKA_EXPLAIN_MAX_STEPS 32
+
+typedef struct matryoshka_explain {
+    int32_t  key;
+    bool     found;            /* a predecessor exists */
+    int32_t  result;           /* the predecessor, if found */
+    bool     fence;            /* the leaf page took the fence-key path */
+    bool     eytz;             /* the leaf page took the Eytzinger path */
+    bool     prev_leaf;        /* answer came from the header.prev page */
+    uint32_t lines;            /* distinct cache lines over all steps */
+    uint64_t cycles;           /* sum of step cycles */
+    int      nsteps;
+    matryoshka_explain_step_t steps[MATRYOSHKA_EXPLAIN_MAX_STEPS];
+} matryoshka_explain_t;
+
+/* Run a predecessor search for `key` step by step and describe it in
+   *out: each node visited, which fast paths fired, the cache lines each
+   step reads (the kernels' probe order, counted once per search) and
+   the cycles each step's kernel took, overhead of the timer removed.
+   Returns the same answer as matryoshka_search.  Diagnostic only: the
+   walk is much slower than a plain search. */
+bool matryoshka_explain(const matryoshka_tree_t *tree, int32_t key,
+                        matryoshka_explain_t *out);
+
+/* ── Filtered scan ──────────────────────────────────────────── */
+
+/* Inclusive key range [lo, hi]. */
+typedef struct matryoshka_range {
+    int32_t lo;
+    int32_t hi;
+} matryoshka_range_t;
+
+typedef enum matryoshka_pred_kind {
+    MATRYOSHKA_PRED_ALL,      /* every key */
+    MATRYOSHKA_PRED_MASK,     /* (key & mask) == value */
+    MATRYOSHKA_PRED_MOD,      /* key mod modulus == remainder (0 ≤ r < m) */
+    MATRYOSHKA_PRED_RANGES,   /* key in any of ranges[0..nranges) */
+    MATRYOSHKA_PRED_ZBOX      /* key is the Morton key of a point in *zbox */
+} matryoshka_pred_kind_t;
+
+/* Inclusive rectangle of points for Morton keys (see Z-order scan). */
+typedef struct matryoshka_zbox {
+    uint16_t xlo, ylo;
+    uint16_t xhi, yhi;
+} matryoshka_zbox_t;
+
+/* Predicate descriptor for matryoshka_scan_filtered.  Only the fields
+   of the selected kind are read.  MOD uses the non-negative remainder,
+   so -1 mod 4 == 3.  RANGES must be sorted by lo and non-overlapping. */
+typedef struct matryoshka_pred {
+    matryoshka_pred_kind_t    kind;
+    int32_t                   mask, value;
+    uint32_t                  modulus, remainder;
+    const matryoshka_range_t *ranges;
+    size_t                    nranges;
+    const matryoshka_zbox_t  *zbox;
+} matryoshka_pred_t;
+
+/* Write the keys in [lo, hi] that satisfy `pred` to out[], in ascending
+   order, stopping after `cap` keys.  Returns the number written; to
+   resume a truncated scan, call again with lo = last key + 1.  Keys are
+   tested a cache line at a time with SIMD compares.  A NULL pred
+   matches every key. */
+size_t matryoshka_scan_filtered(const matryoshka_tree_t *tree,
+                                 int32_t lo, int32_t hi,
+                                 const matryoshka_pred_t *pred,
+                                 int32_t *out, size_t cap);
+
+/* ── Multi-range scan ───────────────────────────────────────── */
+
+/* Write the keys of each inclusive range, range after range, to out[],
+   stopping after `cap` keys.  If `ends` is non-NULL, ends[i] receives
+   the output count after range i, so range i's keys are
+   out[ends[i-1] .. ends[i]).  Ranges are independent: any order, and
+   overlaps repeat keys; a range with lo > hi is empty.  The descents
+   for up to 16 range starts are interleaved so their node misses
+   overlap, and consecutive ascending starts in the same subtree reuse
+   the path already found.  Returns the number of keys written. */
+size_t matryoshka_scan_ranges(const matryoshka_tree_t *tree,
+                               const matryoshka_range_t *ranges,
+                               size_t nranges, int32_t *out, size_t cap,
+                               size_t *ends);
+
+/* ── Z-order scan ───────────────────────────────────────────── */
+
+/* The key of point (x, y): x in the even bits and y in the odd bits of
+   the Morton code, with the top bit flipped so that key order is
+   Z order. */
+int32_t matryoshka_morton_key(uint16_t x, uint16_t y);
+
+/* The point whose Morton key is `key`. */
+void matryoshka_morton_xy(int32_t key, uint16_t *x, uint16_t *y);
+
+/* Write the Morton keys >= `from` of points in `box` to out[], in
+   ascending order, stopping after `cap` keys.  Returns the number
+   written; to resume a truncated scan, call again with from = last
+   key + 1.  Where the Z curve leaves the box the scan computes the
+   next key back inside it (BIGMIN) and descends the tree to it afresh,
+   and skips any cache line with no in-box key below its last one
+   (LITMAX), so work follows the output rather than the Z-span from
+   the box's low corner to its high one. */
+size_t matryoshka_scan_zbox(const matryoshka_tree_t *tree,
+                             const matryoshka_zbox_t *box, int32_t from,
+                             int32_t *out, size_t cap);
+
+/* ── Tree images ────────────────────────────────────────────── */
+
+/* Resources for matryoshka_build_image.  Zeroed fields take defaults. */
+typedef struct matryoshka_build_opts {
+    size_t      mem_bytes;   /* key buffers for sorting (default 256 MiB) */
+    int         threads;     /* sort and leaf-build threads (default: online
+                                CPUs) */
+    const char *tmp_dir;     /* sorted runs (default $TMPDIR, else /tmp) */
+} matryoshka_build_opts_t;
+
+/* Build a tree image from a file of native-endian int32 keys in any
+   order, duplicates allowed, without holding the keys in memory.
+   Sorted runs of mem_bytes / threads keys are written to one unlinked
+   temporary file in parallel, then merged once, and the merged stream
+   is cut into leaves that the worker threads build and write straight
+   to the image.  Memory stays near mem_bytes plus a few leaves per
+   thread, however large the input.  The image stores file offsets for
+   every pointer, so it can be loaded at any address.  Writes the key
+   count to *nkeys if non-NULL.  Returns false, with errno set, on an
+   I/O error or an input size that is not a multiple of 4. */
+bool matryoshka_build_image(const char *keys_path, const char *image_path,
+                            const mt_hierarchy_t *hier,
+                            const matryoshka_build_opts_t *opts,
+                            size_t *nkeys);
+
+/* Load an image written by matryoshka_build_image into a new tree with
+   the image's hierarchy.  Leaves are read straight into arena pages and
+   their links relocated; the tree is then an ordinary mutable tree.
+   Returns NULL, with errno set, if the file is unreadable or not a
+   valid image for this build. */
+matryoshka_tree_t *matryoshka_image_load(const char *path);
+
+/* Write a tree as an image, node for node, in the format above.  The
+   tree must not change during the call. */
+bool matryoshka_image_save(const matryoshka_tree_t *tree, const char *path);
+
+/* ── Portable export ────────────────────────────────────────── */
+
+/* Write the tree's keys to `path` in a compact, host-independent form:
+   one block per leaf page, each delta-coded and bit-packed, typically
+   well under 4 bytes a key.  Returns false, with errno set, on an I/O
+   error. */
+bool matryoshka_export(const matryoshka_tree_t *tree, const char *path);
+
+/* Rebuild a tree from an export, decoding blocks on `threads` threads
+   (0: one per online CPU).  hier NULL imports into the exporting
+   tree's hierarchy.  Page-leaf trees keep the exported pages' fill, a
+   page per block unless it holds more than hier's page capacity.
+   Returns NULL, with errno set (EINVAL for a malformed file). */
+matryoshka_tree_t *matryoshka_import(const char *path,
+                                     const mt_hierarchy_t *hier,
+                                     int threads);
+
+/* ── Shared read-only images ────────────────────────────────── */
+
+/* An image mapped read-only and searched in place.  Every process
+   attached to the same file shares one page-cache copy, and attaching
+   costs a mmap rather than a load.  Searches may run concurrently. */
+typedef struct matryoshka_image matryoshka_image_t;
+
+/* Map an image file.  Returns NULL, with errno set, if it is not a
+   valid image for this build. */
+matryoshka_image_t *matryoshka_image_attach(const char *path);
+void matryoshka_image_detach(matryoshka_image_t *img);
+
+size_t matryoshka_image_size(const matryoshka_image_t *img);
+
+/* matryoshka_search and matryoshka_contains on an attached image. */
+bool matryoshka_image_search(const matryoshka_image_t *img, int32_t key,
+                             int32_t *result);
+bool matryoshka_image_contains(const matryoshka_image_t *img, int32_t key);
+
+/* Publish a snapshot of `tree` under `prefix` (a path; under /dev/shm
+   for shared memory).  The image is written to <prefix>.<gen>.img and
+   renamed into place, then the control page <prefix>.ctl switches to
+   it under a seqlock and the previous image is unlinked; readers still
+   mapping it keep it until they move on.  One writer per prefix.
+   Returns false, with errno set, on an I/O error. */
+bool matryoshka_publish(const matryoshka_tree_t *tree, const char *prefix);
+
+/* A reader follows a prefix's published versions. */
+typedef struct matryoshka_reader matryoshka_reader_t;
+
+/* Map the control page of a prefix.  Returns NULL if it has none,
+   with errno EAGAIN if its writer has not finished creating it, or
+   EINVAL if the file is not a control page. */
+matryoshka_reader_t *matryoshka_reader_open(const char *prefix);
+
+/* The newest published image, attached on first use.  A check costs
+   two reads of the shared seqlock; when a new version has been
+   published the reader switches to it and detaches the previous one,
+   so an image returned earlier is valid only until the next call.
+   Returns NULL if nothing is published yet.  Not thread-safe: use one
+   reader per thread (mappings of one file share memory anyway). */
+const matryoshka_image_t *matryoshka_reader_current(matryoshka_reader_t *r);
+
+/* Generation of the image matryoshka_reader_current last returned,
+   0 if none.  Generations count up from 1 per prefix. */
+uint64_t matryoshka_reader_generation(const matryoshka_reader_t *r);
+
+void matryoshka_reader_close(matryoshka_reader_t *r);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,9 +5,10 @@
  *
  *   Internal node (4 KiB page):
  *     ┌───────────────────────────────────────────────┐
- *     │ header: node_type, nkeys, padding              │  16 B
+ *     │ header: node_type, nkeys, key16, key_base      │  16 B
  *     ├───────────────────────────────────────────────┤
  *     │ keys[MAX_IKEYS]: sorted int32 array            │  ≤1360 B
+ *     │   (or key_base + int16 offsets when dense)     │
  *     ├───────────────────────────────────────────────┤
  *     │ children[MAX_IKEYS+1]: child page pointers     │  ≤2728 B
  *     └───────────────────────────────────────────────┘
@@ -38,6 +39,34 @@
 #define MT_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
 #endif
 
+/* ── Static tracepoints ─────────────────────────────────────── */
+/*
+ * USDT probes on structural events, compiled in when MT_USDT is defined
+ * (CMake option MT_USDT, on by default when <sys/sdt.h> is present).
+ * An unattached probe is a single nop; list them with
+ *   bpftrace -l 'usdt:/path/to/binary:matryoshka:*'
+ *
+ *   leaf_split(sep, left, right, left_nkeys, right_nkeys)
+ *   sp_split(sep, left, right, left_nkeys, right_nkeys)
+ *   cl_root_grow(key, page, sub_height, nslots_used)
+ *   leaf_redistribute(sep, page, sibling, page_nkeys, sibling_nkeys)
+ *   leaf_merge(survivor, freed, nkeys)
+ *   sp_redistribute(sep, sp, sibling, sp_nkeys, sibling_nkeys)
+ *   sp_merge(survivor, freed, nkeys)
+ *   arena_create(base, arena_size, page_size, is_mmap)
+ *   eytz_rebuild(key, page, nkeys)
+ */
+#ifdef MT_USDT
+#include <sys/sdt.h>
+#define MT_PROBE3(name, a, b, c)        DTRACE_PROBE3(matryoshka, name, a, b, c)
+#define MT_PROBE4(name, a, b, c, d)     DTRACE_PROBE4(matryoshka, name, a, b, c, d)
+#define MT_PROBE5(name, a, b, c, d, e)  DTRACE_PROBE5(matryoshka, name, a, b, c, d, e)
+#else
+#define MT_PROBE3(name, a, b, c)        ((void)0)
+#define MT_PROBE4(name, a, b, c, d)     ((void)0)
+#define MT_PROBE5(name, a, b, c, d, e)  ((void)0)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -64,6 +93,7 @@ extern "C" {
 /* Eytzinger CL internal: 4 B header + 15 × 4 B keys = 64 B (no children[]) */
 #define MT_CL_EYTZ_SEP_CAP    15
 #define MT_CL_EYTZ_CHILD_CAP  16
+#define MT_EYTZ_PAGE_MAX_KEYS (MT_CL_EYTZ_CHILD_CAP * MT_CL_KEY_CAP)  /* 240 */
 
 /* Fence keys embedded in page header (6 keys in 32 spare bytes). */
 #define MT_FENCE_KEY_CAP   6
@@ -103,6 +133,13 @@ typedef struct mt_hierarchy {
     int     sp_max_keys;      /* Max keys per superpage (~436K) */
     int     min_sp_keys;      /* Min superpage occupancy for outer tree */
     int     cl_strategy;      /* mt_cl_strategy_t: DEFAULT, FENCE, or EYTZ */
+    bool    color_pages;      /* Rotate CL slot placement per page (see
+                                 mt_page_slot_index) */
+    bool    compress_inodes;  /* Store outer separators as 16-bit offsets
+                                 when a node's key span allows */
+    bool    tight_separators; /* On deleting a leaf's minimum, raise its
+                                 separator to the new minimum, so a
+                                 predecessor never lies in the previous leaf */
 } mt_hierarchy_t;
 
 /* ── Arena allocator types ──────────────────────────────────── */
@@ -113,6 +150,7 @@ typedef struct mt_arena {
     size_t           page_size;
     int              num_pages;
     bool             is_mmap;
+    uint32_t         epoch;     /* bitmap is stale unless == alloc epoch */
     uint64_t        *bitmap;
     struct mt_arena *next;
 } mt_arena_t;
@@ -121,6 +159,7 @@ typedef struct mt_allocator {
     mt_arena_t *arenas;
     size_t      arena_size;
     size_t      page_size;
+    uint32_t    epoch;          /* bumped by mt_allocator_reset */
 } mt_allocator_t;
 
 #define MT_KEY_MAX         INT32_MAX
@@ -201,6 +240,9 @@ MT_STATIC_ASSERT(sizeof(mt_cl_slot_t) == MT_CL_SIZE,
 #define MT_SP_MAX_IKEYS    681
 #define MT_SP_MIN_IKEYS    (MT_SP_MAX_IKEYS / 2)
 
+/* Most keys a superpage can hold: every page a full leaf page. */
+#define MT_SP_KEY_CAP      ((size_t)MT_SP_PAGES * MT_PAGE_SLOTS * MT_CL_KEY_CAP)
+
 /* ── Superpage header (page 0 of a 2 MiB region) ──────────── */
 
 struct mt_sp_header;  /* forward decl */
@@ -244,7 +286,8 @@ typedef struct mt_page_header {
     uint8_t          root_slot;     /* CL slot index of sub-tree root (1–63) */
     uint8_t          sub_height;    /* Sub-tree height (0 = single CL leaf) */
     uint8_t          nslots_used;   /* Number of CL slots allocated */
-    uint8_t          flags;         /* Bit 0: Eytzinger layout */
+    uint8_t          flags;         /* Bit 0: Eytzinger layout;
+                                       bits 2–7: page colour */
     uint64_t         slot_bitmap;   /* Bits 1–63: CL slot allocation */
     struct mt_lnode *prev;          /* Previous leaf (outer tree linked list) */
     struct mt_lnode *next;          /* Next leaf (outer tree linked list) */
@@ -272,6 +315,48 @@ typedef struct mt_lnode {
 MT_STATIC_ASSERT(sizeof(mt_lnode_t) == MT_PAGE_SIZE,
                "mt_lnode_t must be exactly 4096 bytes");
 
+/* ── Page colouring ─────────────────────────────────────────── */
+/*
+ * Every leaf page is 4 KiB-aligned, so CL slot s of every page maps to
+ * the same L1/L2 set.  The slots a bulk-loaded page touches first (the
+ * CL root and level-1 internals are allocated last, i.e. the highest
+ * slot numbers) therefore compete for a handful of sets across all
+ * pages of a search-heavy working set.
+ *
+ * A coloured page stores a colour c (0–62) in header.flags bits 2–7 and
+ * places logical slot s (1–63) at physical slots[(s - 1 + c) mod 63].
+ * Slot numbers in the bitmap, CL children[] and Eytzinger arithmetic
+ * stay logical; only the physical position rotates.  Colour 0 is the
+ * identity mapping, so uncoloured pages are laid out as before.
+ */
+
+#define MT_PAGE_COLOR_SHIFT   2
+
+/* Colour for a page at `addr`: its 4 KiB frame number mod 63, so
+   consecutive pages of an arena get consecutive colours. */
+static inline uint8_t mt_page_color_for(const void *addr)
+{
+    return (uint8_t)(((uintptr_t)addr / MT_PAGE_SIZE) % MT_PAGE_SLOTS);
+}
+
+/* Physical slots[] index of logical CL slot `slot` (1–63). */
+static inline int mt_page_slot_index(const mt_lnode_t *page, int slot)
+{
+    int idx = slot - 1 + (page->header.flags >> MT_PAGE_COLOR_SHIFT);
+    return (idx >= MT_PAGE_SLOTS) ? idx - MT_PAGE_SLOTS : idx;
+}
+
+static inline mt_cl_slot_t *mt_page_slot(mt_lnode_t *page, int slot)
+{
+    return &page->slots[mt_page_slot_index(page, slot)];
+}
+
+static inline const mt_cl_slot_t *mt_page_slot_c(const mt_lnode_t *page,
+                                                  int slot)
+{
+    return &page->slots[mt_page_slot_index(page, slot)];
+}
+
 /* ── Outer B+ tree nodes ────────────────────────────────────── */
 
 /* Forward declaration so struct members can hold pointers. */
@@ -283,16 +368,31 @@ typedef struct mt_inode {
     /* Header (16 bytes) */
     uint16_t        type;           /* MT_NODE_INTERNAL */
     uint16_t        nkeys;
-    uint32_t        _pad;
-    uint64_t        _reserved;
-
-    /* Sorted key array. */
-    int32_t         keys[MT_MAX_IKEYS];
+    uint8_t         key16;          /* 1: separators in keys16[] */
+    uint8_t         _pad[3];
+    int32_t         key_base;       /* keys16[] origin (see below) */
+    uint32_t        _reserved;
+
+    /* Sorted key array.  When key16 is set, separator i is
+       key_base + 32768 + keys16[i]: the 16-bit offsets are biased so
+       that signed SIMD compares order them correctly. */
+    union {
+        int32_t     keys[MT_MAX_IKEYS];
+        int16_t     keys16[MT_MAX_IKEYS];
+    };
 
     /* Child pointers. */
     union mt_node  *children[MT_MAX_IKEYS + 1];
 } mt_inode_t;
 
+/* Separator i of an internal node, in either key layout. */
+static inline int32_t mt_inode_key(const mt_inode_t *node, int i)
+{
+    if (node->key16)
+        return (int32_t)((int64_t)node->key_base + 32768 + node->keys16[i]);
+    return node->keys[i];
+}
+
 /* Generic node pointer (tagged by type field at offset 0). */
 typedef union mt_node {
     mt_node_type_t type;
@@ -304,7 +404,9 @@ typedef union mt_node {
 /*
  * Leaf pointers in outer-tree children[] arrays encode metadata in
  * the low 12 bits (guaranteed zero by 4096-byte alignment):
- *   bits 0–5: root_slot  (CL sub-tree root slot index, 1–63)
+ *   bits 0–5: root_slot  (physical position of the CL sub-tree root,
+ *             1–63, i.e. mt_page_slot_index() + 1 — already colour-
+ *             adjusted so the prefetch needs no header access)
  *   bits 6–8: sub_height (CL sub-tree height, 0–7)
  *
  * This lets find_leaf() prefetch the CL root cache line one outer-tree
@@ -327,7 +429,8 @@ static inline mt_node_t *mt_untag(mt_node_t *ptr)
 static inline mt_node_t *mt_tag_leaf_ptr(mt_node_t *ptr)
 {
     mt_lnode_t *leaf = &ptr->lnode;
-    uintptr_t tag = (uintptr_t)leaf->header.root_slot |
+    int phys = mt_page_slot_index(leaf, leaf->header.root_slot) + 1;
+    uintptr_t tag = (uintptr_t)phys |
                     ((uintptr_t)leaf->header.sub_height << MT_PTR_HEIGHT_SHIFT);
     return (mt_node_t *)((uintptr_t)ptr | tag);
 }
@@ -352,6 +455,12 @@ struct matryoshka_tree {
     int             height;       /* Outer tree height (0 = single leaf) */
     mt_hierarchy_t  hier;
     mt_allocator_t *alloc;        /* Arena allocator for leaf nodes */
+    struct mt_heat *heat;         /* Access sampler, NULL when off */
+    struct mt_txn_domain *txn;    /* Transaction state, NULL until used */
+    int32_t        *ws;           /* Caller workspace, NULL if none */
+    size_t          ws_keys;      /* Its size in keys */
+    bool            converting;   /* matryoshka_convert under way */
+    int64_t         convert_at;   /* Leaves below this key are converted */
 };
 
 /* ── Iterator ───────────────────────────────────────────────── */
@@ -375,6 +484,8 @@ void mt_hierarchy_init_custom(mt_hierarchy_t *h, size_t leaf_alloc);
 
 /* Page header flags (mt_page_header_t.flags). */
 #define MT_PAGE_FLAG_EYTZ  0x01   /* Eytzinger dense BFS layout */
+#define MT_PAGE_FLAG_FENCE 0x02   /* Fence keys kept in the header */
+#define MT_PAGE_LAYOUT_MASK (MT_PAGE_FLAG_EYTZ | MT_PAGE_FLAG_FENCE)
 
 /* ── Page sub-tree operations (leaf.c) ─────────────────────── */
 
@@ -413,6 +524,16 @@ mt_status_t mt_page_delete(mt_lnode_t *page, int32_t key,
    Returns the number of keys extracted. */
 int mt_page_extract_sorted(const mt_lnode_t *page, int32_t *out);
 
+/* Collect pointers to the page's CL leaves in key order into out[]
+   (room for MT_PAGE_SLOTS entries).  Returns the number of CL leaves. */
+int mt_page_cl_leaves(const mt_lnode_t *page, const mt_cl_leaf_t **out);
+
+/* Like mt_page_cl_leaves, but only the CL leaves that may hold keys in
+   [lo, hi] (lo <= hi), reading no other leaf lines.  *past is set when
+   the page holds keys above hi, so later pages need not be scanned. */
+int mt_page_cl_range(const mt_lnode_t *page, int32_t lo, int32_t hi,
+                     const mt_cl_leaf_t **out, bool *past);
+
 /* Bulk-load sorted keys into an empty page.  O(n).
    Uses hier->cl_strategy to select sub-tree layout. */
 void mt_page_bulk_load(mt_lnode_t *page, const int32_t *sorted_keys, int nkeys,
@@ -421,6 +542,25 @@ void mt_page_bulk_load(mt_lnode_t *page, const int32_t *sorted_keys, int nkeys,
 /* Initialise an empty leaf page using the given hierarchy. */
 void mt_page_init_with(mt_lnode_t *page, const mt_hierarchy_t *hier);
 
+/* ── Streaming bulk build ───────────────────────────────────── */
+/*
+ * Bulk loads whose leaves total at least MT_STREAM_BUILD_BYTES build
+ * each page in a cache-resident staging buffer and write it out with
+ * non-temporal stores, so a multi-GB build neither evicts the caller's
+ * working set nor reads destination lines in before overwriting them.
+ * Smaller builds keep ordinary stores: their leaves are likely to be
+ * searched straight away and are better left in cache.
+ */
+#define MT_STREAM_BUILD_BYTES  ((size_t)32 << 20)
+
+void mt_page_stream(void *dst, const void *src);
+
+/* mt_page_bulk_load through a staging page, streamed to `page` with
+   header prev/next preset.  Returns the tagged pointer for the parent. */
+mt_node_t *mt_page_bulk_load_nt(mt_lnode_t *page, const int32_t *sorted_keys,
+                                int nkeys, const mt_hierarchy_t *hier,
+                                mt_lnode_t *prev, mt_lnode_t *next);
+
 /* Split a page: move approximately half of the keys to `new_page`.
    Returns the separator key (first key of new_page). */
 int32_t mt_page_split(mt_lnode_t *page, mt_lnode_t *new_page,
@@ -429,17 +569,34 @@ int32_t mt_page_split(mt_lnode_t *page, mt_lnode_t *new_page,
 /* Return the minimum (first) key in a page. */
 int32_t mt_page_min_key(const mt_lnode_t *page);
 
+/* Return the maximum (last) key in a page, or INT32_MIN if empty. */
+int32_t mt_page_max_key(const mt_lnode_t *page);
+
 /* Membership test within a leaf page. */
 bool mt_page_contains(const mt_lnode_t *page, int32_t key);
 
+/* Walk the page's CL internal nodes towards `key` and prefetch the CL
+   leaf it lands on into L2, without reading the leaf. */
+void mt_page_prefetch_key(const mt_lnode_t *page, int32_t key);
+
 /* ── Internal node search (inode.c) ───────────────────────── */
 
 int mt_inode_search(const mt_inode_t *node, int32_t key);
 
+/* Switch a node to the 16-bit separator layout if its separators span
+   at most 65535; returns whether the node is now compressed. */
+bool mt_inode_narrow(mt_inode_t *node);
+
+/* Expand a compressed node back to 32-bit keys[] in place.  Callers
+   widen before editing keys[] directly. */
+void mt_inode_widen(mt_inode_t *node);
+
 /* ── Node allocation (alloc.c) ─────────────────────────────── */
 
 mt_node_t *mt_alloc_inode(void);
 mt_node_t *mt_alloc_lnode(const mt_hierarchy_t *hier, mt_allocator_t *alloc);
+/* Leaf memory for a bulk builder that overwrites all of it: not zeroed. */
+mt_node_t *mt_alloc_lnode_raw(const mt_hierarchy_t *hier, mt_allocator_t *alloc);
 void mt_free_inode(mt_node_t *node);
 void mt_free_lnode(mt_node_t *node, mt_allocator_t *alloc);
 
@@ -450,9 +607,15 @@ mt_status_t mt_sp_insert(void *sp, int32_t key, const mt_hierarchy_t *hier);
 mt_status_t mt_sp_delete(void *sp, int32_t key, const mt_hierarchy_t *hier);
 bool        mt_sp_search_key(const void *sp, int32_t key, int32_t *result);
 bool        mt_sp_contains(const void *sp, int32_t key);
-int32_t     mt_sp_split(void *sp, void *new_sp, const mt_hierarchy_t *hier);
+/* Split sp's keys evenly with new_sp; `scratch` must hold sp's nkeys. */
+int32_t     mt_sp_split(void *sp, void *new_sp, const mt_hierarchy_t *hier,
+                        int32_t *scratch);
 void        mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
                              const mt_hierarchy_t *hier);
+/* mt_sp_bulk_load writing page leaves with streaming stores and leaving
+   unused pages unwritten (see MT_STREAM_BUILD_BYTES). */
+void        mt_sp_bulk_load_nt(void *sp, const int32_t *keys, int nkeys,
+                                const mt_hierarchy_t *hier);
 int         mt_sp_extract_sorted(const void *sp, int32_t *out);
 int32_t     mt_sp_min_key(const void *sp);
 int32_t     mt_sp_max_key(const void *sp);
@@ -466,12 +629,190 @@ mt_lnode_t *mt_sp_last_leaf(void *sp);
 /* Find the page leaf containing `key` in a superpage (for iterator seek). */
 mt_lnode_t *mt_sp_find_leaf(void *sp, int32_t key);
 
+/* Child index to follow for `key` in a page-level internal node. */
+int         mt_sp_inode_search(const mt_sp_inode_t *node, int32_t key);
+
 /* ── Arena allocator (arena.c) ─────────────────────────────── */
 
 mt_allocator_t *mt_allocator_create(size_t arena_size, size_t page_size);
 void            mt_allocator_destroy(mt_allocator_t *alloc);
 void           *mt_allocator_alloc(mt_allocator_t *alloc);
 void            mt_allocator_free(mt_allocator_t *alloc, void *ptr);
+void            mt_allocator_reset(mt_allocator_t *alloc);
+
+/* ── Access sampling (heatmap.c) ───────────────────────────── */
+
+void mt_heat_sample(const matryoshka_tree_t *tree, const void *leaf,
+                    int32_t key, bool write);
+void mt_heat_destroy(struct mt_heat *heat);
+
+#ifndef __cplusplus
+/* Per-thread countdown to the next sample, shared by all trees. */
+extern _Thread_local int32_t mt_heat_countdown;
+
+/* Note an operation that reached `leaf` (page or superpage) for `key`.
+   With sampling off this is one predictable branch. */
+static inline void mt_heat_note(const matryoshka_tree_t *tree,
+                                const void *leaf, int32_t key, bool write)
+{
+    if (__builtin_expect(tree->heat != NULL, 0) &&
+        __builtin_expect(--mt_heat_countdown <= 0, 0))
+        mt_heat_sample(tree, leaf, key, write);
+}
+#endif
+
+/* ── Sorting (sort.c) ──────────────────────────────────────── */
+
+/* Sort keys ascending in place without allocating. */
+void mt_sort_keys(int32_t *keys, size_t n);
+
+/* ── Tree images (build.c, image.c) ────────────────────────── */
+/*
+ * An image is a tree laid out in a file.  Every pointer (outer child
+ * references, page and superpage prev/next) is stored as a byte offset
+ * from the start of the file, 0 for NULL; leaf child references keep
+ * their tag bits.  Leaves follow the header in key order from
+ * leaf_off, each at a multiple of leaf_alloc, then the internal nodes
+ * from inode_off.  Byte order and struct layout are the host's:
+ * version and header_size reject foreign images.
+ */
+#define MT_IMAGE_MAGIC    "MTRYIMG"
+#define MT_IMAGE_VERSION  1
+
+typedef struct mt_image_header {
+    char           magic[8];      /* MT_IMAGE_MAGIC */
+    uint32_t       version;       /* MT_IMAGE_VERSION */
+    uint32_t       header_size;   /* sizeof(mt_image_header_t) */
+    uint64_t       n;             /* keys */
+    uint64_t       nleaves;       /* pages, or superpages */
+    uint64_t       ninodes;       /* outer internal nodes */
+    uint64_t       leaf_off;      /* first leaf */
+    uint64_t       inode_off;     /* first internal node */
+    uint64_t       root;          /* root node offset (untagged) */
+    int32_t        height;        /* outer tree height */
+    uint32_t       _pad;
+    mt_hierarchy_t hier;
+} mt_image_header_t;
+
+MT_STATIC_ASSERT(sizeof(mt_image_header_t) <= MT_PAGE_SIZE,
+               "mt_image_header_t must fit in the first page");
+
+/* A read-only mapping of an image (matryoshka_image_attach). */
+struct matryoshka_image {
+    const uint8_t           *base;
+    size_t                   len;
+    const mt_image_header_t *ih;     /* == base */
+};
+
+/* Control page of a publication (publish.c), shared by the writer and
+   every reader.  seq is a seqlock over the fields after it: odd while
+   the writer is switching versions. */
+#define MT_PUB_MAGIC  "MTRYPUB"
+
+typedef struct mt_pub_ctl {
+    char      magic[8];      /* MT_PUB_MAGIC */
+    uint64_t  seq;
+    uint64_t  generation;    /* current image: <prefix>.<generation>.img */
+    uint64_t  n;             /* its key count */
+} mt_pub_ctl_t;
+
+/* pread/pwrite of exactly len bytes, retrying short transfers.  A read
+   past the end of the file fails with EIO. */
+bool mt_read_at(int fd, void *buf, size_t len, uint64_t off);
+bool mt_write_at(int fd, const void *buf, size_t len, uint64_t off);
+
+/* mt_page_bulk_load with an explicit colour, for pages built away from
+   the address they will be placed at. */
+void mt_page_bulk_load_color(mt_lnode_t *page, uint8_t color,
+                             const int32_t *sorted_keys, int nkeys,
+                             const mt_hierarchy_t *hier);
+
+/* Make an empty tree hold pages[0..npages), page leaves built with the
+   tree's allocator and hierarchy, in key order; min_keys[i] is the
+   smallest key of pages[i] and n the total.  Links the pages and builds
+   the internal levels.  Returns false, tree unchanged, if out of memory. */
+bool mt_tree_adopt_pages(matryoshka_tree_t *tree, mt_node_t **pages,
+                         const int32_t *min_keys, size_t npages, size_t n);
+
+/* ── Portable export (export.c) ────────────────────────────── */
+/*
+ * An export holds only keys: one block per leaf page in key order,
+ * each delta-coded and bit-packed (see export.c), then an index of the
+ * blocks.  It has no pointers and no page layout, so it reads back into
+ * any hierarchy.  Every field is little-endian.
+ */
+#define MT_EXPORT_MAGIC      "MTRYEXP"
+#define MT_EXPORT_VERSION    1
+#define MT_EXPORT_GROUP      128    /* keys per bit-packed group */
+#define MT_EXPORT_BLOCK_MAX  1024   /* keys per block (a page holds <= 945) */
+
+typedef struct mt_export_header {
+    char     magic[8];        /* MT_EXPORT_MAGIC */
+    uint32_t version;         /* MT_EXPORT_VERSION */
+    uint32_t header_size;     /* sizeof(mt_export_header_t) */
+    uint64_t n;               /* keys */
+    uint64_t nblocks;
+    uint64_t index_off;       /* mt_export_block_t[nblocks] */
+    uint8_t  cl_strategy;     /* of the exporting tree, for import with */
+    uint8_t  superpages;      /*   no hierarchy given */
+    uint8_t  flags;           /* MT_EXPORT_F_* */
+    uint8_t  _pad[5];
+} mt_export_header_t;
+
+#define MT_EXPORT_F_COLOR     0x01
+#define MT_EXPORT_F_COMPRESS  0x02
+#define MT_EXPORT_F_TIGHT     0x04
+
+typedef struct mt_export_block {
+    uint64_t off;             /* from the start of the file */
+    uint32_t nkeys;
+    int32_t  first;           /* smallest key */
+} mt_export_block_t;
+
+/* ── Transactions (txn.c) ─────────────────────────────────── */
+
+void mt_txn_domain_destroy(struct mt_txn_domain *dom);
+
+/* ── Explain (explain.c) ───────────────────────────────────── */
+
+#define MT_EXPLAIN_MAX_LINES 128
+
+/* State of one matryoshka_explain walk.  Each module explains its own
+   search kernels: it times the kernel, opens a step, then touches the
+   bytes the kernel reads so the line count lands on that step. */
+typedef struct mt_explain_ctx {
+    matryoshka_explain_t      *out;
+    matryoshka_explain_step_t *cur;       /* open step, NULL if dropped */
+    uint64_t                   overhead;  /* cost of an empty timing */
+    int                        nlines;
+    uintptr_t                  lines[MT_EXPLAIN_MAX_LINES];
+} mt_explain_ctx_t;
+
+/* TSC read, fenced so the kernel between two reads is not reordered
+   around them. */
+static inline uint64_t mt_explain_clock(void)
+{
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+uint64_t mt_explain_since(const mt_explain_ctx_t *x, uint64_t t0);
+void     mt_explain_step(mt_explain_ctx_t *x, matryoshka_step_kind_t kind,
+                         matryoshka_step_path_t path, const void *node,
+                         int slot, int idx, uint64_t cycles);
+void     mt_explain_touch(mt_explain_ctx_t *x, const void *p, size_t len);
+int32_t  mt_explain_prev_page(mt_explain_ctx_t *x, const mt_lnode_t *page);
+
+void mt_inode_explain(const mt_inode_t *node, int32_t key, int idx,
+                      mt_explain_ctx_t *x);
+bool mt_page_explain(const mt_lnode_t *page, int32_t key, int32_t *result,
+                     mt_explain_ctx_t *x);
+void mt_page_touch_max(const mt_lnode_t *page, mt_explain_ctx_t *x);
+bool mt_sp_explain(const void *sp, int32_t key, int32_t *result,
+                   mt_explain_ctx_t *x);
+int32_t mt_sp_explain_max(const void *sp, mt_explain_ctx_t *x);
 
 #ifdef __cplusplus
 }
@@ -19,7 +19,7 @@ mt_node_t *mt_alloc_inode(void)
     return (mt_node_t *)p;
 }
 
-mt_node_t *mt_alloc_lnode(const mt_hierarchy_t *hier, mt_allocator_t *alloc)
+mt_node_t *mt_alloc_lnode_raw(const mt_hierarchy_t *hier, mt_allocator_t *alloc)
 {
     size_t alloc_size = hier->leaf_alloc;
     void *p = NULL;
@@ -31,11 +31,16 @@ mt_node_t *mt_alloc_lnode(const mt_hierarchy_t *hier, mt_allocator_t *alloc)
         if (posix_memalign(&p, align, alloc_size) != 0)
             return NULL;
     }
+    return (mt_node_t *)p;
+}
 
+mt_node_t *mt_alloc_lnode(const mt_hierarchy_t *hier, mt_allocator_t *alloc)
+{
+    mt_node_t *p = mt_alloc_lnode_raw(hier, alloc);
     if (!p) return NULL;
-    memset(p, 0, alloc_size);
-    ((mt_lnode_t *)p)->header.type = MT_NODE_LEAF;
-    return (mt_node_t *)p;
+    memset(p, 0, hier->leaf_alloc);
+    p->lnode.header.type = MT_NODE_LEAF;
+    return p;
 }
 
 void mt_free_inode(mt_node_t *node)
@@ -21,7 +21,8 @@
 
 /* ── Arena allocation ──────────────────────────────────────────── */
 
-static mt_arena_t *arena_create(size_t arena_size, size_t page_size)
+static mt_arena_t *arena_create(size_t arena_size, size_t page_size,
+                                uint32_t epoch)
 {
     /* Allocate the arena metadata. */
     int num_pages = (int)(arena_size / page_size);
@@ -69,10 +70,12 @@ static mt_arena_t *arena_create(size_t arena_size, size_t page_size)
     arena->size = arena_size;
     arena->page_size = page_size;
     arena->num_pages = num_pages;
+    arena->epoch = epoch;
     arena->bitmap = (uint64_t *)((char *)arena + sizeof(mt_arena_t));
     memset(arena->bitmap, 0, (size_t)bitmap_words * sizeof(uint64_t));
     arena->next = NULL;
 
+    MT_PROBE4(arena_create, base, arena_size, page_size, (int)arena->is_mmap);
     return arena;
 }
 
@@ -105,8 +108,16 @@ static int arena_find_free(mt_arena_t *arena)
     return -1;
 }
 
-static void *arena_alloc_page(mt_arena_t *arena)
+static void *arena_alloc_page(mt_arena_t *arena, uint32_t epoch)
 {
+    /* First use since mt_allocator_reset: every page is free again.
+       Pages are zeroed by mt_alloc_lnode as they are handed out. */
+    if (arena->epoch != epoch) {
+        memset(arena->bitmap, 0,
+               (size_t)((arena->num_pages + 63) / 64) * sizeof(uint64_t));
+        arena->epoch = epoch;
+    }
+
     int idx = arena_find_free(arena);
     if (idx < 0) return NULL;
 
@@ -139,6 +150,7 @@ mt_allocator_t *mt_allocator_create(size_t arena_size, size_t page_size)
     alloc->arenas = NULL;
     alloc->arena_size = arena_size;
     alloc->page_size = page_size;
+    alloc->epoch = 0;
     return alloc;
 }
 
@@ -159,18 +171,19 @@ void *mt_allocator_alloc(mt_allocator_t *alloc)
     /* Try existing arenas first. */
     mt_arena_t *a = alloc->arenas;
     while (a) {
-        void *p = arena_alloc_page(a);
+        void *p = arena_alloc_page(a, alloc->epoch);
         if (p) return p;
         a = a->next;
     }
 
     /* Create a new arena. */
-    mt_arena_t *na = arena_create(alloc->arena_size, alloc->page_size);
+    mt_arena_t *na = arena_create(alloc->arena_size, alloc->page_size,
+                                  alloc->epoch);
     if (!na) return NULL;
     na->next = alloc->arenas;
     alloc->arenas = na;
 
-    return arena_alloc_page(na);
+    return arena_alloc_page(na, alloc->epoch);
 }
 
 void mt_allocator_free(mt_allocator_t *alloc, void *ptr)
@@ -179,10 +192,18 @@ void mt_allocator_free(mt_allocator_t *alloc, void *ptr)
     mt_arena_t *a = alloc->arenas;
     while (a) {
         if (arena_contains(a, ptr)) {
-            arena_free_page(a, ptr);
+            if (a->epoch == alloc->epoch)
+                arena_free_page(a, ptr);
             return;
         }
         a = a->next;
     }
     /* Pointer not from any arena — should not happen. */
 }
+
+/* Mark every page of every arena free, keeping the arenas mapped.  The
+   bitmaps are cleared lazily, on each arena's next allocation. */
+void mt_allocator_reset(mt_allocator_t *alloc)
+{
+    if (alloc) alloc->epoch++;
+}
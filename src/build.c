@@ -0,0 +1,685 @@
+/*
+ * build.c — Offline image builder: unsorted key file to tree image.
+ *
+ * Two passes over the keys, both spread over the worker threads.
+ *
+ * Run generation: each thread claims chunks of mem_bytes / threads keys,
+ * sorts and deduplicates them with mt_sort_keys and writes each back to
+ * its own slot of one unlinked run file.
+ *
+ * Merge: the calling thread merges the runs through a heap, reading
+ * each through a small buffer, and cuts the deduplicated stream into
+ * leaves of page_max_keys (sp_max_keys) keys, the last two sharing what
+ * is left so neither is under half full.  Since every leaf has the same
+ * size, a leaf's place in the image is fixed by its index, so the
+ * workers build leaves in private buffers, rewrite their pointers as
+ * file offsets and write them in any order.  The internal nodes are
+ * built last from the leaves' minimum keys, and the header is written
+ * after everything else, so an interrupted build leaves no valid image.
+ */
+
+#include "matryoshka_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BUILD_DEFAULT_MEM  ((size_t)256 << 20)
+#define BUILD_MIN_CHUNK    ((size_t)1024)   /* keys per run, at least */
+#define BUILD_MIN_RUN_BUF  ((size_t)4096)   /* keys per merge buffer, at least */
+
+/* ── I/O ───────────────────────────────────────────────────── */
+
+bool mt_read_at(int fd, void *buf, size_t len, uint64_t off)
+{
+    char *p = buf;
+    while (len > 0) {
+        ssize_t r = pread(fd, p, len, (off_t)off);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0) {
+            if (r == 0) errno = EIO;   /* file shorter than expected */
+            return false;
+        }
+        p += r;
+        len -= (size_t)r;
+        off += (uint64_t)r;
+    }
+    return true;
+}
+
+bool mt_write_at(int fd, const void *buf, size_t len, uint64_t off)
+{
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t w = pwrite(fd, p, len, (off_t)off);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0) {
+            if (w == 0) errno = EIO;
+            return false;
+        }
+        p += w;
+        len -= (size_t)w;
+        off += (uint64_t)w;
+    }
+    return true;
+}
+
+/* ── Build state ───────────────────────────────────────────── */
+
+enum { JOB_FREE, JOB_READY, JOB_BUSY, JOB_DONE };
+
+/* One leaf in flight between the merge and a worker. */
+typedef struct {
+    int32_t  *keys;
+    int       nkeys;
+    int       state;
+    bool      last;
+    uint64_t  idx;     /* leaf index */
+    uint32_t  info;    /* page: tag bits; superpage: first | last page << 16 */
+} build_job_t;
+
+typedef struct {
+    const mt_hierarchy_t *hier;
+    int        in_fd, run_fd, out_fd;
+    int        err;           /* first errno, 0 while all is well */
+
+    /* Run generation. */
+    size_t     nkeys_in;
+    size_t     chunk;         /* keys per run */
+    size_t     nruns;
+    size_t    *run_len;       /* unique keys in each run */
+    size_t     next_run;
+
+    /* Leaf building. */
+    uint64_t   leaf_off;
+    size_t     leaf_alloc;
+    int        leaf_max;      /* keys per full leaf */
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;    /* a job became READY, or closing */
+    pthread_cond_t  done;     /* a job became DONE */
+    build_job_t *jobs;
+    int        njobs;
+    bool       closing;
+
+    /* Per leaf, owned by the merging thread. */
+    uint64_t   nleaves;
+    size_t     leaf_cap;
+    int32_t   *seps;          /* minimum key */
+    uint32_t  *info;          /* build_job_t.info */
+} build_t;
+
+static void build_fail(build_t *b, int err)
+{
+    int expected = 0;
+    __atomic_compare_exchange_n(&b->err, &expected, err ? err : EIO, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static bool build_failed(build_t *b)
+{
+    return __atomic_load_n(&b->err, __ATOMIC_RELAXED) != 0;
+}
+
+/* ── Run generation ────────────────────────────────────────── */
+
+static size_t dedup_sorted(int32_t *keys, size_t n)
+{
+    if (n == 0) return 0;
+    size_t u = 1;
+    for (size_t i = 1; i < n; i++)
+        if (keys[i] != keys[u - 1])
+            keys[u++] = keys[i];
+    return u;
+}
+
+static void *run_worker(void *arg)
+{
+    build_t *b = arg;
+    int32_t *buf = malloc(b->chunk * sizeof(int32_t));
+    if (!buf) {
+        build_fail(b, ENOMEM);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t r = __atomic_fetch_add(&b->next_run, 1, __ATOMIC_RELAXED);
+        if (r >= b->nruns || build_failed(b))
+            break;
+        size_t start = r * b->chunk;
+        size_t k = b->nkeys_in - start < b->chunk ? b->nkeys_in - start
+                                                  : b->chunk;
+        uint64_t off = (uint64_t)start * sizeof(int32_t);
+        if (!mt_read_at(b->in_fd, buf, k * sizeof(int32_t), off)) {
+            build_fail(b, errno);
+            break;
+        }
+        mt_sort_keys(buf, k);
+        k = dedup_sorted(buf, k);
+        if (!mt_write_at(b->run_fd, buf, k * sizeof(int32_t), off)) {
+            build_fail(b, errno);
+            break;
+        }
+        b->run_len[r] = k;
+    }
+    free(buf);
+    return NULL;
+}
+
+/* ── Leaf building ─────────────────────────────────────────── */
+
+static inline void *off_ptr(uint64_t off)
+{
+    return (void *)(uintptr_t)off;
+}
+
+/* Build superpage leaf `job` in buf at image offset `off`, rewriting
+   its page links as offsets.  Links to the neighbouring superpages'
+   pages are patched once every leaf is written (patch_sp_links). */
+static void build_sp(build_t *b, build_job_t *job, void *buf, uint64_t off)
+{
+    mt_sp_bulk_load(buf, job->keys, job->nkeys, b->hier);
+    mt_sp_header_t *hdr = buf;
+    hdr->prev = job->idx > 0 ? off_ptr(off - b->leaf_alloc) : NULL;
+    hdr->next = job->last ? NULL : off_ptr(off + b->leaf_alloc);
+
+    mt_lnode_t *first = mt_sp_first_leaf(buf);
+    mt_lnode_t *last = mt_sp_last_leaf(buf);
+    for (mt_lnode_t *page = first, *next; page; page = next) {
+        next = page->header.next;
+        mt_lnode_t *prev = page->header.prev;
+        page->header.prev = prev
+            ? off_ptr(off + (uint64_t)((char *)prev - (char *)buf)) : NULL;
+        page->header.next = next
+            ? off_ptr(off + (uint64_t)((char *)next - (char *)buf)) : NULL;
+    }
+    uint32_t fi = (uint32_t)(((char *)first - (char *)buf) / MT_PAGE_SIZE);
+    uint32_t li = (uint32_t)(((char *)last - (char *)buf) / MT_PAGE_SIZE);
+    job->info = fi | li << 16;
+}
+
+static void build_page(build_t *b, build_job_t *job, void *buf, uint64_t off)
+{
+    mt_lnode_t *page = buf;
+    uint8_t color = b->hier->color_pages ? mt_page_color_for(off_ptr(off)) : 0;
+    mt_page_bulk_load_color(page, color, job->keys, job->nkeys, b->hier);
+    page->header.prev = job->idx > 0 ? off_ptr(off - b->leaf_alloc) : NULL;
+    page->header.next = job->last ? NULL : off_ptr(off + b->leaf_alloc);
+    job->info = (uint32_t)((uintptr_t)mt_tag_leaf_ptr(buf) & MT_PTR_TAG_MASK);
+}
+
+static void *leaf_worker(void *arg)
+{
+    build_t *b = arg;
+    void *buf = NULL;
+    if (posix_memalign(&buf, b->leaf_alloc, b->leaf_alloc) != 0) {
+        build_fail(b, ENOMEM);
+        buf = NULL;
+    } else {
+        memset(buf, 0, b->leaf_alloc);
+    }
+
+    pthread_mutex_lock(&b->lock);
+    for (;;) {
+        build_job_t *job = NULL;
+        for (int j = 0; j < b->njobs && !job; j++)
+            if (b->jobs[j].state == JOB_READY)
+                job = &b->jobs[j];
+        if (!job) {
+            if (b->closing)
+                break;
+            pthread_cond_wait(&b->ready, &b->lock);
+            continue;
+        }
+        job->state = JOB_BUSY;
+        pthread_mutex_unlock(&b->lock);
+
+        if (buf && !build_failed(b)) {
+            uint64_t off = b->leaf_off + job->idx * b->leaf_alloc;
+            if (b->hier->use_superpages)
+                build_sp(b, job, buf, off);
+            else
+                build_page(b, job, buf, off);
+            if (!mt_write_at(b->out_fd, buf, b->leaf_alloc, off))
+                build_fail(b, errno);
+        }
+
+        pthread_mutex_lock(&b->lock);
+        job->state = JOB_DONE;
+        pthread_cond_broadcast(&b->done);
+    }
+    pthread_mutex_unlock(&b->lock);
+    free(buf);
+    return NULL;
+}
+
+/* Record finished jobs and free their slots.  Called with the lock. */
+static void harvest(build_t *b)
+{
+    for (int j = 0; j < b->njobs; j++) {
+        build_job_t *job = &b->jobs[j];
+        if (job->state == JOB_DONE) {
+            b->info[job->idx] = job->info;
+            job->state = JOB_FREE;
+        }
+    }
+}
+
+/* Hand one leaf's keys to the workers. */
+static bool emit_leaf(build_t *b, const int32_t *keys, int n, bool last)
+{
+    if (b->nleaves == b->leaf_cap) {
+        size_t cap = b->leaf_cap ? 2 * b->leaf_cap : 1024;
+        int32_t *seps = realloc(b->seps, cap * sizeof(int32_t));
+        if (seps) b->seps = seps;
+        uint32_t *info = realloc(b->info, cap * sizeof(uint32_t));
+        if (info) b->info = info;
+        if (!seps || !info) {
+            build_fail(b, ENOMEM);
+            return false;
+        }
+        b->leaf_cap = cap;
+    }
+
+    pthread_mutex_lock(&b->lock);
+    build_job_t *job;
+    for (;;) {
+        harvest(b);
+        job = NULL;
+        for (int j = 0; j < b->njobs && !job; j++)
+            if (b->jobs[j].state == JOB_FREE)
+                job = &b->jobs[j];
+        if (job)
+            break;
+        pthread_cond_wait(&b->done, &b->lock);
+    }
+    memcpy(job->keys, keys, (size_t)n * sizeof(int32_t));
+    job->nkeys = n;
+    job->last = last;
+    job->idx = b->nleaves;
+    job->state = JOB_READY;
+    b->seps[b->nleaves++] = n > 0 ? keys[0] : 0;
+    pthread_cond_signal(&b->ready);
+    pthread_mutex_unlock(&b->lock);
+    return !build_failed(b);
+}
+
+/* Wait for the workers to drain the queue, then let them exit. */
+static void close_jobs(build_t *b)
+{
+    pthread_mutex_lock(&b->lock);
+    b->closing = true;
+    pthread_cond_broadcast(&b->ready);
+    for (;;) {
+        harvest(b);
+        bool busy = false;
+        for (int j = 0; j < b->njobs; j++)
+            busy |= b->jobs[j].state != JOB_FREE;
+        if (!busy)
+            break;
+        pthread_cond_wait(&b->done, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* ── Merge ─────────────────────────────────────────────────── */
+
+typedef struct {
+    int32_t  *buf;
+    size_t    pos, len;     /* buffered keys [pos, len) */
+    uint64_t  off, end;     /* run bytes not yet buffered */
+} run_t;
+
+typedef struct {
+    int32_t   key;
+    uint32_t  run;
+} heap_ent_t;
+
+/* Refill a run's buffer.  Returns false at the end of the run. */
+static bool run_fill(build_t *b, run_t *r, size_t cap)
+{
+    size_t k = (size_t)(r->end - r->off) / sizeof(int32_t);
+    if (k > cap) k = cap;
+    if (k == 0)
+        return false;
+    if (!mt_read_at(b->run_fd, r->buf, k * sizeof(int32_t), r->off)) {
+        build_fail(b, errno);
+        return false;
+    }
+    r->off += k * sizeof(int32_t);
+    r->pos = 0;
+    r->len = k;
+    return true;
+}
+
+static void heap_down(heap_ent_t *h, size_t n, size_t i)
+{
+    heap_ent_t x = h[i];
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && h[c + 1].key < h[c].key) c++;
+        if (h[c].key >= x.key) break;
+        h[i] = h[c];
+        i = c;
+    }
+    h[i] = x;
+}
+
+/* Merge the runs into leaves.  Keys are collected in `pending` (two
+   leaves' worth) so the last two leaves can split what remains. */
+static bool merge_runs(build_t *b, size_t mem_keys, uint64_t *n_out)
+{
+    size_t nr = b->nruns;
+    size_t cap = nr ? mem_keys / 2 / nr : 0;
+    if (cap < BUILD_MIN_RUN_BUF) cap = BUILD_MIN_RUN_BUF;
+    size_t max = (size_t)b->leaf_max;
+
+    run_t *runs = calloc(nr ? nr : 1, sizeof(run_t));
+    heap_ent_t *heap = malloc((nr ? nr : 1) * sizeof(heap_ent_t));
+    int32_t *pending = malloc(2 * max * sizeof(int32_t));
+    int32_t *bufs = malloc((nr ? nr : 1) * cap * sizeof(int32_t));
+    bool ok = runs && heap && pending && bufs;
+    if (!ok)
+        build_fail(b, ENOMEM);
+
+    size_t hn = 0;
+    for (size_t i = 0; ok && i < nr; i++) {
+        run_t *r = &runs[i];
+        r->buf = bufs + i * cap;
+        r->off = (uint64_t)i * b->chunk * sizeof(int32_t);
+        r->end = r->off + b->run_len[i] * sizeof(int32_t);
+        if (run_fill(b, r, cap))
+            heap[hn++] = (heap_ent_t){ r->buf[0], (uint32_t)i };
+    }
+    for (size_t i = hn / 2; i-- > 0; )
+        heap_down(heap, hn, i);
+
+    uint64_t n = 0;
+    size_t np = 0;
+    while (ok && hn > 0) {
+        int32_t k = heap[0].key;
+        if (np == 0 || k != pending[np - 1]) {
+            pending[np++] = k;
+            n++;
+            if (np == 2 * max) {
+                if (!emit_leaf(b, pending, (int)max, false))
+                    break;
+                memcpy(pending, pending + max, max * sizeof(int32_t));
+                np = max;
+            }
+        }
+        run_t *r = &runs[heap[0].run];
+        if (++r->pos < r->len || run_fill(b, r, cap))
+            heap[0].key = r->buf[r->pos];
+        else
+            heap[0] = heap[--hn];
+        if (hn > 0)
+            heap_down(heap, hn, 0);
+    }
+
+    if (ok && !build_failed(b)) {
+        if (np > max) {
+            size_t left = np / 2;
+            if (emit_leaf(b, pending, (int)left, false))
+                emit_leaf(b, pending + left, (int)(np - left), true);
+        } else {
+            emit_leaf(b, pending, (int)np, true);
+        }
+    }
+
+    free(bufs);
+    free(pending);
+    free(heap);
+    free(runs);
+    *n_out = n;
+    return !build_failed(b);
+}
+
+/* ── Image assembly ────────────────────────────────────────── */
+
+/* Point the boundary pages of adjacent superpages at each other. */
+static bool patch_sp_links(build_t *b)
+{
+    for (uint64_t i = 1; i < b->nleaves; i++) {
+        uint64_t left = b->leaf_off + (i - 1) * b->leaf_alloc
+                      + (uint64_t)(b->info[i - 1] >> 16) * MT_PAGE_SIZE;
+        uint64_t right = b->leaf_off + i * b->leaf_alloc
+                       + (uint64_t)(b->info[i] & 0xFFFF) * MT_PAGE_SIZE;
+        if (!mt_write_at(b->out_fd, &right, sizeof(right),
+                         left + offsetof(mt_page_header_t, next)) ||
+            !mt_write_at(b->out_fd, &left, sizeof(left),
+                         right + offsetof(mt_page_header_t, prev)))
+            return false;
+    }
+    return true;
+}
+
+/* Build the internal levels bottom-up over the leaves, as
+   matryoshka_bulk_load does, writing each node as it is filled.
+   Parent p reads only children at or after p, so each level replaces
+   the one below in child[] and seps[]. */
+static bool write_inodes(build_t *b, mt_image_header_t *ih)
+{
+    uint64_t count = b->nleaves;
+    uint64_t *child = malloc(count * sizeof(uint64_t));
+    mt_inode_t *in = NULL;
+    if (!child || posix_memalign((void **)&in, MT_PAGE_SIZE,
+                                 MT_PAGE_SIZE) != 0) {
+        free(child);
+        errno = ENOMEM;
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++)
+        child[i] = (b->leaf_off + i * b->leaf_alloc)
+                 | (b->hier->use_superpages ? 0 : b->info[i]);
+
+    uint64_t ninodes = 0;
+    int height = 0;
+    bool ok = true;
+    while (ok && count > 1) {
+        uint64_t num_parents = (count + MT_MAX_IKEYS) / (MT_MAX_IKEYS + 1);
+        uint64_t per = count / num_parents;
+        uint64_t extra = count % num_parents;
+        uint64_t ci = 0;
+        for (uint64_t p = 0; ok && p < num_parents; p++) {
+            uint64_t nc = per + (p < extra ? 1 : 0);
+            memset(in, 0, MT_PAGE_SIZE);
+            in->type = MT_NODE_INTERNAL;
+            in->children[0] = off_ptr(child[ci]);
+            for (uint64_t j = 1; j < nc; j++) {
+                in->keys[j - 1] = b->seps[ci + j];
+                in->children[j] = off_ptr(child[ci + j]);
+            }
+            in->nkeys = (uint16_t)(nc - 1);
+            if (b->hier->compress_inodes)
+                mt_inode_narrow(in);
+
+            uint64_t off = ih->inode_off + ninodes++ * MT_PAGE_SIZE;
+            ok = mt_write_at(b->out_fd, in, MT_PAGE_SIZE, off);
+            child[p] = off;
+            b->seps[p] = b->seps[ci];
+            ci += nc;
+        }
+        count = num_parents;
+        height++;
+    }
+
+    ih->ninodes = ninodes;
+    ih->height = height;
+    ih->root = child[0] & ~(uint64_t)MT_PTR_TAG_MASK;
+    free(in);
+    free(child);
+    return ok;
+}
+
+/* ── Public API ────────────────────────────────────────────── */
+
+static int build_threads(const matryoshka_build_opts_t *opts)
+{
+    if (opts && opts->threads > 0)
+        return opts->threads;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+static int open_run_file(const matryoshka_build_opts_t *opts)
+{
+    const char *dir = opts ? opts->tmp_dir : NULL;
+    if (!dir) dir = getenv("TMPDIR");
+    if (!dir) dir = "/tmp";
+
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/matryoshka-runs-XXXXXX", dir)
+        >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+bool matryoshka_build_image(const char *keys_path, const char *image_path,
+                            const mt_hierarchy_t *hier,
+                            const matryoshka_build_opts_t *opts,
+                            size_t *nkeys)
+{
+    build_t b;
+    memset(&b, 0, sizeof(b));
+    b.hier = hier;
+    b.in_fd = b.run_fd = b.out_fd = -1;
+    b.leaf_alloc = hier->leaf_alloc;
+    b.leaf_off = hier->leaf_alloc;
+    b.leaf_max = hier->use_superpages ? hier->sp_max_keys
+                                      : hier->page_max_keys;
+
+    int threads = build_threads(opts);
+    size_t mem = opts && opts->mem_bytes ? opts->mem_bytes
+                                         : BUILD_DEFAULT_MEM;
+    size_t mem_keys = mem / sizeof(int32_t);
+    pthread_t *tids = malloc((size_t)threads * sizeof(pthread_t));
+    int started = 0;
+    uint64_t n = 0;
+
+    struct stat st;
+    b.in_fd = open(keys_path, O_RDONLY);
+    if (b.in_fd < 0 || fstat(b.in_fd, &st) != 0 || !tids)
+        goto fail;
+    if (st.st_size % (off_t)sizeof(int32_t) != 0) {
+        errno = EINVAL;
+        goto fail;
+    }
+    b.nkeys_in = (size_t)st.st_size / sizeof(int32_t);
+
+    /* Run generation: one chunk per thread at a time, and at least one
+       chunk per thread when the input allows. */
+    b.chunk = mem_keys / (size_t)threads;
+    size_t even = (b.nkeys_in + (size_t)threads - 1) / (size_t)threads;
+    if (b.chunk > even) b.chunk = even;
+    if (b.chunk < BUILD_MIN_CHUNK) b.chunk = BUILD_MIN_CHUNK;
+    b.nruns = (b.nkeys_in + b.chunk - 1) / b.chunk;
+    b.run_len = calloc(b.nruns ? b.nruns : 1, sizeof(size_t));
+    b.run_fd = open_run_file(opts);
+    if (!b.run_len || b.run_fd < 0)
+        goto fail;
+
+    for (started = 0; started < threads; started++)
+        if (pthread_create(&tids[started], NULL, run_worker, &b) != 0)
+            break;
+    if (started == 0)
+        run_worker(&b);
+    while (started > 0)
+        pthread_join(tids[--started], NULL);
+    if (build_failed(&b))
+        goto fail_errno;
+
+    /* Merge into leaves built by the same number of workers. */
+    b.out_fd = open(image_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (b.out_fd < 0)
+        goto fail;
+    b.njobs = 2 * threads;
+    b.jobs = calloc((size_t)b.njobs, sizeof(build_job_t));
+    if (!b.jobs)
+        goto fail;
+    for (int j = 0; j < b.njobs; j++) {
+        b.jobs[j].keys = malloc((size_t)b.leaf_max * sizeof(int32_t));
+        if (!b.jobs[j].keys) {
+            errno = ENOMEM;
+            goto fail;
+        }
+    }
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.ready, NULL);
+    pthread_cond_init(&b.done, NULL);
+    for (started = 0; started < threads; started++)
+        if (pthread_create(&tids[started], NULL, leaf_worker, &b) != 0)
+            break;
+    if (started == 0) {
+        build_fail(&b, EAGAIN);
+    } else {
+        merge_runs(&b, mem_keys, &n);
+        close_jobs(&b);
+    }
+    while (started > 0)
+        pthread_join(tids[--started], NULL);
+    pthread_cond_destroy(&b.done);
+    pthread_cond_destroy(&b.ready);
+    pthread_mutex_destroy(&b.lock);
+    if (build_failed(&b))
+        goto fail_errno;
+
+    mt_image_header_t ih;
+    memset(&ih, 0, sizeof(ih));
+    memcpy(ih.magic, MT_IMAGE_MAGIC, sizeof(ih.magic));
+    ih.version = MT_IMAGE_VERSION;
+    ih.header_size = sizeof(ih);
+    ih.n = n;
+    ih.nleaves = b.nleaves;
+    ih.leaf_off = b.leaf_off;
+    ih.inode_off = b.leaf_off + b.nleaves * b.leaf_alloc;
+    ih.hier = *hier;
+    if ((hier->use_superpages && !patch_sp_links(&b)) ||
+        !write_inodes(&b, &ih) ||
+        !mt_write_at(b.out_fd, &ih, sizeof(ih), 0))
+        goto fail;
+
+    if (nkeys) *nkeys = (size_t)n;
+    for (int j = 0; j < b.njobs; j++)
+        free(b.jobs[j].keys);
+    free(b.jobs);
+    free(b.seps);
+    free(b.info);
+    free(b.run_len);
+    free(tids);
+    close(b.run_fd);
+    close(b.in_fd);
+    return close(b.out_fd) == 0;
+
+fail:
+    build_fail(&b, errno);
+fail_errno:
+    if (b.jobs) {
+        for (int j = 0; j < b.njobs; j++)
+            free(b.jobs[j].keys);
+        free(b.jobs);
+    }
+    free(b.seps);
+    free(b.info);
+    free(b.run_len);
+    free(tids);
+    if (b.run_fd >= 0) close(b.run_fd);
+    if (b.in_fd >= 0) close(b.in_fd);
+    if (b.out_fd >= 0) {
+        close(b.out_fd);
+        unlink(image_path);
+    }
+    errno = b.err;
+    return false;
+}
@@ -0,0 +1,134 @@
+/*
+ * explain.c — Step-by-step account of one predecessor search.
+ *
+ * matryoshka_explain repeats the walk matryoshka_search makes, one level
+ * at a time.  Each level's search kernel is timed with the TSC and the
+ * node, slot and child it chose are recorded.  Cache lines are counted
+ * from the bytes each kernel demand-reads, in its own probe order
+ * (prefetches are not counted); a line is charged to the first step
+ * that reads it.  Nothing here is on a hot path.
+ */
+
+#include "matryoshka_internal.h"
+#include <string.h>
+
+/* ── Recording ─────────────────────────────────────────────── */
+
+uint64_t mt_explain_since(const mt_explain_ctx_t *x, uint64_t t0)
+{
+    uint64_t t = mt_explain_clock() - t0;
+    return t > x->overhead ? t - x->overhead : 0;
+}
+
+void mt_explain_step(mt_explain_ctx_t *x, matryoshka_step_kind_t kind,
+                     matryoshka_step_path_t path, const void *node,
+                     int slot, int idx, uint64_t cycles)
+{
+    matryoshka_explain_t *r = x->out;
+    r->cycles += cycles;
+    if (r->nsteps == MATRYOSHKA_EXPLAIN_MAX_STEPS) {
+        x->cur = NULL;
+        return;
+    }
+    matryoshka_explain_step_t *s = &r->steps[r->nsteps++];
+    s->kind = kind;
+    s->path = path;
+    s->node = node;
+    s->slot = slot;
+    s->idx = idx;
+    s->lines = 0;
+    s->cycles = cycles;
+    x->cur = s;
+}
+
+void mt_explain_touch(mt_explain_ctx_t *x, const void *p, size_t len)
+{
+    if (len == 0) return;
+    uintptr_t first = (uintptr_t)p & ~(uintptr_t)(MT_CL_SIZE - 1);
+    uintptr_t last = ((uintptr_t)p + len - 1) & ~(uintptr_t)(MT_CL_SIZE - 1);
+
+    for (uintptr_t line = first; line <= last; line += MT_CL_SIZE) {
+        bool seen = false;
+        for (int i = 0; i < x->nlines; i++)
+            if (x->lines[i] == line) { seen = true; break; }
+        if (seen) continue;
+        if (x->nlines < MT_EXPLAIN_MAX_LINES)
+            x->lines[x->nlines++] = line;
+        x->out->lines++;
+        if (x->cur) x->cur->lines++;
+    }
+}
+
+/* Fallback to the previous leaf page's maximum. */
+int32_t mt_explain_prev_page(mt_explain_ctx_t *x, const mt_lnode_t *page)
+{
+    uint64_t t = mt_explain_clock();
+    int32_t max = mt_page_max_key(page);
+    t = mt_explain_since(x, t);
+    mt_explain_step(x, MATRYOSHKA_STEP_PREV_LEAF, MATRYOSHKA_PATH_SEARCH,
+                    page, -1, -1, t);
+    mt_page_touch_max(page, x);
+    x->out->prev_leaf = true;
+    return max;
+}
+
+/* Cheapest of a few back-to-back clock pairs: what a step costs when
+   the kernel between them does nothing. */
+static uint64_t clock_overhead(void)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 16; i++) {
+        uint64_t t0 = mt_explain_clock();
+        uint64_t t = mt_explain_clock() - t0;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+/* ── Public API ────────────────────────────────────────────── */
+
+bool matryoshka_explain(const matryoshka_tree_t *tree, int32_t key,
+                        matryoshka_explain_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->key = key;
+    if (!tree || tree->n == 0)
+        return false;
+
+    mt_explain_ctx_t x = { .out = out, .overhead = clock_overhead() };
+
+    mt_node_t *node = tree->root;
+    for (int i = 0; i < tree->height; i++) {
+        const mt_inode_t *in = &node->inode;
+        uint64_t t = mt_explain_clock();
+        int idx = mt_inode_search(in, key);
+        t = mt_explain_since(&x, t);
+        mt_explain_step(&x, MATRYOSHKA_STEP_INODE, MATRYOSHKA_PATH_SEARCH,
+                        in, -1, idx, t);
+        mt_inode_explain(in, key, idx, &x);
+        node = mt_untag(in->children[idx]);
+    }
+
+    int32_t result = 0;
+    bool found;
+    if (tree->hier.use_superpages) {
+        found = mt_sp_explain(node, key, &result, &x);
+        const mt_sp_header_t *sp = (const mt_sp_header_t *)node;
+        if (!found && sp->prev && sp->prev->nkeys > 0) {
+            result = mt_sp_explain_max(sp->prev, &x);
+            found = true;
+        }
+    } else {
+        const mt_lnode_t *leaf = &node->lnode;
+        found = mt_page_explain(leaf, key, &result, &x);
+        if (!found && leaf->header.prev &&
+            leaf->header.prev->header.nkeys > 0) {
+            result = mt_explain_prev_page(&x, leaf->header.prev);
+            found = true;
+        }
+    }
+
+    out->found = found;
+    out->result = found ? result : 0;
+    return found;
+}
@@ -0,0 +1,533 @@
+/*
+ * export.c — Compact portable export and parallel import.
+ *
+ * An export is the tree's keys, one block per leaf page in key order:
+ *
+ *   u32 nkeys, i32 first, u8 width[G], then G bit-packed groups
+ *
+ * where G = ceil(nkeys / 128).  Keys are coded as differences from the
+ * key four places back (the first four from `first`), so each run of
+ * four decodes with one vector add, and each group of 128 differences
+ * is packed at the width of its largest in the vertical 4-lane layout
+ * of SIMD-BP128: lane l of the group's 32-bit words holds differences
+ * l, l + 4, l + 8, ... one after another, low bits first.  A group of
+ * width w takes 16 w bytes; the last is padded with zero differences.
+ *
+ * Import maps the file, checks the index, and hands the blocks to
+ * worker threads.  Each decodes a block with SSE2 shifts and masks into
+ * a buffer on its stack and bulk-loads it straight into pages placed
+ * beforehand, so the keys never pass through a tree-sized array.
+ * Superpage trees instead copy each decoded block into one sorted array
+ * and bulk-load that, since their pages are grouped by the superpage builder.
+ */
+
+#include "matryoshka_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define EXPORT_BUF_BYTES  ((size_t)1 << 20)
+#define IMPORT_CHUNK      64      /* blocks claimed at a time */
+
+/* Largest encoded block: header, widths, groups at width 32. */
+#define EXPORT_BLOCK_BYTES \
+    (8 + MT_EXPORT_BLOCK_MAX / MT_EXPORT_GROUP + 4 * MT_EXPORT_BLOCK_MAX)
+
+/* ── Block coding ──────────────────────────────────────────── */
+
+static inline int bit_width(uint32_t x)
+{
+    return x ? 32 - __builtin_clz(x) : 0;
+}
+
+/* Pack 128 differences at width w into 4 w words. */
+static void pack_group(const uint32_t *d, int w, uint32_t *out)
+{
+    memset(out, 0, (size_t)16 * w);
+    for (int l = 0; l < 4; l++) {
+        int bit = 0;
+        for (int r = 0; r < 32; r++, bit += w) {
+            uint64_t x = d[4 * r + l];
+            int wi = bit / 32, sh = bit % 32;
+            out[4 * wi + l] |= (uint32_t)(x << sh);
+            if (sh + w > 32)
+                out[4 * (wi + 1) + l] |= (uint32_t)(x >> (32 - sh));
+        }
+    }
+}
+
+/* Encode sorted keys[0..n), 0 < n <= MT_EXPORT_BLOCK_MAX, into out.
+   Returns the bytes written. */
+static size_t encode_block(const int32_t *keys, int n, uint8_t *out)
+{
+    int ngroups = (n + MT_EXPORT_GROUP - 1) / MT_EXPORT_GROUP;
+    uint32_t nk = (uint32_t)n;
+    memcpy(out, &nk, 4);
+    memcpy(out + 4, &keys[0], 4);
+    uint8_t *widths = out + 8;
+    uint8_t *p = widths + ngroups;
+
+    uint32_t d[MT_EXPORT_GROUP];
+    uint32_t words[4 * 32];
+    for (int g = 0; g < ngroups; g++) {
+        uint32_t all = 0;
+        for (int j = 0; j < MT_EXPORT_GROUP; j++) {
+            int i = g * MT_EXPORT_GROUP + j;
+            int32_t ref = (i < 4) ? keys[0] : keys[i - 4];
+            d[j] = (i < n) ? (uint32_t)keys[i] - (uint32_t)ref : 0;
+            all |= d[j];
+        }
+        int w = bit_width(all);
+        widths[g] = (uint8_t)w;
+        pack_group(d, w, words);
+        memcpy(p, words, (size_t)16 * w);
+        p += (size_t)16 * w;
+    }
+    return (size_t)(p - out);
+}
+
+/* Unpack one group of width w from `in` onto the running sums `cur`,
+   storing 128 keys at out.  Returns the end of the group. */
+static const uint8_t *unpack_group(const uint8_t *in, int w, __m128i *cur,
+                                   int32_t *out)
+{
+    __m128i acc = *cur;
+    if (w == 0) {
+        for (int r = 0; r < 32; r++)
+            _mm_storeu_si128((__m128i *)(out + 4 * r), acc);
+        return in;
+    }
+    const __m128i mask = _mm_set1_epi32(w == 32 ? -1 : (int)((1u << w) - 1));
+    const __m128i *src = (const __m128i *)in;
+    __m128i word = _mm_loadu_si128(src++);
+    int sh = 0;
+    for (int r = 0; r < 32; r++) {
+        __m128i v = _mm_srl_epi32(word, _mm_cvtsi32_si128(sh));
+        if (sh + w > 32) {
+            word = _mm_loadu_si128(src++);
+            v = _mm_or_si128(v, _mm_sll_epi32(word,
+                                              _mm_cvtsi32_si128(32 - sh)));
+            sh += w - 32;
+        } else if (sh + w == 32) {
+            if (r < 31)
+                word = _mm_loadu_si128(src++);
+            sh = 0;
+        } else {
+            sh += w;
+        }
+        acc = _mm_add_epi32(acc, _mm_and_si128(v, mask));
+        _mm_storeu_si128((__m128i *)(out + 4 * r), acc);
+    }
+    *cur = acc;
+    return in + (size_t)16 * w;
+}
+
+/* Decode the block at [p, end) into out (room for MT_EXPORT_BLOCK_MAX
+   keys).  Returns its key count, or -1 if it does not fit in
+   [p, end), disagrees with its index entry, or is not ascending. */
+static int decode_block(const uint8_t *p, const uint8_t *end,
+                        const mt_export_block_t *ix, int32_t *out)
+{
+    if (end - p < 8)
+        return -1;
+    uint32_t n;
+    int32_t first;
+    memcpy(&n, p, 4);
+    memcpy(&first, p + 4, 4);
+    if (n != ix->nkeys || first != ix->first || n == 0 ||
+        n > MT_EXPORT_BLOCK_MAX)
+        return -1;
+    int ngroups = ((int)n + MT_EXPORT_GROUP - 1) / MT_EXPORT_GROUP;
+    const uint8_t *widths = p + 8;
+    const uint8_t *q = widths + ngroups;
+    if (q > end)
+        return -1;
+    size_t body = 0;
+    for (int g = 0; g < ngroups; g++) {
+        if (widths[g] > 32)
+            return -1;
+        body += (size_t)16 * widths[g];
+    }
+    if ((size_t)(end - q) < body)
+        return -1;
+
+    __m128i cur = _mm_set1_epi32(first);
+    for (int g = 0; g < ngroups; g++)
+        q = unpack_group(q, widths[g], &cur, out + g * MT_EXPORT_GROUP);
+    for (uint32_t i = 1; i < n; i++)
+        if (out[i] <= out[i - 1])
+            return -1;
+    return (int)n;
+}
+
+/* ── Export ────────────────────────────────────────────────── */
+
+typedef struct {
+    int                fd;
+    uint64_t           off;        /* file offset of buf[0] */
+    uint8_t           *buf;
+    size_t             len;
+    mt_export_block_t *index;
+    size_t             nblocks, cap;
+    bool               ok;
+} export_t;
+
+static void export_flush(export_t *x)
+{
+    if (x->ok && x->len > 0)
+        x->ok = mt_write_at(x->fd, x->buf, x->len, x->off);
+    x->off += x->len;
+    x->len = 0;
+}
+
+static void export_page(export_t *x, const mt_lnode_t *page)
+{
+    int32_t keys[MT_EXPORT_BLOCK_MAX];
+    int n = mt_page_extract_sorted(page, keys);
+    if (n == 0)
+        return;
+    if (x->nblocks == x->cap) {
+        size_t cap = x->cap ? 2 * x->cap : 1024;
+        mt_export_block_t *grown = realloc(x->index, cap * sizeof(*grown));
+        if (!grown) {
+            x->ok = false;
+            errno = ENOMEM;
+            return;
+        }
+        x->index = grown;
+        x->cap = cap;
+    }
+    if (x->len + EXPORT_BLOCK_BYTES > EXPORT_BUF_BYTES)
+        export_flush(x);
+    mt_export_block_t *ix = &x->index[x->nblocks++];
+    ix->off = x->off + x->len;
+    ix->nkeys = (uint32_t)n;
+    ix->first = keys[0];
+    x->len += encode_block(keys, n, x->buf + x->len);
+}
+
+bool matryoshka_export(const matryoshka_tree_t *tree, const char *path)
+{
+    if (!tree || !path) {
+        errno = EINVAL;
+        return false;
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    export_t x = { .fd = fd, .off = sizeof(mt_export_header_t), .ok = true };
+    x.buf = malloc(EXPORT_BUF_BYTES);
+    if (!x.buf) {
+        x.ok = false;
+        errno = ENOMEM;
+    }
+
+    /* Every page leaf, superpages included, is on one chain. */
+    mt_node_t *node = tree->root;
+    for (int i = 0; i < tree->height; i++)
+        node = mt_untag(node->inode.children[0]);
+    const mt_lnode_t *page = tree->hier.use_superpages
+                             ? mt_sp_first_leaf(node) : &node->lnode;
+    for (; page && x.ok; page = page->header.next)
+        export_page(&x, page);
+
+    /* Pad so the index is 8-byte aligned in the file. */
+    while (x.ok && (x.off + x.len) % 8)
+        x.buf[x.len++] = 0;
+    export_flush(&x);
+
+    mt_export_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MT_EXPORT_MAGIC, sizeof(h.magic));
+    h.version = MT_EXPORT_VERSION;
+    h.header_size = sizeof(h);
+    h.n = tree->n;
+    h.nblocks = x.nblocks;
+    h.index_off = x.off;
+    h.cl_strategy = (uint8_t)tree->hier.cl_strategy;
+    h.superpages = tree->hier.use_superpages;
+    h.flags = (tree->hier.color_pages ? MT_EXPORT_F_COLOR : 0) |
+              (tree->hier.compress_inodes ? MT_EXPORT_F_COMPRESS : 0) |
+              (tree->hier.tight_separators ? MT_EXPORT_F_TIGHT : 0);
+    bool ok = x.ok &&
+              mt_write_at(fd, x.index, x.nblocks * sizeof(*x.index),
+                          h.index_off) &&
+              mt_write_at(fd, &h, sizeof(h), 0);
+
+    int err = errno;
+    close(fd);
+    free(x.buf);
+    free(x.index);
+    if (!ok) {
+        unlink(path);
+        errno = err;
+    }
+    return ok;
+}
+
+/* ── Import ────────────────────────────────────────────────── */
+
+typedef struct {
+    const uint8_t           *base;
+    const mt_export_block_t *index;
+    size_t                   nblocks;
+    uint64_t                 data_end;     /* index_off */
+    const mt_hierarchy_t    *hier;
+    /* Page trees: block b fills pages[page_at[b] .. page_at[b + 1]). */
+    size_t                  *page_at;
+    mt_node_t              **pages;
+    int32_t                 *min_keys;
+    /* Superpage trees: block b decodes to keys + key_at[b]. */
+    size_t                  *key_at;
+    int32_t                 *keys;
+    size_t                   next;         /* next block to claim */
+    bool                     bad;
+} import_t;
+
+static void import_block(import_t *im, size_t b)
+{
+    const mt_export_block_t *ix = &im->index[b];
+    uint64_t end = (b + 1 < im->nblocks) ? im->index[b + 1].off
+                                         : im->data_end;
+    _Alignas(64) int32_t buf[MT_EXPORT_BLOCK_MAX];
+    int n = decode_block(im->base + ix->off, im->base + end, ix, buf);
+    if (n < 0 || (b + 1 < im->nblocks && buf[n - 1] >= im->index[b + 1].first)) {
+        __atomic_store_n(&im->bad, true, __ATOMIC_RELAXED);
+        return;
+    }
+    /* Groups decode whole, padding included: copy out only the keys,
+       as the next block's may already be in place. */
+    if (im->keys) {
+        memcpy(im->keys + im->key_at[b], buf, (size_t)n * sizeof(int32_t));
+        return;
+    }
+
+    size_t p0 = im->page_at[b];
+    int k = (int)(im->page_at[b + 1] - p0);
+    int per = n / k, extra = n % k, off = 0;
+    for (int j = 0; j < k; j++) {
+        int c = per + (j < extra ? 1 : 0);
+        mt_page_bulk_load(&im->pages[p0 + j]->lnode, buf + off, c, im->hier);
+        im->min_keys[p0 + j] = buf[off];
+        off += c;
+    }
+}
+
+static void *import_worker(void *arg)
+{
+    import_t *im = arg;
+    for (;;) {
+        size_t b = __atomic_fetch_add(&im->next, IMPORT_CHUNK,
+                                      __ATOMIC_RELAXED);
+        if (b >= im->nblocks || __atomic_load_n(&im->bad, __ATOMIC_RELAXED))
+            return NULL;
+        size_t e = (b + IMPORT_CHUNK < im->nblocks) ? b + IMPORT_CHUNK
+                                                    : im->nblocks;
+        for (; b < e; b++)
+            import_block(im, b);
+    }
+}
+
+/* The index and header agree with each other and with the file. */
+static bool import_index_ok(const mt_export_header_t *h,
+                            const mt_export_block_t *index)
+{
+    uint64_t n = 0;
+    for (uint64_t b = 0; b < h->nblocks; b++) {
+        const mt_export_block_t *ix = &index[b];
+        if (ix->nkeys == 0 || ix->nkeys > MT_EXPORT_BLOCK_MAX ||
+            ix->off < h->header_size || ix->off >= h->index_off)
+            return false;
+        if (b > 0 && (ix->off <= index[b - 1].off ||
+                      ix->first <= index[b - 1].first))
+            return false;
+        n += ix->nkeys;
+    }
+    return n == h->n;
+}
+
+static bool import_hier(const mt_export_header_t *h, mt_hierarchy_t *hier)
+{
+    switch (h->cl_strategy) {
+    case MT_CL_STRAT_DEFAULT:
+        if (h->superpages) mt_hierarchy_init_superpage(hier);
+        else mt_hierarchy_init_default(hier);
+        break;
+    case MT_CL_STRAT_FENCE:
+        if (h->superpages) mt_hierarchy_init_fence_sp(hier);
+        else mt_hierarchy_init_fence(hier);
+        break;
+    case MT_CL_STRAT_EYTZ:
+        if (h->superpages) return false;
+        mt_hierarchy_init_eytzinger(hier);
+        break;
+    default:
+        return false;
+    }
+    hier->color_pages = (h->flags & MT_EXPORT_F_COLOR) != 0;
+    hier->compress_inodes = (h->flags & MT_EXPORT_F_COMPRESS) != 0;
+    hier->tight_separators = (h->flags & MT_EXPORT_F_TIGHT) != 0;
+    return true;
+}
+
+static int import_threads(int threads, size_t nblocks)
+{
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    size_t chunks = (nblocks + IMPORT_CHUNK - 1) / IMPORT_CHUNK;
+    if ((size_t)threads > chunks)
+        threads = chunks ? (int)chunks : 1;
+    return threads;
+}
+
+/* Decode every block on `threads` threads; false if any is malformed. */
+static bool import_run(import_t *im, int threads)
+{
+    pthread_t *tids = malloc((size_t)threads * sizeof(pthread_t));
+    int started = 0;
+    if (tids)
+        for (; started < threads - 1; started++)
+            if (pthread_create(&tids[started], NULL, import_worker, im) != 0)
+                break;
+    import_worker(im);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+    free(tids);
+    return !im->bad;
+}
+
+static matryoshka_tree_t *import_pages(import_t *im, int threads, size_t n)
+{
+    matryoshka_tree_t *tree = matryoshka_create_with(im->hier);
+    if (!tree)
+        return NULL;
+    size_t max = (size_t)im->hier->page_max_keys;
+    im->page_at = malloc((im->nblocks + 1) * sizeof(size_t));
+    if (!im->page_at)
+        goto fail;
+    im->page_at[0] = 0;
+    for (size_t b = 0; b < im->nblocks; b++)
+        im->page_at[b + 1] = im->page_at[b] +
+                             (im->index[b].nkeys + max - 1) / max;
+    size_t npages = im->page_at[im->nblocks];
+    im->pages = malloc(npages * sizeof(mt_node_t *) + 1);
+    im->min_keys = malloc(npages * sizeof(int32_t) + 1);
+    if (!im->pages || !im->min_keys)
+        goto fail;
+
+    /* The allocator is single-threaded: place every page up front. */
+    size_t placed = 0;
+    for (; placed < npages; placed++) {
+        im->pages[placed] = mt_alloc_lnode_raw(&tree->hier, tree->alloc);
+        if (!im->pages[placed]) {
+            errno = ENOMEM;
+            goto unplace;
+        }
+    }
+    if (!import_run(im, threads)) {
+        errno = EINVAL;
+        goto unplace;
+    }
+    if (!mt_tree_adopt_pages(tree, im->pages, im->min_keys, npages, n)) {
+        errno = ENOMEM;
+        goto unplace;
+    }
+    return tree;
+
+unplace:
+    while (placed > 0)
+        mt_free_lnode(im->pages[--placed], tree->alloc);
+fail:
+    if (!errno)
+        errno = ENOMEM;
+    matryoshka_destroy(tree);
+    return NULL;
+}
+
+static matryoshka_tree_t *import_flat(import_t *im, int threads, size_t n)
+{
+    im->key_at = malloc((im->nblocks + 1) * sizeof(size_t));
+    im->keys = malloc(n * sizeof(int32_t) + 1);
+    matryoshka_tree_t *tree = NULL;
+    if (!im->key_at || !im->keys) {
+        errno = ENOMEM;
+    } else {
+        im->key_at[0] = 0;
+        for (size_t b = 0; b < im->nblocks; b++)
+            im->key_at[b + 1] = im->key_at[b] + im->index[b].nkeys;
+        if (!import_run(im, threads))
+            errno = EINVAL;
+        else
+            tree = matryoshka_bulk_load_with(im->keys, n, im->hier);
+    }
+    return tree;
+}
+
+matryoshka_tree_t *matryoshka_import(const char *path,
+                                     const mt_hierarchy_t *hier,
+                                     int threads)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &st) == 0) {
+        if (st.st_size >= (off_t)sizeof(mt_export_header_t))
+            base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                        fd, 0);
+        else
+            errno = EINVAL;
+    }
+    int err = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        errno = err;
+        return NULL;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+
+    mt_export_header_t h;
+    memcpy(&h, base, sizeof(h));
+    const mt_export_block_t *index = (const mt_export_block_t *)
+                                     ((const uint8_t *)base + h.index_off);
+    mt_hierarchy_t own;
+    matryoshka_tree_t *tree = NULL;
+    errno = EINVAL;
+    if (memcmp(h.magic, MT_EXPORT_MAGIC, sizeof(h.magic)) == 0 &&
+        h.version == MT_EXPORT_VERSION && h.header_size == sizeof(h) &&
+        h.index_off >= sizeof(h) && h.index_off % 8 == 0 &&
+        h.index_off <= size &&
+        h.nblocks <= (size - h.index_off) / sizeof(mt_export_block_t) &&
+        h.n <= (uint64_t)INT32_MAX + 1 &&
+        import_index_ok(&h, index) &&
+        (hier || import_hier(&h, &own))) {
+        import_t im = {
+            .base = base, .index = index, .nblocks = h.nblocks,
+            .data_end = h.index_off, .hier = hier ? hier : &own,
+        };
+        errno = 0;
+        threads = import_threads(threads, h.nblocks);
+        tree = im.hier->use_superpages ? import_flat(&im, threads, h.n)
+                                       : import_pages(&im, threads, h.n);
+        err = errno;
+        free(im.page_at);
+        free(im.pages);
+        free(im.min_keys);
+        free(im.key_at);
+        free(im.keys);
+        errno = err;
+    }
+    err = errno;
+    munmap(base, (size_t)st.st_size);
+    errno = err;
+    return tree;
+}
@@ -0,0 +1,266 @@
+/*
+ * heatmap.c — Sampled access heatmap of leaves and key ranges.
+ *
+ * Every operation decrements a thread-local countdown (mt_heat_note);
+ * when it expires the leaf and key are recorded in a per-thread table,
+ * so sampling threads never share a written cache line.  Each table is
+ * direct-mapped by leaf address and lossy: a colliding leaf evicts the
+ * previous occupant.  Tables are pushed onto the tree's list once and
+ * never unlinked until sampling is turned off, so exports can walk the
+ * list while threads keep recording.  Counters are updated with relaxed
+ * atomics, which compile to plain loads and stores on x86-64.
+ */
+
+#include "matryoshka_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ── Per-thread tables ─────────────────────────────────────── */
+
+#define MT_HEAT_SLOTS      1024     /* leaves tracked per thread */
+#define MT_HEAT_SLOT_BITS  10
+#define MT_HEAT_CACHE      4        /* trees remembered per thread */
+
+typedef struct mt_heat_slot {
+    const void *leaf;
+    int32_t     lo, hi;
+    uint32_t    reads, writes;
+} mt_heat_slot_t;
+
+typedef struct mt_heat_table {
+    struct mt_heat_table *next;
+    const void           *owner;    /* owning thread's token */
+    mt_heat_slot_t        slots[MT_HEAT_SLOTS];
+    uint32_t              bucket_reads[MATRYOSHKA_HEAT_BUCKETS];
+    uint32_t              bucket_writes[MATRYOSHKA_HEAT_BUCKETS];
+} mt_heat_table_t;
+
+struct mt_heat {
+    uint64_t         id;            /* unique across trees, never reused */
+    uint32_t         period;
+    mt_heat_table_t *tables;        /* push-only list */
+};
+
+_Thread_local int32_t mt_heat_countdown;
+
+static _Thread_local char     heat_token;
+static _Thread_local uint32_t heat_rng;
+static _Thread_local struct {
+    uint64_t         id;
+    mt_heat_table_t *table;
+} heat_cache[MT_HEAT_CACHE];
+
+static uint64_t heat_next_id = 1;
+
+static inline uint32_t ld32(const uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline void st32(uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+/* Find (or create and publish) the calling thread's table. */
+static mt_heat_table_t *heat_table(struct mt_heat *h)
+{
+    for (int i = 0; i < MT_HEAT_CACHE; i++)
+        if (heat_cache[i].id == h->id)
+            return heat_cache[i].table;
+
+    mt_heat_table_t *t = __atomic_load_n(&h->tables, __ATOMIC_ACQUIRE);
+    while (t && t->owner != &heat_token)
+        t = t->next;
+    if (!t) {
+        t = calloc(1, sizeof(*t));
+        if (!t) return NULL;
+        t->owner = &heat_token;
+        t->next = __atomic_load_n(&h->tables, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&h->tables, &t->next, t, true,
+                                            __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED))
+            ;
+    }
+
+    int c = (int)(h->id % MT_HEAT_CACHE);
+    heat_cache[c].id = h->id;
+    heat_cache[c].table = t;
+    return t;
+}
+
+/* ── Recording ─────────────────────────────────────────────── */
+
+void mt_heat_sample(const matryoshka_tree_t *tree, const void *leaf,
+                    int32_t key, bool write)
+{
+    struct mt_heat *h = tree->heat;
+
+    /* Next sample in [period/2, 3·period/2): the jitter keeps strided
+       access patterns from aliasing with the sampling interval. */
+    if (heat_rng == 0)
+        heat_rng = (uint32_t)(uintptr_t)&heat_token | 1;
+    heat_rng ^= heat_rng << 13;
+    heat_rng ^= heat_rng >> 17;
+    heat_rng ^= heat_rng << 5;
+    uint32_t next = h->period / 2 + heat_rng % h->period;
+    mt_heat_countdown = (int32_t)(next > 0 ? next : 1);
+
+    mt_heat_table_t *t = heat_table(h);
+    if (!t) return;
+
+    uint32_t b = ((uint32_t)key ^ 0x80000000u) >> 24;
+    uint32_t *bc = write ? &t->bucket_writes[b] : &t->bucket_reads[b];
+    st32(bc, ld32(bc) + 1);
+
+    uint64_t hash = ((uint64_t)(uintptr_t)leaf >> 12) * 0x9E3779B97F4A7C15ULL;
+    mt_heat_slot_t *s = &t->slots[hash >> (64 - MT_HEAT_SLOT_BITS)];
+    if (__atomic_load_n(&s->leaf, __ATOMIC_RELAXED) != leaf) {
+        __atomic_store_n(&s->leaf, leaf, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->lo, key, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->hi, key, __ATOMIC_RELAXED);
+        st32(&s->reads, 0);
+        st32(&s->writes, 0);
+    } else {
+        if (key < s->lo) __atomic_store_n(&s->lo, key, __ATOMIC_RELAXED);
+        if (key > s->hi) __atomic_store_n(&s->hi, key, __ATOMIC_RELAXED);
+    }
+    uint32_t *sc = write ? &s->writes : &s->reads;
+    st32(sc, ld32(sc) + 1);
+}
+
+void mt_heat_destroy(struct mt_heat *heat)
+{
+    if (!heat) return;
+    mt_heat_table_t *t = heat->tables;
+    while (t) {
+        mt_heat_table_t *next = t->next;
+        free(t);
+        t = next;
+    }
+    free(heat);
+}
+
+/* ── Public API ────────────────────────────────────────────── */
+
+bool matryoshka_heatmap_enable(matryoshka_tree_t *tree, uint32_t period)
+{
+    if (!tree) return false;
+    if (period == 0) {
+        mt_heat_destroy(tree->heat);
+        tree->heat = NULL;
+        return true;
+    }
+    if (!tree->heat) {
+        struct mt_heat *h = calloc(1, sizeof(*h));
+        if (!h) return false;
+        h->id = __atomic_fetch_add(&heat_next_id, 1, __ATOMIC_RELAXED);
+        tree->heat = h;
+    }
+    tree->heat->period = period;
+    return true;
+}
+
+static int cmp_heat_leaf(const void *a, const void *b)
+{
+    uintptr_t x = (uintptr_t)((const matryoshka_heat_leaf_t *)a)->leaf;
+    uintptr_t y = (uintptr_t)((const matryoshka_heat_leaf_t *)b)->leaf;
+    return (x > y) - (x < y);
+}
+
+static int cmp_heat_lo(const void *a, const void *b)
+{
+    int32_t x = ((const matryoshka_heat_leaf_t *)a)->lo;
+    int32_t y = ((const matryoshka_heat_leaf_t *)b)->lo;
+    return (x > y) - (x < y);
+}
+
+size_t matryoshka_heatmap_leaves(const matryoshka_tree_t *tree,
+                                  matryoshka_heat_leaf_t *out, size_t cap)
+{
+    if (!tree || !tree->heat) return 0;
+
+    size_t ntab = 0;
+    mt_heat_table_t *head = __atomic_load_n(&tree->heat->tables,
+                                            __ATOMIC_ACQUIRE);
+    for (mt_heat_table_t *t = head; t; t = t->next)
+        ntab++;
+    if (ntab == 0) return 0;
+
+    matryoshka_heat_leaf_t *rows = malloc(ntab * MT_HEAT_SLOTS *
+                                          sizeof(*rows));
+    if (!rows) return 0;
+
+    /* Snapshot every occupied slot, then merge rows for the same leaf. */
+    size_t n = 0;
+    for (mt_heat_table_t *t = head; t; t = t->next) {
+        for (int i = 0; i < MT_HEAT_SLOTS; i++) {
+            mt_heat_slot_t *s = &t->slots[i];
+            const void *leaf = __atomic_load_n(&s->leaf, __ATOMIC_RELAXED);
+            uint32_t r = ld32(&s->reads), w = ld32(&s->writes);
+            if (!leaf || (r | w) == 0) continue;
+            rows[n].leaf = leaf;
+            rows[n].lo = __atomic_load_n(&s->lo, __ATOMIC_RELAXED);
+            rows[n].hi = __atomic_load_n(&s->hi, __ATOMIC_RELAXED);
+            rows[n].reads = r;
+            rows[n].writes = w;
+            n++;
+        }
+    }
+    qsort(rows, n, sizeof(*rows), cmp_heat_leaf);
+
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (m > 0 && rows[m - 1].leaf == rows[i].leaf) {
+            matryoshka_heat_leaf_t *r = &rows[m - 1];
+            if (rows[i].lo < r->lo) r->lo = rows[i].lo;
+            if (rows[i].hi > r->hi) r->hi = rows[i].hi;
+            r->reads += rows[i].reads;
+            r->writes += rows[i].writes;
+        } else {
+            rows[m++] = rows[i];
+        }
+    }
+    qsort(rows, m, sizeof(*rows), cmp_heat_lo);
+
+    if (out)
+        memcpy(out, rows, (m < cap ? m : cap) * sizeof(*rows));
+    free(rows);
+    return m;
+}
+
+void matryoshka_heatmap_buckets(const matryoshka_tree_t *tree,
+                                 uint64_t reads[MATRYOSHKA_HEAT_BUCKETS],
+                                 uint64_t writes[MATRYOSHKA_HEAT_BUCKETS])
+{
+    memset(reads, 0, MATRYOSHKA_HEAT_BUCKETS * sizeof(uint64_t));
+    memset(writes, 0, MATRYOSHKA_HEAT_BUCKETS * sizeof(uint64_t));
+    if (!tree || !tree->heat) return;
+
+    for (mt_heat_table_t *t = __atomic_load_n(&tree->heat->tables,
+                                              __ATOMIC_ACQUIRE);
+         t; t = t->next) {
+        for (int b = 0; b < MATRYOSHKA_HEAT_BUCKETS; b++) {
+            reads[b] += ld32(&t->bucket_reads[b]);
+            writes[b] += ld32(&t->bucket_writes[b]);
+        }
+    }
+}
+
+void matryoshka_heatmap_reset(const matryoshka_tree_t *tree)
+{
+    if (!tree || !tree->heat) return;
+
+    for (mt_heat_table_t *t = __atomic_load_n(&tree->heat->tables,
+                                              __ATOMIC_ACQUIRE);
+         t; t = t->next) {
+        for (int i = 0; i < MT_HEAT_SLOTS; i++) {
+            st32(&t->slots[i].reads, 0);
+            st32(&t->slots[i].writes, 0);
+        }
+        for (int b = 0; b < MATRYOSHKA_HEAT_BUCKETS; b++) {
+            st32(&t->bucket_reads[b], 0);
+            st32(&t->bucket_writes[b], 0);
+        }
+    }
+}
@@ -0,0 +1,480 @@
+/*
+ * image.c — Tree images: save, load, and read-only attach.
+ *
+ * Saving writes a live tree in the format of matryoshka_build_image,
+ * node for node: leaves in key order, then the internal nodes in
+ * post-order, every pointer rewritten as a file offset.
+ *
+ * Loading reads each leaf straight into a page (or superpage) from the
+ * tree's own allocator, so the loaded tree is indistinguishable from a
+ * bulk-loaded one.  Pointers are relocated once everything is read:
+ * an offset below inode_off names a leaf by its index and a byte within
+ * it, anything above names an internal node.
+ *
+ * Attaching maps the file read-only and searches it in place, adding
+ * the mapping's base to each offset as the descent follows it.  Every
+ * process attached to one file shares its page cache copy, and attach
+ * costs a mmap, not a load.
+ */
+
+#include "matryoshka_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ── Save ──────────────────────────────────────────────────── */
+
+typedef struct {
+    int               fd;
+    const mt_hierarchy_t *hier;
+    uint64_t          leaf_off, inode_off;
+    uint64_t          nleaves, ninodes;    /* written so far */
+    void             *buf;                 /* one leaf */
+    const void       *prev_leaf;           /* last leaf written */
+    bool              ok;
+} save_t;
+
+static void count_nodes(const mt_node_t *node, int height,
+                        uint64_t *nleaves, uint64_t *ninodes)
+{
+    if (height == 0) {
+        (*nleaves)++;
+        return;
+    }
+    (*ninodes)++;
+    const mt_inode_t *in = &node->inode;
+    for (int i = 0; i <= in->nkeys; i++)
+        count_nodes(mt_untag(in->children[i]), height - 1, nleaves, ninodes);
+}
+
+static inline bool within(const void *p, const void *base, size_t len)
+{
+    return (const char *)p >= (const char *)base &&
+           (const char *)p < (const char *)base + len;
+}
+
+/* Image offset of a page link from a superpage at `off`: into the same
+   superpage or one of its neighbours, which sit either side of it. */
+static void *save_page_link(const mt_lnode_t *p, const mt_sp_header_t *sp,
+                            uint64_t off, size_t alloc)
+{
+    if (!p)
+        return NULL;
+    if (within(p, sp, alloc))
+        return (void *)(uintptr_t)(off + (uint64_t)((const char *)p - (const char *)sp));
+    if (sp->prev && within(p, sp->prev, alloc))
+        return (void *)(uintptr_t)(off - alloc
+                    + (uint64_t)((const char *)p - (const char *)sp->prev));
+    return (void *)(uintptr_t)(off + alloc
+                + (uint64_t)((const char *)p - (const char *)sp->next));
+}
+
+static uint64_t save_leaf(save_t *s, const mt_node_t *leaf)
+{
+    size_t alloc = s->hier->leaf_alloc;
+    uint64_t off = s->leaf_off + s->nleaves++ * alloc;
+    memcpy(s->buf, leaf, alloc);
+
+    if (s->hier->use_superpages) {
+        const mt_sp_header_t *sp = (const mt_sp_header_t *)leaf;
+        mt_sp_header_t *hdr = s->buf;
+        hdr->prev = sp->prev ? (void *)(uintptr_t)(off - alloc) : NULL;
+        hdr->next = sp->next ? (void *)(uintptr_t)(off + alloc) : NULL;
+        const mt_lnode_t *last = mt_sp_last_leaf((void *)sp);
+        for (const mt_lnode_t *p = mt_sp_first_leaf((void *)sp); ;
+             p = p->header.next) {
+            mt_lnode_t *copy = (mt_lnode_t *)((char *)s->buf
+                             + ((const char *)p - (const char *)sp));
+            copy->header.prev = save_page_link(p->header.prev, sp, off, alloc);
+            copy->header.next = save_page_link(p->header.next, sp, off, alloc);
+            if (p == last)
+                break;
+        }
+    } else {
+        const mt_lnode_t *page = &leaf->lnode;
+        mt_lnode_t *copy = s->buf;
+        copy->header.prev = page->header.prev
+            ? (void *)(uintptr_t)(off - alloc) : NULL;
+        copy->header.next = page->header.next
+            ? (void *)(uintptr_t)(off + alloc) : NULL;
+    }
+    s->ok = s->ok && mt_write_at(s->fd, s->buf, alloc, off);
+    return off;
+}
+
+/* Write the subtree at `node`, children first.  Returns its offset. */
+static uint64_t save_node(save_t *s, const mt_node_t *node, int height)
+{
+    if (height == 0)
+        return save_leaf(s, node);
+
+    mt_inode_t *copy = NULL;
+    if (posix_memalign((void **)&copy, MT_PAGE_SIZE, MT_PAGE_SIZE) != 0) {
+        s->ok = false;
+        return 0;
+    }
+    memcpy(copy, node, MT_PAGE_SIZE);
+    for (int i = 0; i <= copy->nkeys && s->ok; i++) {
+        mt_node_t *child = node->inode.children[i];
+        uintptr_t tag = (uintptr_t)child & MT_PTR_TAG_MASK;
+        uint64_t off = save_node(s, mt_untag(child), height - 1);
+        copy->children[i] = (mt_node_t *)(uintptr_t)(off | tag);
+    }
+    uint64_t off = s->inode_off + s->ninodes++ * MT_PAGE_SIZE;
+    s->ok = s->ok && mt_write_at(s->fd, copy, MT_PAGE_SIZE, off);
+    free(copy);
+    return off;
+}
+
+bool matryoshka_image_save(const matryoshka_tree_t *tree, const char *path)
+{
+    save_t s = { .hier = &tree->hier, .ok = true };
+    uint64_t nleaves = 0, ninodes = 0;
+    count_nodes(tree->root, tree->height, &nleaves, &ninodes);
+    s.leaf_off = tree->hier.leaf_alloc;
+    s.inode_off = s.leaf_off + nleaves * tree->hier.leaf_alloc;
+
+    s.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (s.fd < 0)
+        return false;
+    if (posix_memalign(&s.buf, MT_PAGE_SIZE, tree->hier.leaf_alloc) != 0) {
+        close(s.fd);
+        errno = ENOMEM;
+        return false;
+    }
+
+    mt_image_header_t ih;
+    memset(&ih, 0, sizeof(ih));
+    ih.root = save_node(&s, tree->root, tree->height);
+    memcpy(ih.magic, MT_IMAGE_MAGIC, sizeof(ih.magic));
+    ih.version = MT_IMAGE_VERSION;
+    ih.header_size = sizeof(ih);
+    ih.n = tree->n;
+    ih.nleaves = nleaves;
+    ih.ninodes = ninodes;
+    ih.leaf_off = s.leaf_off;
+    ih.inode_off = s.inode_off;
+    ih.height = tree->height;
+    ih.hier = tree->hier;
+    if (!s.ok || !mt_write_at(s.fd, &ih, sizeof(ih), 0)) {
+        int err = errno ? errno : ENOMEM;
+        free(s.buf);
+        close(s.fd);
+        unlink(path);
+        errno = err;
+        return false;
+    }
+    free(s.buf);
+    return close(s.fd) == 0;
+}
+
+/* ── Load ──────────────────────────────────────────────────── */
+
+typedef struct {
+    const mt_image_header_t *ih;
+    mt_node_t **leaves;
+    mt_node_t **inodes;
+    bool        bad;      /* an offset pointed outside the image */
+} image_map_t;
+
+/* Address of image offset `off` (untagged), or NULL for 0. */
+static void *image_reloc(image_map_t *m, uint64_t off)
+{
+    const mt_image_header_t *ih = m->ih;
+    if (off == 0)
+        return NULL;
+    if (off >= ih->leaf_off && off < ih->inode_off) {
+        uint64_t rel = off - ih->leaf_off;
+        return (char *)m->leaves[rel / ih->hier.leaf_alloc]
+             + rel % ih->hier.leaf_alloc;
+    }
+    uint64_t idx = (off - ih->inode_off) / MT_PAGE_SIZE;
+    if (off >= ih->inode_off && off % MT_PAGE_SIZE == 0 && idx < ih->ninodes)
+        return m->inodes[idx];
+    m->bad = true;
+    return NULL;
+}
+
+static void *reloc_ptr(image_map_t *m, const void *p)
+{
+    return image_reloc(m, (uint64_t)(uintptr_t)p);
+}
+
+/* Outer child reference: relocate the node, keep the tag bits. */
+static mt_node_t *reloc_child(image_map_t *m, mt_node_t *p)
+{
+    uintptr_t tag = (uintptr_t)p & MT_PTR_TAG_MASK;
+    mt_node_t *node = image_reloc(m, (uint64_t)((uintptr_t)p & ~MT_PTR_TAG_MASK));
+    if (!node)
+        m->bad = true;
+    return (mt_node_t *)((uintptr_t)node | tag);
+}
+
+static void reloc_page_links(image_map_t *m, mt_lnode_t *page)
+{
+    page->header.prev = reloc_ptr(m, page->header.prev);
+    page->header.next = reloc_ptr(m, page->header.next);
+}
+
+static void reloc_sp(image_map_t *m, void *sp)
+{
+    mt_sp_header_t *hdr = sp;
+    hdr->prev = reloc_ptr(m, hdr->prev);
+    hdr->next = reloc_ptr(m, hdr->next);
+
+    /* Walk the page chain while it stays inside this superpage; the
+       links still hold offsets until each page is relocated. */
+    mt_lnode_t *last = mt_sp_last_leaf(sp);
+    for (mt_lnode_t *page = mt_sp_first_leaf(sp); !m->bad; ) {
+        reloc_page_links(m, page);
+        if (page == last)
+            break;
+        page = page->header.next;
+        if ((char *)page < (char *)sp || (char *)page >= (char *)sp + MT_SP_SIZE)
+            m->bad = true;
+    }
+}
+
+static bool image_header_ok(const mt_image_header_t *ih, uint64_t size)
+{
+    const mt_hierarchy_t *h = &ih->hier;
+    if (memcmp(ih->magic, MT_IMAGE_MAGIC, sizeof(ih->magic)) != 0 ||
+        ih->version != MT_IMAGE_VERSION ||
+        ih->header_size != sizeof(*ih))
+        return false;
+    if (h->use_superpages ? h->leaf_alloc != MT_SP_SIZE
+                          : h->leaf_alloc < MT_PAGE_SIZE ||
+                            h->leaf_alloc % MT_PAGE_SIZE != 0)
+        return false;
+    if (ih->nleaves == 0 || ih->nleaves > size / h->leaf_alloc ||
+        ih->ninodes > size / MT_PAGE_SIZE || ih->leaf_off < MT_PAGE_SIZE ||
+        ih->inode_off != ih->leaf_off + ih->nleaves * h->leaf_alloc ||
+        ih->height < 0 || (ih->height == 0) != (ih->ninodes == 0))
+        return false;
+    return ih->inode_off + ih->ninodes * MT_PAGE_SIZE <= size;
+}
+
+/* Read and check the header of an open image file. */
+static bool image_read_header(int fd, mt_image_header_t *ih, uint64_t *size)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return false;
+    if (st.st_size < (off_t)sizeof(*ih)) {
+        errno = EINVAL;
+        return false;
+    }
+    if (!mt_read_at(fd, ih, sizeof(*ih), 0))
+        return false;
+    if (!image_header_ok(ih, (uint64_t)st.st_size)) {
+        errno = EINVAL;
+        return false;
+    }
+    *size = (uint64_t)st.st_size;
+    return true;
+}
+
+matryoshka_tree_t *matryoshka_image_load(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    mt_image_header_t ih;
+    uint64_t size;
+    if (!image_read_header(fd, &ih, &size)) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+
+    matryoshka_tree_t *tree = matryoshka_create_with(&ih.hier);
+    image_map_t m = { &ih, NULL, NULL, false };
+    m.leaves = calloc(ih.nleaves, sizeof(mt_node_t *));
+    m.inodes = calloc(ih.ninodes ? ih.ninodes : 1, sizeof(mt_node_t *));
+    int err = ENOMEM;
+    if (tree) {
+        mt_free_lnode(tree->root, tree->alloc);
+        tree->root = NULL;
+    }
+    if (!tree || !m.leaves || !m.inodes)
+        goto fail;
+
+    size_t leaf_alloc = ih.hier.leaf_alloc;
+    for (uint64_t i = 0; i < ih.nleaves; i++) {
+        m.leaves[i] = mt_alloc_lnode_raw(&tree->hier, tree->alloc);
+        if (!m.leaves[i])
+            goto fail;
+        if (!mt_read_at(fd, m.leaves[i], leaf_alloc,
+                        ih.leaf_off + i * leaf_alloc)) {
+            err = errno;
+            goto fail;
+        }
+    }
+    for (uint64_t i = 0; i < ih.ninodes; i++) {
+        m.inodes[i] = mt_alloc_inode();
+        if (!m.inodes[i])
+            goto fail;
+        if (!mt_read_at(fd, m.inodes[i], MT_PAGE_SIZE,
+                        ih.inode_off + i * MT_PAGE_SIZE)) {
+            err = errno;
+            goto fail;
+        }
+    }
+
+    for (uint64_t i = 0; i < ih.nleaves && !m.bad; i++) {
+        if (ih.hier.use_superpages)
+            reloc_sp(&m, m.leaves[i]);
+        else
+            reloc_page_links(&m, &m.leaves[i]->lnode);
+    }
+    for (uint64_t i = 0; i < ih.ninodes && !m.bad; i++) {
+        mt_inode_t *in = &m.inodes[i]->inode;
+        if (in->nkeys > MT_MAX_IKEYS) {
+            m.bad = true;
+            break;
+        }
+        for (int j = 0; j <= in->nkeys; j++)
+            in->children[j] = reloc_child(&m, in->children[j]);
+    }
+    tree->root = image_reloc(&m, ih.root);
+    err = EINVAL;
+    if (m.bad || !tree->root)
+        goto fail;
+
+    tree->n = (size_t)ih.n;
+    tree->height = ih.height;
+    free(m.inodes);
+    free(m.leaves);
+    close(fd);
+    return tree;
+
+fail:
+    if (tree) {
+        tree->root = NULL;
+        for (uint64_t i = 0; m.leaves && i < ih.nleaves; i++)
+            if (m.leaves[i])
+                mt_free_lnode(m.leaves[i], tree->alloc);
+        for (uint64_t i = 0; m.inodes && i < ih.ninodes; i++)
+            if (m.inodes[i])
+                mt_free_inode(m.inodes[i]);
+    }
+    matryoshka_destroy(tree);
+    free(m.inodes);
+    free(m.leaves);
+    close(fd);
+    errno = err;
+    return NULL;
+}
+
+/* ── Attach ────────────────────────────────────────────────── */
+
+matryoshka_image_t *matryoshka_image_attach(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    mt_image_header_t ih;
+    uint64_t size;
+    matryoshka_image_t *img = NULL;
+    void *base = MAP_FAILED;
+    if (image_read_header(fd, &ih, &size)) {
+        base = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+        img = malloc(sizeof(*img));
+    }
+    int err = errno;
+    close(fd);
+    if (base == MAP_FAILED || !img) {
+        if (base != MAP_FAILED)
+            munmap(base, (size_t)size);
+        free(img);
+        errno = img ? err : ENOMEM;
+        return NULL;
+    }
+    img->base = base;
+    img->len = (size_t)size;
+    img->ih = base;
+    return img;
+}
+
+void matryoshka_image_detach(matryoshka_image_t *img)
+{
+    if (!img) return;
+    munmap((void *)img->base, img->len);
+    free(img);
+}
+
+size_t matryoshka_image_size(const matryoshka_image_t *img)
+{
+    return img ? (size_t)img->ih->n : 0;
+}
+
+/* Mapped address of image offset `off` (tag bits ignored), or NULL. */
+static inline const void *img_at(const matryoshka_image_t *img,
+                                 const void *off)
+{
+    uintptr_t o = (uintptr_t)off & ~MT_PTR_TAG_MASK;
+    return o ? img->base + o : NULL;
+}
+
+/* Walk the outer tree to the leaf for `key`. */
+static const void *img_find_leaf(const matryoshka_image_t *img, int32_t key)
+{
+    const void *node = img->base + img->ih->root;
+    for (int i = 0; i < img->ih->height; i++) {
+        const mt_inode_t *in = node;
+        node = img_at(img, in->children[mt_inode_search(in, key)]);
+    }
+    return node;
+}
+
+/* matryoshka_search over the mapping; the previous-leaf fallbacks
+   follow offsets instead of pointers. */
+bool matryoshka_image_search(const matryoshka_image_t *img, int32_t key,
+                             int32_t *result)
+{
+    if (!img || img->ih->n == 0)
+        return false;
+
+    const void *leaf = img_find_leaf(img, key);
+    const mt_sp_header_t *sp = NULL;
+    const mt_lnode_t *page = leaf;
+    if (img->ih->hier.use_superpages) {
+        sp = leaf;
+        page = sp->nkeys > 0 ? mt_sp_find_leaf((void *)sp, key) : NULL;
+    }
+
+    if (page) {
+        if (mt_page_search_key(page, key, result))
+            return true;
+        const mt_lnode_t *prev = img_at(img, page->header.prev);
+        if (prev && prev->header.nkeys > 0) {
+            if (result) *result = mt_page_max_key(prev);
+            return true;
+        }
+    }
+    if (sp) {
+        const mt_sp_header_t *prev = img_at(img, sp->prev);
+        if (prev && prev->nkeys > 0) {
+            if (result) *result = mt_sp_max_key(prev);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool matryoshka_image_contains(const matryoshka_image_t *img, int32_t key)
+{
+    if (!img || img->ih->n == 0)
+        return false;
+    const void *leaf = img_find_leaf(img, key);
+    if (img->ih->hier.use_superpages)
+        return mt_sp_contains(leaf, key);
+    return mt_page_contains(leaf, key);
+}
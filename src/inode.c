@@ -4,10 +4,131 @@
  * Internal nodes store keys in sorted order (not FAST-blocked) so that
  * the search result directly yields the child pointer index without
  * needing a sorted_rank mapping.
+ *
+ * Nodes whose separators span at most 65535 may instead hold 16-bit
+ * offsets from a per-node base (hier.compress_inodes).  The key array
+ * then covers half as many cache lines and each SIMD compare handles
+ * twice as many separators.
  */
 
 #include "matryoshka_internal.h"
 
+/* ── 16-bit separator layout ───────────────────────────────── */
+
+bool mt_inode_narrow(mt_inode_t *node)
+{
+    int n = node->nkeys;
+    if (node->key16)
+        return true;
+    if (n == 0 || (int64_t)node->keys[n - 1] - node->keys[0] > 0xFFFF)
+        return false;
+
+    /* keys16[i] overlaps keys[i / 2], which has already been read. */
+    int32_t base = node->keys[0];
+    for (int i = 0; i < n; i++)
+        node->keys16[i] = (int16_t)((int64_t)node->keys[i] - base - 32768);
+    node->key_base = base;
+    node->key16 = 1;
+    return true;
+}
+
+void mt_inode_widen(mt_inode_t *node)
+{
+    if (!node->key16)
+        return;
+
+    /* keys[i] overlaps keys16[2i] and keys16[2i + 1]; walking down,
+       both have already been read. */
+    for (int i = node->nkeys - 1; i >= 0; i--)
+        node->keys[i] = mt_inode_key(node, i);
+    node->key16 = 0;
+}
+
+/* mt_inode_search for the 16-bit layout.  The query is mapped into the
+   node's biased offset space; queries outside the span resolve without
+   touching the key array. */
+static int inode_search16(const mt_inode_t *node, int32_t key)
+{
+    int n = node->nkeys;
+    int64_t d = (int64_t)key - node->key_base;
+    if (d < 0)
+        return 0;
+    if (d > 0xFFFF)
+        return n;
+    int16_t q = (int16_t)(d - 32768);
+    const int16_t *keys = node->keys16;
+
+#if defined(__AVX512BW__)
+    /* AVX-512BW: 32 separators per compare, linear up to 128. */
+    if (n <= 128) {
+        __m512i vkey = _mm512_set1_epi16(q);
+        for (int i = 0; i < n; i += 32) {
+            int rem = n - i;
+            __mmask32 valid = (rem >= 32) ? ~(__mmask32)0
+                                          : (((__mmask32)1 << rem) - 1);
+            __m512i vtree = _mm512_maskz_loadu_epi16(valid, keys + i);
+            __mmask32 gt = _mm512_mask_cmpgt_epi16_mask(valid, vtree, vkey);
+            if (gt != 0)
+                return i + __builtin_ctz(gt);
+        }
+        return n;
+    }
+
+#elif defined(__AVX2__)
+    /* AVX2: 16 separators per compare, linear up to 128. */
+    if (n <= 128) {
+        __m256i vkey = _mm256_set1_epi16(q);
+        int i = 0;
+        for (; i + 15 < n; i += 16) {
+            __m256i vtree = _mm256_loadu_si256((const __m256i *)(keys + i));
+            __m256i vcmp = _mm256_cmpgt_epi16(vtree, vkey);
+            unsigned mask = (unsigned)_mm256_movemask_epi8(vcmp);
+            if (mask != 0)
+                return i + (__builtin_ctz(mask) >> 1);
+        }
+        for (; i < n; i++) {
+            if (keys[i] > q)
+                return i;
+        }
+        return n;
+    }
+
+#else
+    /* SSE2: 8 separators per compare, linear up to 64. */
+    if (n <= 64) {
+        __m128i vkey = _mm_set1_epi16(q);
+        int i = 0;
+        for (; i + 7 < n; i += 8) {
+            __m128i vtree = _mm_loadu_si128((const __m128i *)(keys + i));
+            __m128i vcmp = _mm_cmpgt_epi16(vtree, vkey);
+            unsigned mask = (unsigned)_mm_movemask_epi8(vcmp);
+            if (mask != 0)
+                return i + (__builtin_ctz(mask) >> 1);
+        }
+        for (; i < n; i++) {
+            if (keys[i] > q)
+                return i;
+        }
+        return n;
+    }
+#endif
+
+    /* Branchless binary search, as for the 32-bit layout. */
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + ((hi - lo) >> 1);
+        __builtin_prefetch(&keys[(lo + mid) >> 1], 0, 0);
+        __builtin_prefetch(&keys[(mid + 1 + hi) >> 1], 0, 0);
+        int cmp = (keys[mid] <= q);
+        int mask = -cmp;
+        lo += ((mid + 1) - lo) & mask;
+        hi += (mid - hi) & ~mask;
+    }
+    return lo;
+}
+
+/* ── Search ────────────────────────────────────────────────── */
+
 /*
  * Find the child index to follow for `key` in an internal node.
  *
@@ -20,6 +141,9 @@
  */
 int mt_inode_search(const mt_inode_t *node, int32_t key)
 {
+    if (node->key16)
+        return inode_search16(node, key);
+
     const int32_t *keys = node->keys;
     int n = node->nkeys;
 
@@ -106,3 +230,46 @@ int mt_inode_search(const mt_inode_t *node, int32_t key)
     }
     return lo;
 }
+
+/* ── Explain ───────────────────────────────────────────────── */
+
+/* Node sizes up to which the kernels above scan linearly. */
+#if defined(__AVX2__)
+#define INODE_LINEAR_MAX    64
+#define INODE_LINEAR_MAX16  128
+#else
+#define INODE_LINEAR_MAX    32
+#define INODE_LINEAR_MAX16  64
+#endif
+
+/* Touch what mt_inode_search read to return `idx`: the header, the key
+   prefix up to idx for a linear scan or the binary search's probes,
+   and the child pointer that is followed next. */
+void mt_inode_explain(const mt_inode_t *node, int32_t key, int idx,
+                      mt_explain_ctx_t *x)
+{
+    int n = node->nkeys;
+    size_t width = node->key16 ? sizeof(int16_t) : sizeof(int32_t);
+    const char *keys = node->key16 ? (const char *)node->keys16
+                                   : (const char *)node->keys;
+
+    mt_explain_touch(x, node, offsetof(mt_inode_t, keys));
+    if (node->key16 && ((int64_t)key < node->key_base ||
+                        (int64_t)key - node->key_base > 0xFFFF)) {
+        /* Outside the 16-bit span: resolved from the header alone. */
+    } else if (n <= (node->key16 ? INODE_LINEAR_MAX16 : INODE_LINEAR_MAX)) {
+        int end = idx < n ? idx + 1 : n;
+        mt_explain_touch(x, keys, (size_t)end * width);
+    } else {
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = lo + ((hi - lo) >> 1);
+            mt_explain_touch(x, keys + (size_t)mid * width, width);
+            if (mt_inode_key(node, mid) <= key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+    }
+    mt_explain_touch(x, &node->children[idx], sizeof(node->children[0]));
+}
@@ -35,15 +35,16 @@ static void slot_free(mt_lnode_t *page, int slot)
     page->header.nslots_used--;
 }
 
-/* Get a CL slot by index (1-based; slot 0 is the header). */
+/* Get a CL slot by index (1-based; slot 0 is the header).  Coloured
+   pages rotate the physical position; see mt_page_slot_index(). */
 static mt_cl_slot_t *get_slot(mt_lnode_t *page, int slot)
 {
-    return &page->slots[slot - 1];
+    return mt_page_slot(page, slot);
 }
 
 static const mt_cl_slot_t *get_slot_c(const mt_lnode_t *page, int slot)
 {
-    return &page->slots[slot - 1];
+    return mt_page_slot_c(page, slot);
 }
 
 /* ── CL leaf operations ────────────────────────────────────── */
@@ -425,7 +426,7 @@ static int page_find_leaf(const mt_lnode_t *page, int32_t key,
            We know nc from the header — nslots_used - 1 (root uses 1). */
         int nc = page->header.nslots_used - 1;
         for (int c = 0; c < nc; c++)
-            __builtin_prefetch(&page->slots[slot + c], 0, 1);
+            __builtin_prefetch(get_slot_c(page, slot + 1 + c), 0, 1);
 
         const mt_cl_slot_t *s = get_slot_c(page, slot);
         int ci = cl_inode_search_eytz(&s->inode_eytz, key);
@@ -486,6 +487,37 @@ static int page_find_leaf(const mt_lnode_t *page, int32_t key,
     return slot;
 }
 
+/* Slot of the CL leaf just left of the one `path` leads to: the
+   rightmost leaf under the nearest left sibling on the path, or -1 if
+   there is none.  With `x` set, touches the slots it reads. */
+static inline int cl_prev_leaf(const mt_lnode_t *page,
+                               const mt_sub_path_t *path, int path_len,
+                               mt_explain_ctx_t *x)
+{
+    for (int i = path_len - 1; i >= 0; i--) {
+        if (path[i].child_idx == 0)
+            continue;
+        if (page->header.flags & MT_PAGE_FLAG_EYTZ) {
+            /* Eytzinger roots have no children[]: the left sibling is
+               the leaf at the previous implicit position. */
+            int s = path[i].slot + path[i].child_idx;
+            if (x) mt_explain_touch(x, get_slot_c(page, s), MT_CL_SIZE);
+            return s;
+        }
+        const mt_cl_inode_t *parent = &get_slot_c(page, path[i].slot)->inode;
+        int s = parent->children[path[i].child_idx - 1];
+        const mt_cl_slot_t *slot = get_slot_c(page, s);
+        if (x) mt_explain_touch(x, slot, MT_CL_SIZE);
+        while (slot->type == MT_CL_INTERNAL) {
+            s = slot->inode.children[slot->inode.nkeys];
+            slot = get_slot_c(page, s);
+            if (x) mt_explain_touch(x, slot, MT_CL_SIZE);
+        }
+        return s;
+    }
+    return -1;
+}
+
 int mt_page_search(const mt_lnode_t *page, int32_t key)
 {
     if (page->header.nkeys == 0)
@@ -502,26 +534,10 @@ int mt_page_search(const mt_lnode_t *page, int32_t key)
         return pos;  /* Found predecessor within this CL leaf. */
 
     /* Key is smaller than all keys in this CL leaf.
-       Walk left: find the previous CL leaf in the sub-tree. */
-    for (int i = path_len - 1; i >= 0; i--) {
-        if (path[i].child_idx > 0) {
-            /* Go to the rightmost key of the left sibling subtree. */
-            const mt_cl_inode_t *parent =
-                &get_slot_c(page, path[i].slot)->inode;
-            int prev_child = path[i].child_idx - 1;
-            int s = parent->children[prev_child];
-            /* Descend to rightmost leaf. */
-            const mt_cl_slot_t *slot = get_slot_c(page, s);
-            while (slot->type == MT_CL_INTERNAL) {
-                s = slot->inode.children[slot->inode.nkeys];
-                slot = get_slot_c(page, s);
-            }
-            /* Return last key of this leaf. */
-            if (slot->leaf.nkeys > 0)
-                return -(slot->leaf.nkeys);  /* encode: negative = from-prev */
-            break;
-        }
-    }
+       Walk left: return the last key of the previous CL leaf. */
+    int s = cl_prev_leaf(page, path, path_len, NULL);
+    if (s >= 0 && get_slot_c(page, s)->leaf.nkeys > 0)
+        return -(get_slot_c(page, s)->leaf.nkeys);  /* negative = from-prev */
 
     return -1;
 }
@@ -544,23 +560,12 @@ bool mt_page_search_key(const mt_lnode_t *page, int32_t key, int32_t *result)
     }
 
     /* Walk left to find predecessor in previous CL leaf. */
-    for (int i = path_len - 1; i >= 0; i--) {
-        if (path[i].child_idx > 0) {
-            const mt_cl_inode_t *parent =
-                &get_slot_c(page, path[i].slot)->inode;
-            int prev_child = path[i].child_idx - 1;
-            int s = parent->children[prev_child];
-            const mt_cl_slot_t *slot = get_slot_c(page, s);
-            while (slot->type == MT_CL_INTERNAL) {
-                s = slot->inode.children[slot->inode.nkeys];
-                slot = get_slot_c(page, s);
-            }
-            if (slot->leaf.nkeys > 0) {
-                if (result)
-                    *result = slot->leaf.keys[slot->leaf.nkeys - 1];
-                return true;
-            }
-            break;
+    int s = cl_prev_leaf(page, path, path_len, NULL);
+    if (s >= 0) {
+        const mt_cl_leaf_t *prev = &get_slot_c(page, s)->leaf;
+        if (prev->nkeys > 0) {
+            if (result) *result = prev->keys[prev->nkeys - 1];
+            return true;
         }
     }
 
@@ -581,8 +586,40 @@ bool mt_page_contains(const mt_lnode_t *page, int32_t key)
     return (pos < cl->nkeys && cl->keys[pos] == key);
 }
 
+void mt_page_prefetch_key(const mt_lnode_t *page, int32_t key)
+{
+    mt_sub_path_t path[MT_SUB_MAX_HEIGHT];
+    int path_len;
+    int leaf_slot = page_find_leaf(page, key, path, &path_len);
+    __builtin_prefetch(get_slot_c(page, leaf_slot), 0, 2);
+}
+
 /* ── Page-level insert ─────────────────────────────────────── */
 
+static void page_build(mt_lnode_t *page, uint8_t color, int strategy,
+                       const int32_t *sorted_keys, int nkeys);
+
+static inline int hier_strategy(const mt_hierarchy_t *hier)
+{
+    return hier ? hier->cl_strategy : MT_CL_STRAT_DEFAULT;
+}
+
+/* Rebuild an Eytzinger page in place.  The build starts from a clean
+   page, so the outer leaf links are carried over; the colour is kept
+   rather than derived from the address, so a staged copy of a page
+   (see txn.c) rebuilds exactly as the page itself would.  The page
+   stays Eytzinger whatever the hierarchy: during matryoshka_convert
+   pages of the old layout keep it until they are rewritten. */
+static void eytz_rebuild(mt_lnode_t *page, const int32_t *keys, int n)
+{
+    mt_lnode_t *prev = page->header.prev;
+    mt_lnode_t *next = page->header.next;
+    page_build(page, (uint8_t)(page->header.flags >> MT_PAGE_COLOR_SHIFT),
+               MT_CL_STRAT_EYTZ, keys, n);
+    page->header.prev = prev;
+    page->header.next = next;
+}
+
 mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
                             const mt_hierarchy_t *hier)
 {
@@ -594,12 +631,16 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
 
     /* Eytzinger insert: extract all keys, insert into sorted array,
        rebuild the dense BFS layout. */
-    if (hier && hier->cl_strategy == MT_CL_STRAT_EYTZ) {
+    if (page->header.flags & MT_PAGE_FLAG_EYTZ) {
         int pos = cl_leaf_lower_bound(cl, key);
         if (pos < cl->nkeys && cl->keys[pos] == key)
             return MT_DUPLICATE;
-        /* Simple capacity check: for Eytzinger, page_max_keys caps us. */
-        if (page->header.nkeys >= (uint16_t)hier->page_max_keys)
+        /* Simple capacity check: the dense layout caps us, and so does
+           page_max_keys if the hierarchy asks for less. */
+        int cap = MT_EYTZ_PAGE_MAX_KEYS;
+        if (hier && hier->page_max_keys < cap)
+            cap = hier->page_max_keys;
+        if (page->header.nkeys >= (uint16_t)cap)
             return MT_PAGE_FULL;
 
         /* If CL leaf has room, insert directly. */
@@ -620,9 +661,9 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
         memmove(all + ins + 1, all + ins, (size_t)(n - ins) * sizeof(int32_t));
         all[ins] = key;
         n++;
-        mt_page_bulk_load(page, all, n, hier);
-        return (page->header.nkeys >= (uint16_t)hier->page_max_keys)
-               ? MT_PAGE_FULL : MT_OK;
+        MT_PROBE3(eytz_rebuild, key, page, n);
+        eytz_rebuild(page, all, n);
+        return (page->header.nkeys >= (uint16_t)cap) ? MT_PAGE_FULL : MT_OK;
     }
 
     /* Try inserting into the CL leaf. */
@@ -638,11 +679,27 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
     if (pos < cl->nkeys && cl->keys[pos] == key)
         return MT_DUPLICATE;
 
-    /* Need to split the CL leaf. */
-    int new_slot = slot_alloc(page);
-    if (new_slot == 0)
+    /* Need to split the CL leaf.  Reserve every slot the split can
+       consume (the new leaf, one per full ancestor, and a new root if
+       the split reaches it) before touching anything: returning
+       MT_PAGE_FULL halfway would leave a CL leaf unlinked and its keys
+       invisible to the page split that follows. */
+    int need = 1;
+    {
+        int i = path_len - 1;
+        while (i >= 0 &&
+               get_slot_c(page, path[i].slot)->inode.nkeys >= MT_CL_SEP_CAP) {
+            need++;
+            i--;
+        }
+        if (i < 0)
+            need++;
+    }
+    if (__builtin_popcountll(~page->header.slot_bitmap & ~1ULL) < need)
         return MT_PAGE_FULL;
 
+    int new_slot = slot_alloc(page);
+
     mt_cl_slot_t *new_s = get_slot(page, new_slot);
     cl_leaf_init(new_s);
 
@@ -663,7 +720,7 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
 
         if (parent->nkeys < MT_CL_SEP_CAP) {
             cl_inode_insert_at(parent, path[i].child_idx, sep, right_slot);
-            if (hier && hier->cl_strategy == MT_CL_STRAT_FENCE)
+            if (page->header.flags & MT_PAGE_FLAG_FENCE)
                 refresh_fence_keys(page);
             return MT_OK;
         }
@@ -671,7 +728,7 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
         /* CL internal is full — split it. */
         int split_slot = slot_alloc(page);
         if (split_slot == 0) {
-            if (hier && hier->cl_strategy == MT_CL_STRAT_FENCE)
+            if (page->header.flags & MT_PAGE_FLAG_FENCE)
                 refresh_fence_keys(page);
             return MT_PAGE_FULL;
         }
@@ -721,7 +778,7 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
     /* Split reached the sub-tree root — create new root. */
     int new_root_slot = slot_alloc(page);
     if (new_root_slot == 0) {
-        if (hier && hier->cl_strategy == MT_CL_STRAT_FENCE)
+        if (page->header.flags & MT_PAGE_FLAG_FENCE)
             refresh_fence_keys(page);
         return MT_PAGE_FULL;
     }
@@ -734,8 +791,10 @@ mt_status_t mt_page_insert(mt_lnode_t *page, int32_t key,
     new_root->inode.nkeys = 1;
     page->header.root_slot = (uint8_t)new_root_slot;
     page->header.sub_height++;
+    MT_PROBE4(cl_root_grow, key, page, page->header.sub_height,
+              page->header.nslots_used);
 
-    if (hier && hier->cl_strategy == MT_CL_STRAT_FENCE)
+    if (page->header.flags & MT_PAGE_FLAG_FENCE)
         refresh_fence_keys(page);
 
     return MT_OK;
@@ -747,7 +806,7 @@ mt_status_t mt_page_delete(mt_lnode_t *page, int32_t key,
                             const mt_hierarchy_t *hier)
 {
     /* Eytzinger delete: find key, remove, rebuild if CL leaf underflows. */
-    if (hier->cl_strategy == MT_CL_STRAT_EYTZ) {
+    if (page->header.flags & MT_PAGE_FLAG_EYTZ) {
         int32_t all[256];
         int n = mt_page_extract_sorted(page, all);
         /* Binary search for the key. */
@@ -762,7 +821,8 @@ mt_status_t mt_page_delete(mt_lnode_t *page, int32_t key,
         memmove(all + lo, all + lo + 1,
                 (size_t)(n - lo - 1) * sizeof(int32_t));
         n--;
-        mt_page_bulk_load(page, all, n, hier);
+        MT_PROBE3(eytz_rebuild, key, page, n);
+        eytz_rebuild(page, all, n);
         return (page->header.nkeys < (uint16_t)hier->min_page_keys)
                ? MT_UNDERFLOW : MT_OK;
     }
@@ -945,7 +1005,7 @@ mt_status_t mt_page_delete(mt_lnode_t *page, int32_t key,
         }
     }
 
-    if (hier->cl_strategy == MT_CL_STRAT_FENCE)
+    if (page->header.flags & MT_PAGE_FLAG_FENCE)
         refresh_fence_keys(page);
 
 check_page_underflow:
@@ -992,19 +1052,99 @@ int mt_page_extract_sorted(const mt_lnode_t *page, int32_t *out)
     return extract_subtree(page, page->header.root_slot, out, 0);
 }
 
-/* ── Page-level bulk load ──────────────────────────────────── */
+/* In-order walk collecting CL leaves rather than their keys. */
+static int collect_cl_leaves(const mt_lnode_t *page, int slot,
+                              const mt_cl_leaf_t **out, int pos)
+{
+    const mt_cl_slot_t *s = get_slot_c(page, slot);
 
-void mt_page_bulk_load(mt_lnode_t *page, const int32_t *sorted_keys, int nkeys,
-                        const mt_hierarchy_t *hier)
+    if (s->type == MT_CL_LEAF) {
+        out[pos] = &s->leaf;
+        return pos + 1;
+    }
+    if (page->header.flags & MT_PAGE_FLAG_EYTZ) {
+        for (int i = 0; i < s->inode_eytz.nchildren; i++)
+            pos = collect_cl_leaves(page, slot + 1 + i, out, pos);
+        return pos;
+    }
+    for (int i = 0; i <= s->inode.nkeys; i++)
+        pos = collect_cl_leaves(page, s->inode.children[i], out, pos);
+    return pos;
+}
+
+int mt_page_cl_leaves(const mt_lnode_t *page, const mt_cl_leaf_t **out)
+{
+    if (page->header.nkeys == 0)
+        return 0;
+    return collect_cl_leaves(page, page->header.root_slot, out, 0);
+}
+
+/* In-order walk over only the children whose key span meets [lo, hi].
+   Children are prefetched before descending so sibling lines load in
+   parallel.  *past is set once a separator above hi is seen. */
+static int collect_cl_range(const mt_lnode_t *page, int slot,
+                            int32_t lo, int32_t hi,
+                            const mt_cl_leaf_t **out, int pos, bool *past)
 {
-    int strategy = hier ? hier->cl_strategy : MT_CL_STRAT_DEFAULT;
+    const mt_cl_slot_t *s = get_slot_c(page, slot);
+
+    if (s->type == MT_CL_LEAF) {
+        out[pos] = &s->leaf;
+        return pos + 1;
+    }
+
+    int a, b, last;
+    if (page->header.flags & MT_PAGE_FLAG_EYTZ) {
+        a = cl_inode_search_eytz(&s->inode_eytz, lo);
+        b = cl_inode_search_eytz(&s->inode_eytz, hi);
+        last = s->inode_eytz.nchildren - 1;
+        for (int i = a; i <= b; i++)
+            __builtin_prefetch(get_slot_c(page, slot + 1 + i), 0, 1);
+        for (int i = a; i <= b; i++)
+            pos = collect_cl_range(page, slot + 1 + i, lo, hi, out, pos, past);
+    } else {
+        a = cl_inode_search(&s->inode, lo);
+        b = cl_inode_search(&s->inode, hi);
+        last = s->inode.nkeys;
+        for (int i = a; i <= b; i++)
+            __builtin_prefetch(get_slot_c(page, s->inode.children[i]), 0, 1);
+        for (int i = a; i <= b; i++)
+            pos = collect_cl_range(page, s->inode.children[i], lo, hi,
+                                   out, pos, past);
+    }
+    if (b < last)
+        *past = true;
+    return pos;
+}
+
+int mt_page_cl_range(const mt_lnode_t *page, int32_t lo, int32_t hi,
+                     const mt_cl_leaf_t **out, bool *past)
+{
+    *past = false;
+    if (page->header.nkeys == 0)
+        return 0;
+    return collect_cl_range(page, page->header.root_slot, lo, hi, out, 0,
+                            past);
+}
 
+/* ── Page-level bulk load ──────────────────────────────────── */
+
+/* Build `page` from sorted keys with the given colour and CL strategy.
+   The colour is passed in because a staged page is built away from its
+   final address.  The strategy is recorded in the page flags, which
+   every later operation on the page goes by. */
+static void page_build(mt_lnode_t *page, uint8_t color, int strategy,
+                       const int32_t *sorted_keys, int nkeys)
+{
     /* Reset page to empty state. */
     memset(page, 0, MT_PAGE_SIZE);
     page->header.type = MT_NODE_LEAF;
     page->header.slot_bitmap = 1;  /* bit 0 = header */
     if (strategy == MT_CL_STRAT_EYTZ)
         page->header.flags |= MT_PAGE_FLAG_EYTZ;
+    else if (strategy == MT_CL_STRAT_FENCE)
+        page->header.flags |= MT_PAGE_FLAG_FENCE;
+    page->header.flags |= (uint8_t)(color << MT_PAGE_COLOR_SHIFT);
 
     if (nkeys == 0) {
         /* Allocate one empty CL leaf as root. */
@@ -1147,6 +1287,64 @@ void mt_page_bulk_load(mt_lnode_t *page, const int32_t *sorted_keys, int nkeys,
         refresh_fence_keys(page);
 }
 
+void mt_page_bulk_load(mt_lnode_t *page, const int32_t *sorted_keys, int nkeys,
+                        const mt_hierarchy_t *hier)
+{
+    uint8_t color = (hier && hier->color_pages) ? mt_page_color_for(page) : 0;
+    page_build(page, color, hier_strategy(hier), sorted_keys, nkeys);
+}
+
+void mt_page_bulk_load_color(mt_lnode_t *page, uint8_t color,
+                             const int32_t *sorted_keys, int nkeys,
+                             const mt_hierarchy_t *hier)
+{
+    page_build(page, color, hier_strategy(hier), sorted_keys, nkeys);
+}
+
+/* ── Streaming build ───────────────────────────────────────── */
+
+/* Copy a 4 KiB page with non-temporal stores, so its lines go to memory
+   without displacing the cache.  The caller issues _mm_sfence() before
+   the pages are published. */
+void mt_page_stream(void *dst, const void *src)
+{
+    char *d = dst;
+    const char *s = src;
+#if defined(__AVX512F__)
+    for (size_t off = 0; off < MT_PAGE_SIZE; off += 64)
+        _mm512_stream_si512((__m512i *)(d + off),
+                            _mm512_load_si512((const __m512i *)(s + off)));
+#elif defined(__AVX2__)
+    for (size_t off = 0; off < MT_PAGE_SIZE; off += 32)
+        _mm256_stream_si256((__m256i *)(d + off),
+                            _mm256_load_si256((const __m256i *)(s + off)));
+#else
+    for (size_t off = 0; off < MT_PAGE_SIZE; off += 16)
+        _mm_stream_si128((__m128i *)(d + off),
+                         _mm_load_si128((const __m128i *)(s + off)));
+#endif
+}
+
+/* Bulk-load `page` via a staging copy on the stack, which stays in L1,
+   then stream it out: each destination line is written exactly once
+   and never read.  The leaf links are set before streaming, and the
+   parent's tagged pointer is derived from the staged header. */
+mt_node_t *mt_page_bulk_load_nt(mt_lnode_t *page, const int32_t *sorted_keys,
+                                int nkeys, const mt_hierarchy_t *hier,
+                                mt_lnode_t *prev, mt_lnode_t *next)
+{
+    _Alignas(MT_PAGE_SIZE) mt_lnode_t stage;
+    uint8_t color = (hier && hier->color_pages) ? mt_page_color_for(page) : 0;
+
+    page_build(&stage, color, hier_strategy(hier), sorted_keys, nkeys);
+    stage.header.prev = prev;
+    stage.header.next = next;
+    uintptr_t tag = (uintptr_t)mt_tag_leaf_ptr((mt_node_t *)&stage)
+                  & MT_PTR_TAG_MASK;
+    mt_page_stream(page, &stage);
+    return (mt_node_t *)((uintptr_t)page | tag);
+}
+
 /* ── Page initialisation ───────────────────────────────────── */
 
 void mt_page_init(mt_lnode_t *page)
@@ -1204,3 +1402,141 @@ int32_t mt_page_min_key(const mt_lnode_t *page)
     }
     return (s->leaf.nkeys > 0) ? s->leaf.keys[0] : MT_KEY_MAX;
 }
+
+/* ── Page max key ──────────────────────────────────────────── */
+
+/* Walk to the rightmost CL leaf (Eytzinger: last implicit child).
+   With `x` set, touches the slots it reads. */
+static inline int page_rightmost_slot(const mt_lnode_t *page,
+                                      mt_explain_ctx_t *x)
+{
+    int slot = page->header.root_slot;
+    const mt_cl_slot_t *s = get_slot_c(page, slot);
+    if (x) mt_explain_touch(x, s, MT_CL_SIZE);
+    while (s->type == MT_CL_INTERNAL) {
+        if (page->header.flags & MT_PAGE_FLAG_EYTZ)
+            slot = slot + s->inode_eytz.nchildren;
+        else
+            slot = s->inode.children[s->inode.nkeys];
+        s = get_slot_c(page, slot);
+        if (x) mt_explain_touch(x, s, MT_CL_SIZE);
+    }
+    return slot;
+}
+
+int32_t mt_page_max_key(const mt_lnode_t *page)
+{
+    if (page->header.nkeys == 0)
+        return INT32_MIN;
+
+    int slot = page_rightmost_slot(page, NULL);
+    const mt_cl_leaf_t *l = &get_slot_c(page, slot)->leaf;
+    return (l->nkeys > 0) ? l->keys[l->nkeys - 1] : INT32_MIN;
+}
+
+/* ── Explain ───────────────────────────────────────────────── */
+
+/* page_find_leaf and the CL leaf search of mt_page_search_key, one
+   timed step per CL node. */
+bool mt_page_explain(const mt_lnode_t *page, int32_t key, int32_t *result,
+                     mt_explain_ctx_t *x)
+{
+    uint64_t t = mt_explain_clock();
+    int nkeys = __atomic_load_n(&page->header.nkeys, __ATOMIC_RELAXED);
+    t = mt_explain_since(x, t);
+
+    int slot = page->header.root_slot;
+    int height = page->header.sub_height;
+    int nf = page->header.nfence;
+    bool eytz = (page->header.flags & MT_PAGE_FLAG_EYTZ) != 0;
+    bool fence = !eytz && height > 0 && nf > 0;
+    mt_explain_step(x, MATRYOSHKA_STEP_PAGE,
+                    eytz ? MATRYOSHKA_PATH_EYTZ
+                         : fence ? MATRYOSHKA_PATH_FENCE
+                                 : MATRYOSHKA_PATH_SEARCH,
+                    page, slot, -1, t);
+    mt_explain_touch(x, &page->header, sizeof(page->header));
+    x->out->eytz = eytz;
+    x->out->fence = fence;
+    if (nkeys == 0)
+        return false;
+
+    mt_sub_path_t path[MT_SUB_MAX_HEIGHT];
+    int path_len = 0;
+    int ci;
+
+    if (eytz) {
+        /* One Eytzinger root, children found by position. */
+        if (height > 0) {
+            const mt_cl_slot_t *s = get_slot_c(page, slot);
+            t = mt_explain_clock();
+            ci = cl_inode_search_eytz(&s->inode_eytz, key);
+            t = mt_explain_since(x, t);
+            mt_explain_step(x, MATRYOSHKA_STEP_CL_INODE, MATRYOSHKA_PATH_EYTZ,
+                            s, slot, ci, t);
+            mt_explain_touch(x, s, MT_CL_SIZE);
+            path[path_len].slot = (uint8_t)slot;
+            path[path_len++].child_idx = (uint8_t)ci;
+            slot = slot + 1 + ci;
+        }
+    } else {
+        int level = 0;
+        if (fence) {
+            t = mt_explain_clock();
+            ci = fence_search(page->header.fence_keys, nf, key);
+            t = mt_explain_since(x, t);
+            mt_explain_step(x, MATRYOSHKA_STEP_CL_INODE, MATRYOSHKA_PATH_FENCE,
+                            page, slot, ci, t);
+            path[path_len].slot = (uint8_t)slot;
+            path[path_len++].child_idx = (uint8_t)ci;
+            slot = page->header.fence_slots[ci];
+            level = 1;
+        }
+        for (; level < height; level++) {
+            const mt_cl_slot_t *s = get_slot_c(page, slot);
+            t = mt_explain_clock();
+            ci = cl_inode_search(&s->inode, key);
+            t = mt_explain_since(x, t);
+            mt_explain_step(x, MATRYOSHKA_STEP_CL_INODE,
+                            MATRYOSHKA_PATH_SEARCH, s, slot, ci, t);
+            mt_explain_touch(x, s, MT_CL_SIZE);
+            path[path_len].slot = (uint8_t)slot;
+            path[path_len++].child_idx = (uint8_t)ci;
+            slot = s->inode.children[ci];
+        }
+    }
+
+    const mt_cl_leaf_t *cl = &get_slot_c(page, slot)->leaf;
+    t = mt_explain_clock();
+    int pos = cl_leaf_predecessor(cl, key);
+    t = mt_explain_since(x, t);
+    mt_explain_step(x, MATRYOSHKA_STEP_CL_LEAF, MATRYOSHKA_PATH_SEARCH,
+                    cl, slot, pos, t);
+    mt_explain_touch(x, cl, MT_CL_SIZE);
+    if (pos >= 0) {
+        *result = cl->keys[pos];
+        return true;
+    }
+
+    t = mt_explain_clock();
+    int s = cl_prev_leaf(page, path, path_len, NULL);
+    t = mt_explain_since(x, t);
+    if (s < 0)
+        return false;
+    const mt_cl_leaf_t *prev = &get_slot_c(page, s)->leaf;
+    mt_explain_step(x, MATRYOSHKA_STEP_CL_PREV, MATRYOSHKA_PATH_SEARCH,
+                    prev, s, prev->nkeys - 1, t);
+    cl_prev_leaf(page, path, path_len, x);
+    if (prev->nkeys == 0)
+        return false;
+    *result = prev->keys[prev->nkeys - 1];
+    return true;
+}
+
+/* Touch what mt_page_max_key reads. */
+void mt_page_touch_max(const mt_lnode_t *page, mt_explain_ctx_t *x)
+{
+    mt_explain_touch(x, &page->header, sizeof(page->header));
+    if (page->header.nkeys > 0)
+        page_rightmost_slot(page, x);
+}
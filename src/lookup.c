@@ -0,0 +1,189 @@
+/*
+ * lookup.c — Prefetch hints and resumable step-wise lookups.
+ *
+ * For callers that cannot batch: an event loop issues matryoshka_prefetch
+ * or advances a matryoshka_lookup_t one node at a time, doing its own
+ * work while each step's prefetch is in flight.  A step reads only the
+ * node the previous step prefetched, so a step costs one search kernel
+ * on (ideally) cached lines.  The answer is the same as
+ * matryoshka_search, including the fallback to the previous leaf.
+ */
+
+#include "matryoshka_internal.h"
+
+/* Lookup states: what lk->node points at. */
+enum {
+    LK_INODE,       /* outer internal node at lk->level */
+    LK_SP,          /* superpage header */
+    LK_SP_INODE,    /* superpage internal page, lk->level levels left */
+    LK_PAGE,        /* leaf page */
+    LK_PREV_PAGE,   /* previous leaf page, for its maximum */
+    LK_PREV_SP,     /* previous superpage, for its maximum */
+};
+
+/* Prefetch the child an outer internal node points at.  A leaf's CL
+   root line comes from the tag, as in find_leaf. */
+static inline mt_node_t *prefetch_child(mt_node_t *raw, bool leaf)
+{
+    mt_node_t *node = mt_untag(raw);
+    __builtin_prefetch(node, 0, 1);
+    if (leaf) {
+        uint8_t rs = mt_ptr_root_slot(raw);
+        if (rs > 0)
+            __builtin_prefetch(&node->lnode.slots[rs - 1], 0, 1);
+    }
+    return node;
+}
+
+static inline const void *sp_page_at(const void *sp, int idx)
+{
+    return (const char *)sp + (size_t)idx * MT_PAGE_SIZE;
+}
+
+/* ── Prefetch hint ─────────────────────────────────────────── */
+
+void matryoshka_prefetch(const matryoshka_tree_t *tree, int32_t key,
+                          int depth)
+{
+    if (!tree || tree->n == 0)
+        return;
+
+    mt_node_t *node = tree->root;
+    int levels = (depth < 0 || depth > tree->height) ? tree->height : depth;
+    if (levels == 0) {
+        __builtin_prefetch(node, 0, 1);
+        return;
+    }
+    for (int i = 0; i < levels - 1; i++)
+        node = mt_untag(node->inode.children[mt_inode_search(&node->inode,
+                                                             key)]);
+    int idx = mt_inode_search(&node->inode, key);
+    prefetch_child(node->inode.children[idx],
+                   levels == tree->height && !tree->hier.use_superpages);
+}
+
+/* ── Step-wise lookup ──────────────────────────────────────── */
+
+void matryoshka_lookup_start(const matryoshka_tree_t *tree, int32_t key,
+                              matryoshka_lookup_t *lk)
+{
+    lk->key = key;
+    lk->found = false;
+    lk->result = 0;
+    lk->tree = tree;
+    lk->sp = NULL;
+    lk->level = 0;
+    lk->done = !tree || tree->n == 0;
+    if (lk->done)
+        return;
+
+    lk->node = tree->root;
+    if (tree->height > 0) {
+        lk->state = LK_INODE;
+    } else {
+        mt_heat_note(tree, lk->node, key, false);
+        lk->state = tree->hier.use_superpages ? LK_SP : LK_PAGE;
+    }
+    __builtin_prefetch(lk->node, 0, 1);
+}
+
+static void lk_finish(matryoshka_lookup_t *lk, bool found, int32_t result)
+{
+    lk->found = found;
+    lk->result = found ? result : 0;
+    lk->done = true;
+}
+
+/* No predecessor in this superpage: fall back to the previous one. */
+static void lk_prev_sp(matryoshka_lookup_t *lk)
+{
+    const mt_sp_header_t *prev = ((const mt_sp_header_t *)lk->sp)->prev;
+    if (!prev) {
+        lk_finish(lk, false, 0);
+        return;
+    }
+    lk->node = prev;
+    lk->state = LK_PREV_SP;
+    __builtin_prefetch(prev, 0, 1);
+}
+
+bool matryoshka_lookup_step(matryoshka_lookup_t *lk)
+{
+    if (lk->done)
+        return true;
+
+    const matryoshka_tree_t *tree = lk->tree;
+    int32_t key = lk->key;
+    int32_t result;
+
+    switch (lk->state) {
+    case LK_INODE: {
+        const mt_inode_t *in = lk->node;
+        int idx = mt_inode_search(in, key);
+        bool leaf = ++lk->level == tree->height;
+        bool sp = tree->hier.use_superpages;
+        lk->node = prefetch_child(in->children[idx], leaf && !sp);
+        if (leaf) {
+            mt_heat_note(tree, lk->node, key, false);
+            lk->state = sp ? LK_SP : LK_PAGE;
+        }
+        break;
+    }
+    case LK_SP: {
+        const mt_sp_header_t *hdr = lk->node;
+        lk->sp = hdr;
+        if (hdr->nkeys == 0) {
+            lk_prev_sp(lk);
+            break;
+        }
+        lk->level = hdr->sub_height;
+        lk->node = sp_page_at(hdr, hdr->root_page);
+        lk->state = lk->level > 0 ? LK_SP_INODE : LK_PAGE;
+        __builtin_prefetch(lk->node, 0, 1);
+        break;
+    }
+    case LK_SP_INODE: {
+        const mt_sp_inode_t *in = lk->node;
+        int ci = mt_sp_inode_search(in, key);
+        lk->node = sp_page_at(lk->sp, in->children[ci]);
+        if (--lk->level == 0)
+            lk->state = LK_PAGE;
+        __builtin_prefetch(lk->node, 0, 1);
+        break;
+    }
+    case LK_PAGE: {
+        const mt_lnode_t *page = lk->node;
+        if (mt_page_search_key(page, key, &result)) {
+            lk_finish(lk, true, result);
+        } else if (page->header.prev) {
+            lk->node = page->header.prev;
+            lk->state = LK_PREV_PAGE;
+            __builtin_prefetch(lk->node, 0, 1);
+        } else if (lk->sp) {
+            lk_prev_sp(lk);
+        } else {
+            lk_finish(lk, false, 0);
+        }
+        break;
+    }
+    case LK_PREV_PAGE: {
+        const mt_lnode_t *prev = lk->node;
+        if (prev->header.nkeys > 0)
+            lk_finish(lk, true, mt_page_max_key(prev));
+        else if (lk->sp)
+            lk_prev_sp(lk);
+        else
+            lk_finish(lk, false, 0);
+        break;
+    }
+    case LK_PREV_SP: {
+        const mt_sp_header_t *prev = lk->node;
+        if (prev->nkeys > 0)
+            lk_finish(lk, true, mt_sp_max_key(prev));
+        else
+            lk_finish(lk, false, 0);
+        break;
+    }
+    }
+    return lk->done;
+}
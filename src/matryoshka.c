@@ -67,11 +67,67 @@ static mt_lnode_t *find_leaf(mt_node_t *root, int height, int32_t key,
     return &node->lnode;
 }
 
+/* ── Scratch ──────────────────────────────────────────────────── */
+
+/* The workspace (matryoshka_set_workspace) is split in two: the first
+   part holds the keys of superpages being split or merged, the rest a
+   batch's sorted copy, so a batch may split superpages while its copy
+   is live.  Requests that do not fit fall back to malloc. */
+static size_t ws_split_keys(const matryoshka_tree_t *tree)
+{
+    return tree->hier.use_superpages ? 2 * MT_SP_KEY_CAP : 0;
+}
+
+static int32_t *ws_split(matryoshka_tree_t *tree, size_t n)
+{
+    if (tree->ws && n <= ws_split_keys(tree) &&
+        tree->ws_keys >= ws_split_keys(tree))
+        return tree->ws;
+    return malloc((n ? n : 1) * sizeof(int32_t));
+}
+
+static int32_t *ws_batch(matryoshka_tree_t *tree, size_t n)
+{
+    size_t base = ws_split_keys(tree);
+    if (tree->ws && tree->ws_keys >= base && n <= tree->ws_keys - base)
+        return tree->ws + base;
+    return malloc(n * sizeof(int32_t));
+}
+
+static void ws_release(matryoshka_tree_t *tree, int32_t *p)
+{
+    if (!tree->ws || p < tree->ws || p >= tree->ws + tree->ws_keys)
+        free(p);
+}
+
+size_t matryoshka_workspace_size(const matryoshka_tree_t *tree,
+                                  size_t batch_keys)
+{
+    if (!tree) return 0;
+    return (ws_split_keys(tree) + batch_keys) * sizeof(int32_t);
+}
+
+void matryoshka_set_workspace(matryoshka_tree_t *tree, void *buf,
+                               size_t size)
+{
+    if (!tree) return;
+    tree->ws = buf;
+    tree->ws_keys = buf ? size / sizeof(int32_t) : 0;
+}
+
+/* Re-compress an internal node after an edit, if the tree asks for it. */
+static inline void inode_pack(const matryoshka_tree_t *tree, mt_inode_t *node)
+{
+    if (tree->hier.compress_inodes)
+        mt_inode_narrow(node);
+}
+
 /* Insert a separator key and right child pointer into an internal node
    at the given position. Caller must ensure the node has room. */
-static void inode_insert_at(mt_inode_t *node, int pos, int32_t key,
-                             mt_node_t *right_child)
+static void inode_insert_at(const matryoshka_tree_t *tree, mt_inode_t *node,
+                             int pos, int32_t key, mt_node_t *right_child)
 {
+    mt_inode_widen(node);
     int n = node->nkeys;
     memmove(node->keys + pos + 1, node->keys + pos,
             (size_t)(n - pos) * sizeof(int32_t));
@@ -80,32 +136,75 @@ static void inode_insert_at(mt_inode_t *node, int pos, int32_t key,
     node->keys[pos] = key;
     node->children[pos + 1] = right_child;
     node->nkeys = (uint16_t)(n + 1);
+    inode_pack(tree, node);
 }
 
 /* Remove a separator key and right child pointer from an internal node
    at the given position. */
-static void inode_remove_at(mt_inode_t *node, int pos)
+static void inode_remove_at(const matryoshka_tree_t *tree, mt_inode_t *node,
+                             int pos)
 {
+    mt_inode_widen(node);
     int n = node->nkeys;
     memmove(node->keys + pos, node->keys + pos + 1,
             (size_t)(n - pos - 1) * sizeof(int32_t));
     memmove(node->children + pos + 1, node->children + pos + 2,
             (size_t)(n - pos - 1) * sizeof(mt_node_t *));
     node->nkeys = (uint16_t)(n - 1);
+    inode_pack(tree, node);
 }
 
-/* Get the maximum key in a leaf page by walking to the rightmost CL leaf. */
-static int32_t page_max_key(const mt_lnode_t *page)
+/* Overwrite separator `pos` of an internal node. */
+static void inode_set_key(const matryoshka_tree_t *tree, mt_inode_t *node,
+                           int pos, int32_t key)
 {
-    int slot = page->header.root_slot;
-    const mt_cl_slot_t *s = &page->slots[slot - 1];
-    while (s->type == MT_CL_INTERNAL) {
-        slot = s->inode.children[s->inode.nkeys];
-        s = &page->slots[slot - 1];
-    }
-    return (s->leaf.nkeys > 0) ? s->leaf.keys[s->leaf.nkeys - 1] : MT_KEY_MAX;
+    mt_inode_widen(node);
+    node->keys[pos] = key;
+    inode_pack(tree, node);
+}
+
+/* ── Layout conversion helpers ────────────────────────────────── */
+
+/* The page flags `hier` builds `page` with. */
+static uint8_t layout_flags(const mt_hierarchy_t *hier,
+                            const mt_lnode_t *page)
+{
+    uint8_t flags = 0;
+    if (hier->cl_strategy == MT_CL_STRAT_EYTZ)
+        flags = MT_PAGE_FLAG_EYTZ;
+    else if (hier->cl_strategy == MT_CL_STRAT_FENCE)
+        flags = MT_PAGE_FLAG_FENCE;
+    if (hier->color_pages)
+        flags |= (uint8_t)(mt_page_color_for(page) << MT_PAGE_COLOR_SHIFT);
+    return flags;
+}
+
+/* During matryoshka_convert: whether `leaf` still has the old layout.
+   Such a page may hold more keys than a page of the new one, so splits
+   and merges rewrite it rather than carve it up. */
+static inline bool leaf_stale(const matryoshka_tree_t *tree,
+                              const mt_lnode_t *leaf)
+{
+    return tree->converting &&
+           leaf->header.flags != layout_flags(&tree->hier, leaf);
 }
 
+/* Exclusive upper bound of child `idx` of path[level], taken from the
+   lowest ancestor with a separator to its right; INT32_MAX + 1 if none. */
+static int64_t child_upper(const mt_path_t *path, int level, int idx)
+{
+    if (idx < path[level].node->nkeys)
+        return mt_inode_key(path[level].node, idx);
+    for (int l = level - 1; l >= 0; l--)
+        if (path[l].idx < path[l].node->nkeys)
+            return mt_inode_key(path[l].node, path[l].idx);
+    return (int64_t)INT32_MAX + 1;
+}
+
+static bool replace_in_parent(matryoshka_tree_t *tree, mt_path_t *path,
+                              int64_t lo, int64_t e,
+                              const int32_t *run, size_t n);
+
 /* ── Lifecycle ────────────────────────────────────────────────── */
 
 matryoshka_tree_t *matryoshka_create_with(const mt_hierarchy_t *hier)
@@ -115,6 +214,12 @@ matryoshka_tree_t *matryoshka_create_with(const mt_hierarchy_t *hier)
     tree->hier = *hier;
     tree->n = 0;
     tree->height = 0;
+    tree->heat = NULL;
+    tree->txn = NULL;
+    tree->ws = NULL;
+    tree->ws_keys = 0;
+    tree->converting = false;
+    tree->convert_at = 0;
 
     /* Create arena allocator for superpage leaves. */
     if (hier->leaf_alloc > MT_PAGE_SIZE) {
@@ -158,6 +263,59 @@ static void free_subtree(mt_node_t *node, int height, mt_allocator_t *alloc)
     }
 }
 
+/* Free the internal nodes only; the leaves go with their arenas. */
+static void free_inodes(mt_node_t *node, int height)
+{
+    if (height == 0) return;
+    mt_inode_t *in = &node->inode;
+    for (int i = 0; i <= in->nkeys; i++)
+        free_inodes(mt_untag(in->children[i]), height - 1);
+    mt_free_inode(node);
+}
+
+bool matryoshka_clear(matryoshka_tree_t *tree, bool keep_memory)
+{
+    if (!tree) return false;
+
+    mt_node_t *root;
+    if (keep_memory && tree->alloc && tree->alloc->arenas) {
+        /* A reset arena has every page free, so the root cannot fail. */
+        if (tree->root)
+            free_inodes(tree->root, tree->height);
+        mt_allocator_reset(tree->alloc);
+        root = mt_alloc_lnode(&tree->hier, tree->alloc);
+    } else {
+        /* Allocate the replacement before tearing anything down, so
+           out of memory the tree is left as it was. */
+        mt_allocator_t *alloc = NULL;
+        if (tree->alloc) {
+            alloc = mt_allocator_create(tree->alloc->arena_size,
+                                        tree->alloc->page_size);
+            if (!alloc) return false;
+        }
+        root = mt_alloc_lnode(&tree->hier, alloc);
+        if (!root) {
+            if (alloc) mt_allocator_destroy(alloc);
+            return false;
+        }
+        if (tree->root)
+            free_subtree(tree->root, tree->height, tree->alloc);
+        if (tree->alloc)
+            mt_allocator_destroy(tree->alloc);
+        tree->alloc = alloc;
+    }
+
+    tree->root = root;
+    tree->n = 0;
+    tree->height = 0;
+    tree->converting = false;
+    if (tree->hier.use_superpages)
+        mt_sp_init(tree->root);
+    else
+        mt_page_init_with(&tree->root->lnode, &tree->hier);
+    return true;
+}
+
 void matryoshka_destroy(matryoshka_tree_t *tree)
 {
     if (!tree) return;
@@ -165,6 +323,8 @@ void matryoshka_destroy(matryoshka_tree_t *tree)
         free_subtree(tree->root, tree->height, tree->alloc);
     if (tree->alloc)
         mt_allocator_destroy(tree->alloc);
+    mt_heat_destroy(tree->heat);
+    mt_txn_domain_destroy(tree->txn);
     free(tree);
 }
 
@@ -172,9 +332,64 @@ void matryoshka_destroy(matryoshka_tree_t *tree)
 
 typedef struct {
     mt_node_t *node;
+    mt_node_t *child;      /* pointer stored in the parent (tagged for pages) */
     int32_t    min_key;
 } build_entry_t;
 
+/* Build the internal levels over entries[0..count) bottom-up and make
+   the result the tree's root.  Takes ownership of entries. */
+static bool build_levels(matryoshka_tree_t *tree, build_entry_t *entries,
+                         size_t count)
+{
+    size_t level_count = count;
+    int height = 0;
+
+    while (level_count > 1) {
+        size_t num_parents = (level_count + MT_MAX_IKEYS) / (MT_MAX_IKEYS + 1);
+        if (num_parents == 0) num_parents = 1;
+
+        build_entry_t *new_entries = malloc(num_parents * sizeof(build_entry_t));
+        if (!new_entries) {
+            free(entries);
+            return false;
+        }
+
+        size_t children_per = level_count / num_parents;
+        size_t extra_c = level_count % num_parents;
+
+        size_t ci = 0;
+        for (size_t p = 0; p < num_parents; p++) {
+            size_t nc = children_per + (p < extra_c ? 1 : 0);
+
+            mt_node_t *parent = mt_alloc_inode();
+            mt_inode_t *in = &parent->inode;
+
+            in->children[0] = entries[ci].child;
+            for (size_t j = 1; j < nc; j++) {
+                in->keys[j - 1] = entries[ci + j].min_key;
+                in->children[j] = entries[ci + j].child;
+            }
+            in->nkeys = (uint16_t)(nc - 1);
+            inode_pack(tree, in);
+
+            new_entries[p].node = parent;
+            new_entries[p].child = parent;
+            new_entries[p].min_key = entries[ci].min_key;
+            ci += nc;
+        }
+
+        free(entries);
+        entries = new_entries;
+        level_count = num_parents;
+        height++;
+    }
+
+    tree->root = entries[0].node;
+    tree->height = height;
+    free(entries);
+    return true;
+}
+
 matryoshka_tree_t *matryoshka_bulk_load_with(const int32_t *sorted_keys,
                                               size_t n,
                                               const mt_hierarchy_t *hier)
@@ -183,6 +398,12 @@ matryoshka_tree_t *matryoshka_bulk_load_with(const int32_t *sorted_keys,
     if (!tree) return NULL;
     tree->hier = *hier;
     tree->n = n;
+    tree->heat = NULL;
+    tree->txn = NULL;
+    tree->ws = NULL;
+    tree->ws_keys = 0;
+    tree->converting = false;
+    tree->convert_at = 0;
 
     /* Initialise arena allocator. */
     if (hier->leaf_alloc > MT_PAGE_SIZE) {
@@ -214,18 +435,40 @@ matryoshka_tree_t *matryoshka_bulk_load_with(const int32_t *sorted_keys,
     build_entry_t *entries = malloc(nleaves * sizeof(build_entry_t));
     if (!entries) { free(tree); return NULL; }
 
+    /* The leaf builders overwrite every byte, so leaves are allocated
+       unzeroed.  Large builds stream their pages out (see
+       MT_STREAM_BUILD_BYTES); those are all placed first so each page is
+       written once with its links. */
+    bool stream = nleaves * hier->leaf_alloc >= MT_STREAM_BUILD_BYTES;
+    for (size_t i = 0; i < nleaves; i++)
+        entries[i].node = mt_alloc_lnode_raw(&tree->hier, tree->alloc);
+
     size_t offset = 0;
     for (size_t i = 0; i < nleaves; i++) {
         size_t k = keys_per + (i < extra ? 1 : 0);
-        mt_node_t *lnode = mt_alloc_lnode(&tree->hier, tree->alloc);
-        if (hier->use_superpages)
-            mt_sp_bulk_load(lnode, sorted_keys + offset, (int)k, hier);
-        else
+        mt_node_t *lnode = entries[i].node;
+        if (hier->use_superpages) {
+            if (stream)
+                mt_sp_bulk_load_nt(lnode, sorted_keys + offset, (int)k, hier);
+            else
+                mt_sp_bulk_load(lnode, sorted_keys + offset, (int)k, hier);
+            entries[i].child = lnode;
+        } else if (stream) {
+            mt_lnode_t *prev = (i > 0) ? &entries[i - 1].node->lnode : NULL;
+            mt_lnode_t *next = (i < nleaves - 1)
+                ? &entries[i + 1].node->lnode : NULL;
+            entries[i].child = mt_page_bulk_load_nt(&lnode->lnode,
+                                                    sorted_keys + offset,
+                                                    (int)k, hier, prev, next);
+        } else {
             mt_page_bulk_load(&lnode->lnode, sorted_keys + offset, (int)k, hier);
-        entries[i].node = lnode;
+            entries[i].child = NULL;   /* tagged once linked, below */
+        }
         entries[i].min_key = sorted_keys[offset];
         offset += k;
     }
+    if (stream)
+        _mm_sfence();
 
     /* Link leaves. */
     if (hier->use_superpages) {
@@ -243,73 +486,49 @@ matryoshka_tree_t *matryoshka_bulk_load_with(const int32_t *sorted_keys,
             last->header.next = first;
             first->header.prev = last;
         }
-    } else {
+    } else if (!stream) {
         for (size_t i = 0; i < nleaves; i++) {
             mt_lnode_t *l = &entries[i].node->lnode;
             l->header.prev = (i > 0) ? &entries[i - 1].node->lnode : NULL;
             l->header.next = (i < nleaves - 1)
                 ? &entries[i + 1].node->lnode : NULL;
+            entries[i].child = mt_tag_leaf_ptr(entries[i].node);
         }
     }
 
-    /* Build internal levels bottom-up. */
-    size_t level_count = nleaves;
-    int height = 0;
-
-    while (level_count > 1) {
-        size_t num_parents = (level_count + MT_MAX_IKEYS) / (MT_MAX_IKEYS + 1);
-        if (num_parents == 0) num_parents = 1;
-
-        build_entry_t *new_entries = malloc(num_parents * sizeof(build_entry_t));
-        if (!new_entries) {
-            free(entries);
-            free(tree);
-            return NULL;
-        }
-
-        size_t children_per = level_count / num_parents;
-        size_t extra_c = level_count % num_parents;
-
-        size_t ci = 0;
-        for (size_t p = 0; p < num_parents; p++) {
-            size_t nc = children_per + (p < extra_c ? 1 : 0);
-
-            mt_node_t *parent = mt_alloc_inode();
-            mt_inode_t *in = &parent->inode;
-
-            if (height == 0 && !hier->use_superpages) {
-                /* Tag leaf pointers with root_slot/sub_height. */
-                in->children[0] = mt_tag_leaf_ptr(entries[ci].node);
-                for (size_t j = 1; j < nc; j++) {
-                    in->keys[j - 1] = entries[ci + j].min_key;
-                    in->children[j] = mt_tag_leaf_ptr(entries[ci + j].node);
-                }
-            } else {
-                in->children[0] = entries[ci].node;
-                for (size_t j = 1; j < nc; j++) {
-                    in->keys[j - 1] = entries[ci + j].min_key;
-                    in->children[j] = entries[ci + j].node;
-                }
-            }
-            in->nkeys = (uint16_t)(nc - 1);
-
-            new_entries[p].node = parent;
-            new_entries[p].min_key = entries[ci].min_key;
-            ci += nc;
-        }
-
-        free(entries);
-        entries = new_entries;
-        level_count = num_parents;
-        height++;
+    if (!build_levels(tree, entries, nleaves)) {
+        free(tree);
+        return NULL;
     }
-
-    tree->root = entries[0].node;
-    tree->height = height;
-    free(entries);
     return tree;
 }
 
+/* Adopt leaves built outside this file (see export.c). */
+bool mt_tree_adopt_pages(matryoshka_tree_t *tree, mt_node_t **pages,
+                         const int32_t *min_keys, size_t npages, size_t n)
+{
+    if (npages == 0)
+        return true;
+    build_entry_t *entries = malloc(npages * sizeof(build_entry_t));
+    if (!entries)
+        return false;
+    for (size_t i = 0; i < npages; i++) {
+        mt_lnode_t *l = &pages[i]->lnode;
+        l->header.prev = (i > 0) ? &pages[i - 1]->lnode : NULL;
+        l->header.next = (i < npages - 1) ? &pages[i + 1]->lnode : NULL;
+        entries[i].node = pages[i];
+        entries[i].child = mt_tag_leaf_ptr(pages[i]);
+        entries[i].min_key = min_keys[i];
+    }
+    mt_node_t *old_root = tree->root;
+    int old_height = tree->height;
+    if (!build_levels(tree, entries, npages))
+        return false;
+    free_subtree(old_root, old_height, tree->alloc);
+    tree->n = n;
+    return true;
+}
+
 matryoshka_tree_t *matryoshka_bulk_load(const int32_t *sorted_keys, size_t n)
 {
     mt_hierarchy_t hier;
@@ -336,6 +555,7 @@ bool matryoshka_search(const matryoshka_tree_t *tree, int32_t key,
         int idx = mt_inode_search(&node->inode, key);
         node = mt_untag(node->inode.children[idx]);
     }
+    mt_heat_note(tree, node, key, false);
 
     if (tree->hier.use_superpages) {
         if (mt_sp_search_key(node, key, result))
@@ -358,7 +578,7 @@ bool matryoshka_search(const matryoshka_tree_t *tree, int32_t key,
     if (leaf->header.prev) {
         mt_lnode_t *prev = leaf->header.prev;
         if (prev->header.nkeys > 0) {
-            if (result) *result = page_max_key(prev);
+            if (result) *result = mt_page_max_key(prev);
             return true;
         }
     }
@@ -377,12 +597,126 @@ bool matryoshka_contains(const matryoshka_tree_t *tree, int32_t key)
         int idx = mt_inode_search(&node->inode, key);
         node = mt_untag(node->inode.children[idx]);
     }
+    mt_heat_note(tree, node, key, false);
 
     if (tree->hier.use_superpages)
         return mt_sp_contains(node, key);
     return mt_page_contains(&node->lnode, key);
 }
 
+/* ── Gap search ───────────────────────────────────────────────── */
+/*
+ * A run of n distinct keys is gap-free exactly when max - min + 1 == n,
+ * so dense regions are skipped by comparing counts against extents:
+ * first a page's nkeys against the width of its separator interval in
+ * the parent (header only), then against its own min/max, then each CL
+ * leaf's nkeys against its first/last key.  Keys are only read inside
+ * the one CL leaf that actually holds the gap.  Bounds are int64_t so
+ * that "one past INT32_MAX" is representable.
+ */
+
+/* First key >= c absent from `page`.  Sets *at_end when the answer is
+   one past the page's last key, i.e. the next page decides. */
+static int64_t page_first_absent(const mt_lnode_t *page, int64_t c,
+                                 bool *at_end)
+{
+    int n = page->header.nkeys;
+    *at_end = false;
+    if (n == 0)
+        return c;
+
+    int64_t pmin = mt_page_min_key(page), pmax = mt_page_max_key(page);
+    if (c < pmin || c > pmax)
+        return c;
+    *at_end = true;
+    if (pmax - pmin + 1 == n)
+        return pmax + 1;
+
+    /* Only the CL leaves from the one holding c on: the dense lines
+       before it are never read. */
+    const mt_cl_leaf_t *lines[MT_PAGE_SLOTS];
+    bool past;
+    int nl = mt_page_cl_range(page, (int32_t)c, (int32_t)pmax, lines, &past);
+    for (int i = 0; i < nl; i++) {
+        const mt_cl_leaf_t *cl = lines[i];
+        int nk = cl->nkeys;
+        if (nk == 0 || cl->keys[nk - 1] < c)
+            continue;
+        if (cl->keys[0] > c) {
+            *at_end = false;
+            return c;
+        }
+        if ((int64_t)cl->keys[nk - 1] - cl->keys[0] + 1 == nk) {
+            c = (int64_t)cl->keys[nk - 1] + 1;
+            continue;
+        }
+        int j = 0;
+        while (cl->keys[j] < c)
+            j++;
+        if (cl->keys[j] != c) {
+            *at_end = false;
+            return c;
+        }
+        while (j + 1 < nk && cl->keys[j + 1] == cl->keys[j] + 1)
+            j++;
+        c = (int64_t)cl->keys[j] + 1;
+        if (j + 1 < nk) {
+            *at_end = false;
+            return c;
+        }
+    }
+    return c;
+}
+
+/* First key >= c absent from the subtree at `node`, whose keys all lie
+   in [lo, hi].  Returns hi + 1 if [c, hi] is fully present. */
+static int64_t subtree_first_absent(const matryoshka_tree_t *tree,
+                                    mt_node_t *node, int level,
+                                    int64_t c, int64_t lo, int64_t hi)
+{
+    if (level == tree->height) {
+        bool at_end;
+        if (!tree->hier.use_superpages) {
+            if (node->lnode.header.nkeys == hi - lo + 1)
+                return hi + 1;
+            return page_first_absent(&node->lnode, c, &at_end);
+        }
+        if (((mt_sp_header_t *)node)->nkeys == hi - lo + 1)
+            return hi + 1;
+        const mt_lnode_t *page = mt_sp_find_leaf(node, (int32_t)c);
+        for (; page && c <= hi; page = page->header.next) {
+            c = page_first_absent(page, c, &at_end);
+            if (!at_end)
+                break;
+        }
+        return c;
+    }
+
+    const mt_inode_t *in = &node->inode;
+    for (int i = mt_inode_search(in, (int32_t)c); i <= in->nkeys; i++) {
+        int64_t clo = (i > 0) ? mt_inode_key(in, i - 1) : lo;
+        int64_t chi = (i < in->nkeys) ? (int64_t)mt_inode_key(in, i) - 1 : hi;
+        c = subtree_first_absent(tree, mt_untag(in->children[i]),
+                                 level + 1, c, clo, chi);
+        if (c <= chi)
+            return c;
+    }
+    return c;
+}
+
+bool matryoshka_first_absent(const matryoshka_tree_t *tree, int32_t x,
+                              int32_t *result)
+{
+    int64_t c = x;
+    if (tree && tree->n > 0)
+        c = subtree_first_absent(tree, tree->root, 0, x,
+                                 INT32_MIN, INT32_MAX);
+    if (c > INT32_MAX)
+        return false;
+    if (result) *result = (int32_t)c;
+    return true;
+}
+
 /* ── Split propagation helper ─────────────────────────────────── */
 
 /* Propagate a leaf split up through internal nodes.
@@ -392,12 +726,13 @@ static void propagate_leaf_split(matryoshka_tree_t *tree, mt_path_t *path,
 {
     for (int level = tree->height - 1; level >= 0; level--) {
         mt_inode_t *parent = path[level].node;
+        mt_inode_widen(parent);
 
         if (parent->nkeys < MT_MAX_IKEYS) {
             int pos = 0;
             while (pos < parent->nkeys && parent->keys[pos] < sep)
                 pos++;
-            inode_insert_at(parent, pos, sep, right_child);
+            inode_insert_at(tree, parent, pos, sep, right_child);
             return;
         }
 
@@ -438,6 +773,8 @@ static void propagate_leaf_split(matryoshka_tree_t *tree, mt_path_t *path,
         memcpy(ri->children, all_children + left_keys + 1,
                (size_t)(right_keys + 1) * sizeof(mt_node_t *));
         ri->nkeys = (uint16_t)right_keys;
+        inode_pack(tree, parent);
+        inode_pack(tree, ri);
 
         right_child = new_rinode;
     }
@@ -452,13 +789,15 @@ static void propagate_leaf_split(matryoshka_tree_t *tree, mt_path_t *path,
                        ? mt_tag_leaf_ptr(tree->root) : tree->root;
     nr->children[1] = right_child;
     nr->nkeys = 1;
+    inode_pack(tree, nr);
     tree->root = new_root;
     tree->height++;
 }
 
 /* Split a full superpage, insert key into the correct half,
-   link the new superpage, and propagate the split upward. */
-static void split_sp_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
+   link the new superpage, and propagate the split upward.  Returns
+   false, tree unchanged, if out of memory. */
+static bool split_sp_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
                                   mt_node_t *sp_node, int32_t key)
 {
     mt_sp_header_t *sp = (mt_sp_header_t *)sp_node;
@@ -472,9 +811,17 @@ static void split_sp_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
     mt_lnode_t *fl_prev = first_leaf->header.prev;  /* prev sp's last page */
 
     mt_node_t *new_rnode = mt_alloc_lnode(&tree->hier, tree->alloc);
+    if (!new_rnode)
+        return false;
     mt_sp_header_t *new_right = (mt_sp_header_t *)new_rnode;
 
-    int32_t sep = mt_sp_split(sp_node, new_rnode, &tree->hier);
+    int32_t *scratch = ws_split(tree, sp->nkeys);
+    if (!scratch) {
+        mt_free_lnode(new_rnode, tree->alloc);
+        return false;
+    }
+    int32_t sep = mt_sp_split(sp_node, new_rnode, &tree->hier, scratch);
+    ws_release(tree, scratch);
 
     if (key < sep)
         mt_sp_insert(sp_node, key, &tree->hier);
@@ -511,19 +858,34 @@ static void split_sp_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
     }
 
     sep = mt_sp_min_key(new_rnode);
+    MT_PROBE5(sp_split, sep, sp, new_right, sp->nkeys, new_right->nkeys);
     propagate_leaf_split(tree, path, sep, new_rnode);
+    return true;
 }
 
 /* Split a full leaf, insert key into the correct half,
-   link the new leaf, and propagate the split upward. */
-static void split_leaf_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
+   link the new leaf, and propagate the split upward.  Returns false,
+   tree unchanged, if out of memory. */
+static bool split_leaf_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
                                     mt_lnode_t *leaf, int32_t key)
 {
+    /* A page of the old layout may not fit in two of the new one:
+       rebuild it, key included, into as many pages as it takes.  An
+       ordinary split is no fallback, so a failed rebuild fails. */
+    if (leaf_stale(tree, leaf)) {
+        if (!replace_in_parent(tree, path, key, (int64_t)key + 1, &key, 1))
+            return false;
+        tree->n--;  /* counted by the caller */
+        return true;
+    }
+
     /* Save linked list pointers before split (bulk_load zeroes the page). */
     mt_lnode_t *saved_prev = leaf->header.prev;
     mt_lnode_t *saved_next = leaf->header.next;
 
     mt_node_t *new_rnode = mt_alloc_lnode(&tree->hier, tree->alloc);
+    if (!new_rnode)
+        return false;
     mt_lnode_t *new_right = &new_rnode->lnode;
 
     int32_t sep = mt_page_split(leaf, new_right, &tree->hier);
@@ -542,9 +904,12 @@ static void split_leaf_and_insert(matryoshka_tree_t *tree, mt_path_t *path,
     leaf->header.next = new_right;
 
     sep = mt_page_min_key(new_right);
+    MT_PROBE5(leaf_split, sep, leaf, new_right, leaf->header.nkeys,
+              new_right->header.nkeys);
     /* Re-tag existing left leaf (root_slot may have changed after insert). */
     retag_leaf_in_parent(path, tree->height);
     propagate_leaf_split(tree, path, sep, mt_tag_leaf_ptr(new_rnode));
+    return true;
 }
 
 /* ── Insert ───────────────────────────────────────────────────── */
@@ -565,17 +930,20 @@ bool matryoshka_insert(matryoshka_tree_t *tree, int32_t key)
             node = mt_untag(node->inode.children[idx]);
         }
 
+        mt_heat_note(tree, node, key, true);
         mt_status_t status = mt_sp_insert(node, key, &tree->hier);
         if (status == MT_DUPLICATE) return false;
         if (status == MT_OK) { tree->n++; return true; }
 
         /* MT_PAGE_FULL: superpage out of pages — split. */
-        split_sp_and_insert(tree, path, node, key);
+        if (!split_sp_and_insert(tree, path, node, key))
+            return false;
         tree->n++;
         return true;
     }
 
     mt_lnode_t *leaf = find_leaf(tree->root, tree->height, key, path);
+    mt_heat_note(tree, leaf, key, true);
 
     mt_status_t status = mt_page_insert(leaf, key, &tree->hier);
 
@@ -589,171 +957,49 @@ bool matryoshka_insert(matryoshka_tree_t *tree, int32_t key)
     }
 
     /* MT_PAGE_FULL: split and insert. */
-    split_leaf_and_insert(tree, path, leaf, key);
+    if (!split_leaf_and_insert(tree, path, leaf, key))
+        return false;
     tree->n++;
     return true;
 }
 
 /* ── Delete (Jannink eager deletion) ──────────────────────────── */
 
-/* Rebalance after leaf underflow.  `level` is the path index of the
-   leaf's parent (tree->height - 1).  Propagates upward as needed. */
-static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
-                            mt_lnode_t *leaf, int level)
+/* Fix internal-node underflow from path[level] upward after a child
+   was removed: rotate a key through the parent from a sibling with
+   spare keys, else merge with a sibling.  Shared by rebalance_leaf and
+   rebalance_sp. */
+static void rebalance_inodes(matryoshka_tree_t *tree, mt_path_t *path,
+                              int level)
 {
-    mt_inode_t *parent = path[level].node;
-    int cidx = path[level].idx;
-    int min_page = tree->hier.min_page_keys;
-
-    /* Try redistribute from left sibling. */
-    if (cidx > 0) {
-        mt_lnode_t *left = &mt_untag(parent->children[cidx - 1])->lnode;
-        if (left->header.nkeys > min_page) {
-            int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
-            int ln = mt_page_extract_sorted(left, lsorted);
-            int rn = mt_page_extract_sorted(leaf, rsorted);
-
-            int total = ln + rn;
-            int new_ln = total / 2;
-            int move = ln - new_ln;
-
-            int32_t new_right[MT_MAX_PAGE_KEYS];
-            memcpy(new_right, lsorted + new_ln, (size_t)move * sizeof(int32_t));
-            memcpy(new_right + move, rsorted, (size_t)rn * sizeof(int32_t));
-            int new_rn = move + rn;
-
-            /* Save linked list pointers (bulk_load zeroes the page). */
-            struct mt_lnode *lp = left->header.prev;
-            struct mt_lnode *ln_next = left->header.next;
-            struct mt_lnode *rp = leaf->header.prev;
-            struct mt_lnode *rn_next = leaf->header.next;
-
-            mt_page_bulk_load(left, lsorted, new_ln, &tree->hier);
-            mt_page_bulk_load(leaf, new_right, new_rn, &tree->hier);
-
-            left->header.prev = lp;
-            left->header.next = ln_next;
-            leaf->header.prev = rp;
-            leaf->header.next = rn_next;
+    for (int lv = level; lv >= 0; lv--) {
+        mt_inode_t *node = path[lv].node;
 
-            parent->keys[cidx - 1] = new_right[0];
+        /* Root can have fewer keys — only collapse if it has 0 keys. */
+        if (lv == 0) {
+            if (node->nkeys == 0 && tree->height > 0) {
+                mt_node_t *child = mt_untag(node->children[0]);
+                mt_free_inode((mt_node_t *)node);
+                tree->root = child;
+                tree->height--;
+            }
             return;
         }
-    }
-
-    /* Try redistribute from right sibling. */
-    if (cidx < parent->nkeys) {
-        mt_lnode_t *right = &mt_untag(parent->children[cidx + 1])->lnode;
-        if (right->header.nkeys > min_page) {
-            int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
-            int ln = mt_page_extract_sorted(leaf, lsorted);
-            int rn = mt_page_extract_sorted(right, rsorted);
 
-            int total = ln + rn;
-            int new_ln = total / 2;
-            int move = new_ln - ln;
-
-            int32_t new_left[MT_MAX_PAGE_KEYS];
-            memcpy(new_left, lsorted, (size_t)ln * sizeof(int32_t));
-            memcpy(new_left + ln, rsorted, (size_t)move * sizeof(int32_t));
-
-            int32_t new_right_keys[MT_MAX_PAGE_KEYS];
-            int new_rn = rn - move;
-            memcpy(new_right_keys, rsorted + move,
-                   (size_t)new_rn * sizeof(int32_t));
-
-            struct mt_lnode *lp = leaf->header.prev;
-            struct mt_lnode *ln_next = leaf->header.next;
-            struct mt_lnode *rp = right->header.prev;
-            struct mt_lnode *rn_next = right->header.next;
-
-            mt_page_bulk_load(leaf, new_left, new_ln, &tree->hier);
-            mt_page_bulk_load(right, new_right_keys, new_rn, &tree->hier);
-
-            leaf->header.prev = lp;
-            leaf->header.next = ln_next;
-            right->header.prev = rp;
-            right->header.next = rn_next;
-
-            parent->keys[cidx] = new_right_keys[0];
-            return;
-        }
-    }
-
-    /* Cannot redistribute — merge.  Prefer merging with left sibling. */
-    if (cidx > 0) {
-        mt_lnode_t *left = &mt_untag(parent->children[cidx - 1])->lnode;
-        int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
-        int ln = mt_page_extract_sorted(left, lsorted);
-        int rn = mt_page_extract_sorted(leaf, rsorted);
-
-        int32_t merged[MT_MAX_PAGE_KEYS];
-        memcpy(merged, lsorted, (size_t)ln * sizeof(int32_t));
-        memcpy(merged + ln, rsorted, (size_t)rn * sizeof(int32_t));
-
-        struct mt_lnode *lp = left->header.prev;
-
-        mt_page_bulk_load(left, merged, ln + rn, &tree->hier);
-
-        /* Restore and update linked list. */
-        left->header.prev = lp;
-        left->header.next = leaf->header.next;
-        if (leaf->header.next)
-            leaf->header.next->header.prev = left;
-
-        inode_remove_at(parent, cidx - 1);
-        mt_free_lnode((mt_node_t *)leaf, tree->alloc);
-    } else {
-        /* Merge with right sibling. */
-        mt_lnode_t *right = &mt_untag(parent->children[cidx + 1])->lnode;
-        int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
-        int ln = mt_page_extract_sorted(leaf, lsorted);
-        int rn = mt_page_extract_sorted(right, rsorted);
-
-        int32_t merged[MT_MAX_PAGE_KEYS];
-        memcpy(merged, lsorted, (size_t)ln * sizeof(int32_t));
-        memcpy(merged + ln, rsorted, (size_t)rn * sizeof(int32_t));
-
-        struct mt_lnode *lp = leaf->header.prev;
-
-        mt_page_bulk_load(leaf, merged, ln + rn, &tree->hier);
-
-        /* Restore and update linked list. */
-        leaf->header.prev = lp;
-        leaf->header.next = right->header.next;
-        if (right->header.next)
-            right->header.next->header.prev = leaf;
-
-        inode_remove_at(parent, cidx);
-        mt_free_lnode((mt_node_t *)right, tree->alloc);
-    }
-
-    /* Propagate internal underflow upward. */
-    for (int lv = level; lv >= 0; lv--) {
-        mt_inode_t *node = path[lv].node;
-
-        /* Root can have fewer keys — only collapse if it has 0 keys. */
-        if (lv == 0) {
-            if (node->nkeys == 0 && tree->height > 0) {
-                mt_node_t *child = mt_untag(node->children[0]);
-                mt_free_inode((mt_node_t *)node);
-                tree->root = child;
-                tree->height--;
-            }
-            return;
-        }
-
-        if (node->nkeys >= MT_MIN_IKEYS)
-            return;
+        if (node->nkeys >= MT_MIN_IKEYS)
+            return;
 
         /* Internal node underflow.  Parent is path[lv-1]. */
         mt_inode_t *pp = path[lv - 1].node;
         int pi = path[lv - 1].idx;  /* child index of `node` in pp */
+        mt_inode_widen(node);
+        mt_inode_widen(pp);
 
         /* Try redistribute from left internal sibling. */
         if (pi > 0) {
             mt_inode_t *lsib = &mt_untag(pp->children[pi - 1])->inode;
             if (lsib->nkeys > MT_MIN_IKEYS) {
+                mt_inode_widen(lsib);
                 /* Rotate right: pull separator from parent down,
                    push last key of left sibling up. */
                 memmove(node->keys + 1, node->keys,
@@ -766,6 +1012,9 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
 
                 pp->keys[pi - 1] = lsib->keys[lsib->nkeys - 1];
                 lsib->nkeys--;
+                inode_pack(tree, node);
+                inode_pack(tree, pp);
+                inode_pack(tree, lsib);
                 return;
             }
         }
@@ -774,6 +1023,7 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
         if (pi < pp->nkeys) {
             mt_inode_t *rsib = &mt_untag(pp->children[pi + 1])->inode;
             if (rsib->nkeys > MT_MIN_IKEYS) {
+                mt_inode_widen(rsib);
                 /* Rotate left: pull separator down, push first key of
                    right sibling up. */
                 node->keys[node->nkeys] = pp->keys[pi];
@@ -787,6 +1037,9 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
                 memmove(rsib->children, rsib->children + 1,
                         (size_t)rsib->nkeys * sizeof(mt_node_t *));
                 rsib->nkeys--;
+                inode_pack(tree, node);
+                inode_pack(tree, pp);
+                inode_pack(tree, rsib);
                 return;
             }
         }
@@ -795,6 +1048,7 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
         if (pi > 0) {
             /* Merge node into left sibling. */
             mt_inode_t *lsib = &mt_untag(pp->children[pi - 1])->inode;
+            mt_inode_widen(lsib);
             int lnk = lsib->nkeys;
 
             /* Pull down separator from parent. */
@@ -806,13 +1060,15 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
             memcpy(lsib->children + lnk + 1, node->children,
                    (size_t)(node->nkeys + 1) * sizeof(mt_node_t *));
             lsib->nkeys = (uint16_t)(lnk + 1 + node->nkeys);
+            inode_pack(tree, lsib);
 
             /* Remove node (child[pi]) from parent. */
-            inode_remove_at(pp, pi - 1);
+            inode_remove_at(tree, pp, pi - 1);
             mt_free_inode((mt_node_t *)node);
         } else {
             /* Merge right sibling into node. */
             mt_inode_t *rsib = &mt_untag(pp->children[pi + 1])->inode;
+            mt_inode_widen(rsib);
             int nn = node->nkeys;
 
             node->keys[nn] = pp->keys[pi];
@@ -821,8 +1077,9 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
             memcpy(node->children + nn + 1, rsib->children,
                    (size_t)(rsib->nkeys + 1) * sizeof(mt_node_t *));
             node->nkeys = (uint16_t)(nn + 1 + rsib->nkeys);
+            inode_pack(tree, node);
 
-            inode_remove_at(pp, pi);
+            inode_remove_at(tree, pp, pi);
             mt_free_inode((mt_node_t *)rsib);
         }
 
@@ -830,6 +1087,197 @@ static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
     }
 }
 
+/* Mid-conversion, before a delete that will underflow `leaf`: if it or
+   a sibling is stale, rebuild them in the new layout first, so that
+   the delete cannot leave a short page that only a failing rebuild
+   could rebalance.  Returns 1 if it rebuilt (path and leaf are stale),
+   0 if there was nothing to do, -1 if out of memory (tree unchanged). */
+static int refresh_before_underflow(matryoshka_tree_t *tree,
+                                    mt_path_t *path, const mt_lnode_t *leaf)
+{
+    if (!tree->converting || tree->height == 0 ||
+        leaf->header.nkeys > tree->hier.min_page_keys)
+        return 0;
+    int level = tree->height - 1;
+    mt_inode_t *parent = path[level].node;
+    int cidx = path[level].idx;
+    int first = (cidx > 0) ? cidx - 1 : cidx;
+    int last = (cidx < parent->nkeys) ? cidx + 1 : cidx;
+    bool stale = false;
+    for (int j = first; j <= last; j++)
+        stale |= leaf_stale(tree, &mt_untag(parent->children[j])->lnode);
+    if (!stale)
+        return 0;
+    int64_t e = child_upper(path, level, last);
+    path[level].idx = first;
+    if (!replace_in_parent(tree, path, e, e, NULL, 0)) {
+        path[level].idx = cidx;
+        return -1;
+    }
+    return 1;
+}
+
+/* Rebalance after leaf underflow.  `level` is the path index of the
+   leaf's parent (tree->height - 1).  Propagates upward as needed. */
+static void rebalance_leaf(matryoshka_tree_t *tree, mt_path_t *path,
+                            mt_lnode_t *leaf, int level)
+{
+    mt_inode_t *parent = path[level].node;
+    int cidx = path[level].idx;
+    int min_page = tree->hier.min_page_keys;
+
+    /* Mid-conversion, keys moved between the old and the new layout
+       could overfill a page: rebuild the leaf and its siblings instead,
+       which also rebalances them. */
+    if (tree->converting) {
+        int first = (cidx > 0) ? cidx - 1 : cidx;
+        int last = (cidx < parent->nkeys) ? cidx + 1 : cidx;
+        bool stale = false;
+        for (int j = first; j <= last; j++)
+            stale |= leaf_stale(tree,
+                                &mt_untag(parent->children[j])->lnode);
+        if (stale) {
+            /* Redistributing is no fallback: out of memory, leave the
+               leaf short, which later deletes will try again. */
+            int64_t e = child_upper(path, level, last);
+            path[level].idx = first;
+            replace_in_parent(tree, path, e, e, NULL, 0);
+            return;
+        }
+    }
+
+    /* Try redistribute from left sibling. */
+    if (cidx > 0) {
+        mt_lnode_t *left = &mt_untag(parent->children[cidx - 1])->lnode;
+        if (left->header.nkeys > min_page) {
+            int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
+            int ln = mt_page_extract_sorted(left, lsorted);
+            int rn = mt_page_extract_sorted(leaf, rsorted);
+
+            int total = ln + rn;
+            int new_ln = total / 2;
+            int move = ln - new_ln;
+
+            int32_t new_right[MT_MAX_PAGE_KEYS];
+            memcpy(new_right, lsorted + new_ln, (size_t)move * sizeof(int32_t));
+            memcpy(new_right + move, rsorted, (size_t)rn * sizeof(int32_t));
+            int new_rn = move + rn;
+
+            /* Save linked list pointers (bulk_load zeroes the page). */
+            struct mt_lnode *lp = left->header.prev;
+            struct mt_lnode *ln_next = left->header.next;
+            struct mt_lnode *rp = leaf->header.prev;
+            struct mt_lnode *rn_next = leaf->header.next;
+
+            mt_page_bulk_load(left, lsorted, new_ln, &tree->hier);
+            mt_page_bulk_load(leaf, new_right, new_rn, &tree->hier);
+
+            left->header.prev = lp;
+            left->header.next = ln_next;
+            leaf->header.prev = rp;
+            leaf->header.next = rn_next;
+
+            inode_set_key(tree, parent, cidx - 1, new_right[0]);
+            MT_PROBE5(leaf_redistribute, new_right[0], leaf, left,
+                      leaf->header.nkeys, left->header.nkeys);
+            return;
+        }
+    }
+
+    /* Try redistribute from right sibling. */
+    if (cidx < parent->nkeys) {
+        mt_lnode_t *right = &mt_untag(parent->children[cidx + 1])->lnode;
+        if (right->header.nkeys > min_page) {
+            int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
+            int ln = mt_page_extract_sorted(leaf, lsorted);
+            int rn = mt_page_extract_sorted(right, rsorted);
+
+            int total = ln + rn;
+            int new_ln = total / 2;
+            int move = new_ln - ln;
+
+            int32_t new_left[MT_MAX_PAGE_KEYS];
+            memcpy(new_left, lsorted, (size_t)ln * sizeof(int32_t));
+            memcpy(new_left + ln, rsorted, (size_t)move * sizeof(int32_t));
+
+            int32_t new_right_keys[MT_MAX_PAGE_KEYS];
+            int new_rn = rn - move;
+            memcpy(new_right_keys, rsorted + move,
+                   (size_t)new_rn * sizeof(int32_t));
+
+            struct mt_lnode *lp = leaf->header.prev;
+            struct mt_lnode *ln_next = leaf->header.next;
+            struct mt_lnode *rp = right->header.prev;
+            struct mt_lnode *rn_next = right->header.next;
+
+            mt_page_bulk_load(leaf, new_left, new_ln, &tree->hier);
+            mt_page_bulk_load(right, new_right_keys, new_rn, &tree->hier);
+
+            leaf->header.prev = lp;
+            leaf->header.next = ln_next;
+            right->header.prev = rp;
+            right->header.next = rn_next;
+
+            inode_set_key(tree, parent, cidx, new_right_keys[0]);
+            MT_PROBE5(leaf_redistribute, new_right_keys[0], leaf, right,
+                      leaf->header.nkeys, right->header.nkeys);
+            return;
+        }
+    }
+
+    /* Cannot redistribute — merge.  Prefer merging with left sibling. */
+    if (cidx > 0) {
+        mt_lnode_t *left = &mt_untag(parent->children[cidx - 1])->lnode;
+        int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
+        int ln = mt_page_extract_sorted(left, lsorted);
+        int rn = mt_page_extract_sorted(leaf, rsorted);
+
+        int32_t merged[MT_MAX_PAGE_KEYS];
+        memcpy(merged, lsorted, (size_t)ln * sizeof(int32_t));
+        memcpy(merged + ln, rsorted, (size_t)rn * sizeof(int32_t));
+
+        struct mt_lnode *lp = left->header.prev;
+
+        mt_page_bulk_load(left, merged, ln + rn, &tree->hier);
+
+        /* Restore and update linked list. */
+        left->header.prev = lp;
+        left->header.next = leaf->header.next;
+        if (leaf->header.next)
+            leaf->header.next->header.prev = left;
+
+        MT_PROBE3(leaf_merge, left, leaf, left->header.nkeys);
+        inode_remove_at(tree, parent, cidx - 1);
+        mt_free_lnode((mt_node_t *)leaf, tree->alloc);
+    } else {
+        /* Merge with right sibling. */
+        mt_lnode_t *right = &mt_untag(parent->children[cidx + 1])->lnode;
+        int32_t lsorted[MT_MAX_PAGE_KEYS], rsorted[MT_MAX_PAGE_KEYS];
+        int ln = mt_page_extract_sorted(leaf, lsorted);
+        int rn = mt_page_extract_sorted(right, rsorted);
+
+        int32_t merged[MT_MAX_PAGE_KEYS];
+        memcpy(merged, lsorted, (size_t)ln * sizeof(int32_t));
+        memcpy(merged + ln, rsorted, (size_t)rn * sizeof(int32_t));
+
+        struct mt_lnode *lp = leaf->header.prev;
+
+        mt_page_bulk_load(leaf, merged, ln + rn, &tree->hier);
+
+        /* Restore and update linked list. */
+        leaf->header.prev = lp;
+        leaf->header.next = right->header.next;
+        if (right->header.next)
+            right->header.next->header.prev = leaf;
+
+        MT_PROBE3(leaf_merge, leaf, right, leaf->header.nkeys);
+        inode_remove_at(tree, parent, cidx);
+        mt_free_lnode((mt_node_t *)right, tree->alloc);
+    }
+
+    rebalance_inodes(tree, path, level);
+}
+
 /* Rebalance after superpage underflow.  Mirrors rebalance_leaf but
    operates on superpages instead of page leaves. */
 static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
@@ -843,20 +1291,14 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
     if (cidx > 0) {
         mt_sp_header_t *left = (mt_sp_header_t *)mt_untag(parent->children[cidx - 1]);
         if ((int)left->nkeys > tree->hier.min_sp_keys) {
-            int32_t *lkeys = malloc((size_t)left->nkeys * sizeof(int32_t));
-            int32_t *rkeys = malloc((size_t)sp->nkeys * sizeof(int32_t));
-            if (!lkeys || !rkeys) { free(lkeys); free(rkeys); return; }
+            int32_t *merged = ws_split(tree, (size_t)left->nkeys + sp->nkeys);
+            if (!merged) return;
 
-            int ln = mt_sp_extract_sorted(left, lkeys);
-            int rn = mt_sp_extract_sorted(sp_node, rkeys);
+            int ln = mt_sp_extract_sorted(left, merged);
+            int rn = mt_sp_extract_sorted(sp_node, merged + ln);
             int total = ln + rn;
             int new_ln = total / 2;
 
-            int32_t *merged = malloc((size_t)total * sizeof(int32_t));
-            if (!merged) { free(lkeys); free(rkeys); return; }
-            memcpy(merged, lkeys, (size_t)ln * sizeof(int32_t));
-            memcpy(merged + ln, rkeys, (size_t)rn * sizeof(int32_t));
-
             mt_sp_header_t *left_sp_prev = left->prev;
             mt_sp_header_t *sp_next = sp->next;
 
@@ -894,8 +1336,10 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
                 nf->header.prev = rl;
             }
 
-            parent->keys[cidx - 1] = merged[new_ln];
-            free(lkeys); free(rkeys); free(merged);
+            inode_set_key(tree, parent, cidx - 1, merged[new_ln]);
+            MT_PROBE5(sp_redistribute, merged[new_ln], sp, left,
+                      sp->nkeys, left->nkeys);
+            ws_release(tree, merged);
             return;
         }
     }
@@ -904,20 +1348,14 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
     if (cidx < parent->nkeys) {
         mt_sp_header_t *right = (mt_sp_header_t *)mt_untag(parent->children[cidx + 1]);
         if ((int)right->nkeys > tree->hier.min_sp_keys) {
-            int32_t *lkeys = malloc((size_t)sp->nkeys * sizeof(int32_t));
-            int32_t *rkeys = malloc((size_t)right->nkeys * sizeof(int32_t));
-            if (!lkeys || !rkeys) { free(lkeys); free(rkeys); return; }
+            int32_t *merged = ws_split(tree, (size_t)sp->nkeys + right->nkeys);
+            if (!merged) return;
 
-            int ln = mt_sp_extract_sorted(sp_node, lkeys);
-            int rn = mt_sp_extract_sorted(right, rkeys);
+            int ln = mt_sp_extract_sorted(sp_node, merged);
+            int rn = mt_sp_extract_sorted(right, merged + ln);
             int total = ln + rn;
             int new_ln = total / 2;
 
-            int32_t *merged = malloc((size_t)total * sizeof(int32_t));
-            if (!merged) { free(lkeys); free(rkeys); return; }
-            memcpy(merged, lkeys, (size_t)ln * sizeof(int32_t));
-            memcpy(merged + ln, rkeys, (size_t)rn * sizeof(int32_t));
-
             mt_sp_header_t *sp_prev = sp->prev;
             mt_sp_header_t *right_next = right->next;
 
@@ -949,8 +1387,10 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
                 nf->header.prev = rl;
             }
 
-            parent->keys[cidx] = merged[new_ln];
-            free(lkeys); free(rkeys); free(merged);
+            inode_set_key(tree, parent, cidx, merged[new_ln]);
+            MT_PROBE5(sp_redistribute, merged[new_ln], sp, right,
+                      sp->nkeys, right->nkeys);
+            ws_release(tree, merged);
             return;
         }
     }
@@ -959,17 +1399,11 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
        For simplicity, merge with left or right and remove from parent. */
     if (cidx > 0) {
         mt_sp_header_t *left = (mt_sp_header_t *)mt_untag(parent->children[cidx - 1]);
-        int32_t *lkeys = malloc((size_t)left->nkeys * sizeof(int32_t));
-        int32_t *rkeys = malloc((size_t)sp->nkeys * sizeof(int32_t));
-        if (!lkeys || !rkeys) { free(lkeys); free(rkeys); return; }
-
-        int ln = mt_sp_extract_sorted(left, lkeys);
-        int rn = mt_sp_extract_sorted(sp_node, rkeys);
+        int32_t *merged = ws_split(tree, (size_t)left->nkeys + sp->nkeys);
+        if (!merged) return;
 
-        int32_t *merged = malloc((size_t)(ln + rn) * sizeof(int32_t));
-        if (!merged) { free(lkeys); free(rkeys); return; }
-        memcpy(merged, lkeys, (size_t)ln * sizeof(int32_t));
-        memcpy(merged + ln, rkeys, (size_t)rn * sizeof(int32_t));
+        int ln = mt_sp_extract_sorted(left, merged);
+        int rn = mt_sp_extract_sorted(sp_node, merged + ln);
 
         mt_sp_header_t *left_prev = left->prev;
         mt_sp_header_t *sp_next_save = sp->next;
@@ -997,22 +1431,17 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
             ll->header.next = NULL;
         }
 
-        inode_remove_at(parent, cidx - 1);
+        MT_PROBE3(sp_merge, left, sp, left->nkeys);
+        inode_remove_at(tree, parent, cidx - 1);
         mt_free_lnode(sp_node, tree->alloc);
-        free(lkeys); free(rkeys); free(merged);
+        ws_release(tree, merged);
     } else {
         mt_sp_header_t *right = (mt_sp_header_t *)mt_untag(parent->children[cidx + 1]);
-        int32_t *lkeys = malloc((size_t)sp->nkeys * sizeof(int32_t));
-        int32_t *rkeys = malloc((size_t)right->nkeys * sizeof(int32_t));
-        if (!lkeys || !rkeys) { free(lkeys); free(rkeys); return; }
-
-        int ln = mt_sp_extract_sorted(sp_node, lkeys);
-        int rn = mt_sp_extract_sorted(right, rkeys);
+        int32_t *merged = ws_split(tree, (size_t)sp->nkeys + right->nkeys);
+        if (!merged) return;
 
-        int32_t *merged = malloc((size_t)(ln + rn) * sizeof(int32_t));
-        if (!merged) { free(lkeys); free(rkeys); return; }
-        memcpy(merged, lkeys, (size_t)ln * sizeof(int32_t));
-        memcpy(merged + ln, rkeys, (size_t)rn * sizeof(int32_t));
+        int ln = mt_sp_extract_sorted(sp_node, merged);
+        int rn = mt_sp_extract_sorted(right, merged + ln);
 
         mt_sp_header_t *sp_prev_save = sp->prev;
         mt_sp_header_t *right_next = right->next;
@@ -1039,81 +1468,40 @@ static void rebalance_sp(matryoshka_tree_t *tree, mt_path_t *path,
             sl->header.next = NULL;
         }
 
-        inode_remove_at(parent, cidx);
+        MT_PROBE3(sp_merge, sp, right, sp->nkeys);
+        inode_remove_at(tree, parent, cidx);
         mt_free_lnode((mt_node_t *)right, tree->alloc);
-        free(lkeys); free(rkeys); free(merged);
+        ws_release(tree, merged);
     }
 
-    /* Propagate internal underflow upward. */
-    for (int lv = level; lv >= 0; lv--) {
-        mt_inode_t *node = path[lv].node;
-        if (lv == 0) {
-            if (node->nkeys == 0 && tree->height > 0) {
-                mt_node_t *child = mt_untag(node->children[0]);
-                mt_free_inode((mt_node_t *)node);
-                tree->root = child;
-                tree->height--;
-            }
-            return;
-        }
-        if (node->nkeys >= MT_MIN_IKEYS) return;
-        /* Internal node underflow — same logic as non-superpage. */
-        mt_inode_t *pp = path[lv - 1].node;
-        int pi = path[lv - 1].idx;
+    rebalance_inodes(tree, path, level);
+}
 
-        if (pi > 0) {
-            mt_inode_t *lsib = &mt_untag(pp->children[pi - 1])->inode;
-            if (lsib->nkeys > MT_MIN_IKEYS) {
-                memmove(node->keys + 1, node->keys,
-                        (size_t)node->nkeys * sizeof(int32_t));
-                memmove(node->children + 1, node->children,
-                        (size_t)(node->nkeys + 1) * sizeof(mt_node_t *));
-                node->keys[0] = pp->keys[pi - 1];
-                node->children[0] = lsib->children[lsib->nkeys];
-                node->nkeys++;
-                pp->keys[pi - 1] = lsib->keys[lsib->nkeys - 1];
-                lsib->nkeys--;
-                return;
-            }
-        }
-        if (pi < pp->nkeys) {
-            mt_inode_t *rsib = &mt_untag(pp->children[pi + 1])->inode;
-            if (rsib->nkeys > MT_MIN_IKEYS) {
-                node->keys[node->nkeys] = pp->keys[pi];
-                node->children[node->nkeys + 1] = rsib->children[0];
-                node->nkeys++;
-                pp->keys[pi] = rsib->keys[0];
-                memmove(rsib->keys, rsib->keys + 1,
-                        (size_t)(rsib->nkeys - 1) * sizeof(int32_t));
-                memmove(rsib->children, rsib->children + 1,
-                        (size_t)rsib->nkeys * sizeof(mt_node_t *));
-                rsib->nkeys--;
-                return;
-            }
-        }
-        if (pi > 0) {
-            mt_inode_t *lsib = &mt_untag(pp->children[pi - 1])->inode;
-            int lnk = lsib->nkeys;
-            lsib->keys[lnk] = pp->keys[pi - 1];
-            memcpy(lsib->keys + lnk + 1, node->keys,
-                   (size_t)node->nkeys * sizeof(int32_t));
-            memcpy(lsib->children + lnk + 1, node->children,
-                   (size_t)(node->nkeys + 1) * sizeof(mt_node_t *));
-            lsib->nkeys = (uint16_t)(lnk + 1 + node->nkeys);
-            inode_remove_at(pp, pi - 1);
-            mt_free_inode((mt_node_t *)node);
-        } else {
-            mt_inode_t *rsib = &mt_untag(pp->children[pi + 1])->inode;
-            int nn = node->nkeys;
-            node->keys[nn] = pp->keys[pi];
-            memcpy(node->keys + nn + 1, rsib->keys,
-                   (size_t)rsib->nkeys * sizeof(int32_t));
-            memcpy(node->children + nn + 1, rsib->children,
-                   (size_t)(rsib->nkeys + 1) * sizeof(mt_node_t *));
-            node->nkeys = (uint16_t)(nn + 1 + rsib->nkeys);
-            inode_remove_at(pp, pi);
-            mt_free_inode((mt_node_t *)rsib);
+/* With tight_separators: `key` was just deleted from `leaf`, reached by
+   `path`.  If it was the leaf's separator, i.e. its minimum, raise the
+   separator to the new minimum.  Inserts below a separator go to the
+   left neighbour, so separators stay equal to their leaf's minimum and
+   a search never has to fall back to the previous leaf. */
+static void tighten_separator(matryoshka_tree_t *tree, mt_path_t *path,
+                              mt_node_t *leaf, int32_t key)
+{
+    if (!tree->hier.tight_separators)
+        return;
+    for (int l = tree->height - 1; l >= 0; l--) {
+        if (path[l].idx == 0)
+            continue;
+        mt_inode_t *node = path[l].node;
+        if (mt_inode_key(node, path[l].idx - 1) != key)
+            return;
+        if (tree->hier.use_superpages) {
+            if (((mt_sp_header_t *)leaf)->nkeys > 0)
+                inode_set_key(tree, node, path[l].idx - 1,
+                              mt_sp_min_key(leaf));
+        } else if (leaf->lnode.header.nkeys > 0) {
+            inode_set_key(tree, node, path[l].idx - 1,
+                          mt_page_min_key(&leaf->lnode));
         }
+        return;
     }
 }
 
@@ -1133,9 +1521,11 @@ bool matryoshka_delete(matryoshka_tree_t *tree, int32_t key)
             node = mt_untag(node->inode.children[idx]);
         }
 
+        mt_heat_note(tree, node, key, true);
         mt_status_t status = mt_sp_delete(node, key, &tree->hier);
         if (status == MT_NOT_FOUND) return false;
         tree->n--;
+        tighten_separator(tree, path, node, key);
         if (status == MT_OK || tree->height == 0) return true;
         rebalance_sp(tree, path, node, tree->height - 1);
         return true;
@@ -1143,6 +1533,13 @@ bool matryoshka_delete(matryoshka_tree_t *tree, int32_t key)
 
     /* Find the leaf. */
     mt_lnode_t *leaf = find_leaf(tree->root, tree->height, key, path);
+    mt_heat_note(tree, leaf, key, true);
+
+    int refreshed = refresh_before_underflow(tree, path, leaf);
+    if (refreshed < 0)
+        return false;
+    if (refreshed > 0)
+        leaf = find_leaf(tree->root, tree->height, key, path);
 
     /* Delete from the page sub-tree. */
     mt_status_t status = mt_page_delete(leaf, key, &tree->hier);
@@ -1151,6 +1548,7 @@ bool matryoshka_delete(matryoshka_tree_t *tree, int32_t key)
         return false;
 
     tree->n--;
+    tighten_separator(tree, path, (mt_node_t *)leaf, key);
 
     /* If leaf is the root or no underflow, we're done. */
     if (status == MT_OK || tree->height == 0) {
@@ -1166,13 +1564,6 @@ bool matryoshka_delete(matryoshka_tree_t *tree, int32_t key)
 
 /* ── Batch insert / delete ────────────────────────────────────── */
 
-static int cmp_int32(const void *a, const void *b)
-{
-    int32_t va = *(const int32_t *)a;
-    int32_t vb = *(const int32_t *)b;
-    return (va > vb) - (va < vb);
-}
-
 /* Helper: walk outer tree to a leaf, recording path. */
 static mt_node_t *find_leaf_node(mt_node_t *root, int height, int32_t key,
                                    mt_path_t *path)
@@ -1198,16 +1589,21 @@ static mt_node_t *find_leaf_node(mt_node_t *root, int height, int32_t key,
     return node;
 }
 
-size_t matryoshka_insert_batch(matryoshka_tree_t *tree,
-                                const int32_t *keys, size_t n)
+/* Exclusive upper bound of the leaf `path` leads to: the separator to
+   its right at the lowest level that has one.  A last child's bound
+   comes from further up, not INT32_MAX. */
+static int32_t path_upper(const matryoshka_tree_t *tree, const mt_path_t *path)
 {
-    if (!tree || n == 0) return 0;
-
-    int32_t *sorted = malloc(n * sizeof(int32_t));
-    if (!sorted) return 0;
-    memcpy(sorted, keys, n * sizeof(int32_t));
-    qsort(sorted, n, sizeof(int32_t), cmp_int32);
+    for (int l = tree->height - 1; l >= 0; l--)
+        if (path[l].idx < path[l].node->nkeys)
+            return mt_inode_key(path[l].node, path[l].idx);
+    return INT32_MAX;
+}
 
+/* Insert sorted[0..n), ascending with possible duplicates. */
+static size_t insert_sorted(matryoshka_tree_t *tree, const int32_t *sorted,
+                            size_t n)
+{
     size_t inserted = 0;
     size_t i = 0;
     bool sp = tree->hier.use_superpages;
@@ -1229,15 +1625,15 @@ size_t matryoshka_insert_batch(matryoshka_tree_t *tree,
                 upper != INT32_MAX && sorted[i] >= upper) {
                 mt_inode_t *parent = path[tree->height - 1].node;
                 int next_cidx = path[tree->height - 1].idx + 1;
-                int32_t next_upper = (next_cidx < parent->nkeys)
-                                     ? parent->keys[next_cidx] : INT32_MAX;
-                if (sorted[i] < next_upper || next_upper == INT32_MAX) {
-                    /* Fast path: advance to next sibling child. */
+                if (next_cidx <= parent->nkeys) {
                     path[tree->height - 1].idx = next_cidx;
-                    mt_node_t *raw = parent->children[next_cidx];
-                    leaf_node = mt_untag(raw);
-                    upper = next_upper;
-                    goto prefetch_next_and_insert;
+                    int32_t next_upper = path_upper(tree, path);
+                    if (sorted[i] < next_upper) {
+                        /* Fast path: advance to next sibling child. */
+                        leaf_node = mt_untag(parent->children[next_cidx]);
+                        upper = next_upper;
+                        goto prefetch_next_and_insert;
+                    }
                 }
             }
 
@@ -1245,14 +1641,7 @@ size_t matryoshka_insert_batch(matryoshka_tree_t *tree,
             leaf_node = find_leaf_node(tree->root, tree->height,
                                        sorted[i], path);
             have_path = true;
-
-            upper = INT32_MAX;
-            if (tree->height > 0) {
-                mt_inode_t *parent = path[tree->height - 1].node;
-                int cidx = path[tree->height - 1].idx;
-                if (cidx < parent->nkeys)
-                    upper = parent->keys[cidx];
-            }
+            upper = path_upper(tree, path);
         }
 
 prefetch_next_and_insert:
@@ -1297,11 +1686,12 @@ prefetch_next_and_insert:
 
             /* MT_PAGE_FULL: split and insert.  Path is stale after
                split (parent may have been restructured). */
-            if (sp)
-                split_sp_and_insert(tree, path, leaf_node, sorted[i]);
-            else
-                split_leaf_and_insert(tree, path, &leaf_node->lnode,
-                                       sorted[i]);
+            bool split = sp
+                ? split_sp_and_insert(tree, path, leaf_node, sorted[i])
+                : split_leaf_and_insert(tree, path, &leaf_node->lnode,
+                                        sorted[i]);
+            if (!split)
+                return inserted;    /* out of memory */
             tree->n++;
             inserted++;
             i++;
@@ -1310,20 +1700,13 @@ prefetch_next_and_insert:
         }
     }
 
-    free(sorted);
     return inserted;
 }
 
-size_t matryoshka_delete_batch(matryoshka_tree_t *tree,
-                                const int32_t *keys, size_t n)
+/* Delete sorted[0..n), ascending with possible duplicates. */
+static size_t delete_sorted(matryoshka_tree_t *tree, const int32_t *sorted,
+                            size_t n)
 {
-    if (!tree || n == 0) return 0;
-
-    int32_t *sorted = malloc(n * sizeof(int32_t));
-    if (!sorted) return 0;
-    memcpy(sorted, keys, n * sizeof(int32_t));
-    qsort(sorted, n, sizeof(int32_t), cmp_int32);
-
     size_t deleted = 0;
     size_t i = 0;
     bool use_sp = tree->hier.use_superpages;
@@ -1335,20 +1718,22 @@ size_t matryoshka_delete_batch(matryoshka_tree_t *tree,
         mt_node_t *leaf_node = find_leaf_node(tree->root, tree->height,
                                                sorted[i], path);
 
-        int32_t upper = INT32_MAX;
-        if (tree->height > 0) {
-            mt_inode_t *parent = path[tree->height - 1].node;
-            int cidx = path[tree->height - 1].idx;
-            if (cidx < parent->nkeys)
-                upper = parent->keys[cidx];
-        }
-
+        int32_t upper = path_upper(tree, path);
         bool need_rebalance = false;
 
         while (i < n) {
             if (i > 0 && sorted[i] == sorted[i - 1]) { i++; continue; }
             if (upper != INT32_MAX && sorted[i] >= upper) break;
 
+            if (!use_sp) {
+                int r = refresh_before_underflow(tree, path,
+                                                 &leaf_node->lnode);
+                if (r < 0)
+                    return deleted;             /* out of memory */
+                if (r > 0)
+                    break;                      /* re-navigate */
+            }
+
             mt_status_t status;
             if (use_sp)
                 status = mt_sp_delete(leaf_node, sorted[i], &tree->hier);
@@ -1362,6 +1747,7 @@ size_t matryoshka_delete_batch(matryoshka_tree_t *tree,
             deleted++;
             if (status == MT_OK && !use_sp)
                 retag_leaf_in_parent(path, tree->height);
+            tighten_separator(tree, path, leaf_node, sorted[i]);
             i++;
 
             if (status == MT_UNDERFLOW && tree->height > 0) {
@@ -1379,10 +1765,377 @@ size_t matryoshka_delete_batch(matryoshka_tree_t *tree,
         }
     }
 
-    free(sorted);
     return deleted;
 }
 
+/* Sort a copy (in the workspace when it fits) and apply `op` to it. */
+static size_t batch_copy(matryoshka_tree_t *tree, const int32_t *keys,
+                         size_t n,
+                         size_t (*op)(matryoshka_tree_t *, const int32_t *,
+                                      size_t))
+{
+    if (!tree || n == 0) return 0;
+
+    int32_t *sorted = ws_batch(tree, n);
+    if (!sorted) return 0;
+    memcpy(sorted, keys, n * sizeof(int32_t));
+    mt_sort_keys(sorted, n);
+    size_t done = op(tree, sorted, n);
+    ws_release(tree, sorted);
+    return done;
+}
+
+size_t matryoshka_insert_batch(matryoshka_tree_t *tree,
+                                const int32_t *keys, size_t n)
+{
+    return batch_copy(tree, keys, n, insert_sorted);
+}
+
+size_t matryoshka_delete_batch(matryoshka_tree_t *tree,
+                                const int32_t *keys, size_t n)
+{
+    return batch_copy(tree, keys, n, delete_sorted);
+}
+
+size_t matryoshka_insert_batch_inplace(matryoshka_tree_t *tree,
+                                        int32_t *keys, size_t n)
+{
+    if (!tree || n == 0) return 0;
+    mt_sort_keys(keys, n);
+    return insert_sorted(tree, keys, n);
+}
+
+size_t matryoshka_delete_batch_inplace(matryoshka_tree_t *tree,
+                                        int32_t *keys, size_t n)
+{
+    if (!tree || n == 0) return 0;
+    mt_sort_keys(keys, n);
+    return delete_sorted(tree, keys, n);
+}
+
+/* ── Range replace ────────────────────────────────────────────── */
+
+/* Replace the keys in [lo, e) under one leaf parent (the root page when
+   height == 0) with run[0..n).  `e` must not exceed the parent's upper
+   bound.  The old pages are rewritten in place with mt_page_bulk_load,
+   surplus ones are cut out of the parent in one memmove, and missing
+   ones are linked in and propagated like leaf splits. */
+static bool replace_in_parent(matryoshka_tree_t *tree, mt_path_t *path,
+                              int64_t lo, int64_t e,
+                              const int32_t *run, size_t n)
+{
+    int h = tree->height;
+    mt_inode_t *parent = (h > 0) ? path[h - 1].node : NULL;
+    int il = 0, ir = 0;
+    if (parent) {
+        mt_inode_widen(parent);
+        il = path[h - 1].idx;
+        ir = mt_inode_search(parent, (int32_t)(e - 1));
+    }
+    int m = ir - il + 1;
+
+    mt_lnode_t *old[MT_MAX_IKEYS + 1];
+    size_t old_n = 0;
+    for (int j = 0; j < m; j++) {
+        old[j] = parent ? &mt_untag(parent->children[il + j])->lnode
+                        : &tree->root->lnode;
+        old_n += old[j]->header.nkeys;
+    }
+
+    int32_t *all = malloc((old_n + n + 1) * sizeof(int32_t));
+    if (!all) {
+        if (parent) inode_pack(tree, parent);
+        return false;
+    }
+    size_t na = 0;
+    for (int j = 0; j < m; j++)
+        na += (size_t)mt_page_extract_sorted(old[j], all + na);
+
+    /* all[] = old keys below lo, the new run, old keys from e on. */
+    size_t pre = 0;
+    while (pre < na && all[pre] < lo) pre++;
+    size_t suf = pre;
+    while (suf < na && all[suf] < e) suf++;
+    size_t removed = suf - pre;
+    memmove(all + pre + n, all + suf, (na - suf) * sizeof(int32_t));
+    if (n > 0)
+        memcpy(all + pre, run, n * sizeof(int32_t));
+    size_t total = na - removed + n;
+
+    int max_keys = tree->hier.page_max_keys;
+    int k = (total == 0) ? 1 : (int)((total + (size_t)max_keys - 1) /
+                                     (size_t)max_keys);
+    size_t per = total / (size_t)k, extra = total % (size_t)k;
+
+    /* Everything the splice needs is allocated before the tree is
+       touched, so running out of memory leaves it as it was. */
+    mt_lnode_t *pages[MT_MAX_IKEYS + 1];
+    mt_lnode_t **np = (k <= MT_MAX_IKEYS + 1) ? pages
+                      : malloc((size_t)k * sizeof(mt_lnode_t *));
+    int32_t *sep = malloc((size_t)k * sizeof(int32_t));
+    int placed = m;
+    if (np && sep) {
+        for (; placed < k; placed++) {
+            mt_node_t *page = mt_alloc_lnode(&tree->hier, tree->alloc);
+            if (!page) break;
+            np[placed] = &page->lnode;
+        }
+    }
+    if (!np || !sep || placed < k) {
+        if (np)
+            for (int j = m; j < placed; j++)
+                mt_free_lnode((mt_node_t *)np[j], tree->alloc);
+        if (np != pages) free(np);
+        free(sep);
+        free(all);
+        if (parent) inode_pack(tree, parent);
+        return false;
+    }
+
+    mt_lnode_t *first_prev = old[0]->header.prev;
+    mt_lnode_t *last_next = old[m - 1]->header.next;
+    for (int j = k; j < m; j++)
+        mt_free_lnode((mt_node_t *)old[j], tree->alloc);
+
+    /* Rewrite reused pages, fill the new ones, and relink the chain. */
+    size_t off = 0;
+    for (int j = 0; j < k; j++) {
+        size_t c = per + ((size_t)j < extra ? 1 : 0);
+        if (j < m)
+            np[j] = old[j];
+        mt_page_bulk_load(np[j], all + off, (int)c, &tree->hier);
+        sep[j] = (c > 0) ? all[off] : (int32_t)lo;
+        off += c;
+    }
+    for (int j = 0; j < k; j++) {
+        np[j]->header.prev = (j > 0) ? np[j - 1] : first_prev;
+        np[j]->header.next = (j < k - 1) ? np[j + 1] : last_next;
+    }
+    if (first_prev) first_prev->header.next = np[0];
+    if (last_next) last_next->header.prev = np[k - 1];
+    tree->n = tree->n - removed + n;
+    free(all);
+
+    int reuse = (k < m) ? k : m;
+    if (parent) {
+        for (int j = 0; j < reuse; j++) {
+            if (j > 0)
+                parent->keys[il + j - 1] = sep[j];
+            parent->children[il + j] = mt_tag_leaf_ptr((mt_node_t *)np[j]);
+        }
+        if (m > k) {
+            int pn = parent->nkeys;
+            memmove(parent->keys + il + k - 1, parent->keys + ir,
+                    (size_t)(pn - ir) * sizeof(int32_t));
+            memmove(parent->children + il + k, parent->children + ir + 1,
+                    (size_t)(pn - ir) * sizeof(mt_node_t *));
+            parent->nkeys = (uint16_t)(pn - (m - k));
+        }
+        inode_pack(tree, parent);
+        if (m > k)
+            rebalance_inodes(tree, path, h - 1);
+    }
+
+    /* Pages beyond the old count enter the outer tree one at a time;
+       each lands right after its predecessor. */
+    for (int j = m; j < k; j++) {
+        find_leaf(tree->root, tree->height, sep[j], path);
+        propagate_leaf_split(tree, path, sep[j],
+                             mt_tag_leaf_ptr((mt_node_t *)np[j]));
+    }
+
+    /* Only a single short page can underflow: k >= 2 fills each page
+       to at least half of page_max_keys. */
+    if (k == 1 && total < (size_t)tree->hier.min_page_keys &&
+        tree->height > 0) {
+        mt_lnode_t *leaf = find_leaf(tree->root, tree->height, sep[0], path);
+        rebalance_leaf(tree, path, leaf, tree->height - 1);
+    }
+
+    if (np != pages) free(np);
+    free(sep);
+    return true;
+}
+
+bool matryoshka_replace_range(matryoshka_tree_t *tree, int32_t lo,
+                               int32_t hi, const int32_t *keys, size_t n)
+{
+    if (!tree) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (keys[i] < lo || keys[i] >= hi || (i > 0 && keys[i] <= keys[i - 1]))
+            return false;
+    }
+    if (lo >= hi) return true;
+
+    if (tree->hier.use_superpages) {
+        /* Superpage leaves have no page-level splice: delete + insert. */
+        size_t cap = 1024, no = 0;
+        int32_t *old = malloc(cap * sizeof(int32_t));
+        if (!old) return false;
+        matryoshka_iter_t *it = matryoshka_iter_from(tree, lo);
+        if (!it) {
+            free(old);
+            return false;
+        }
+        int32_t key;
+        while (matryoshka_iter_next(it, &key) && key < hi) {
+            if (no == cap) {
+                int32_t *grown = realloc(old, 2 * cap * sizeof(int32_t));
+                if (!grown) {
+                    matryoshka_iter_destroy(it);
+                    free(old);
+                    return false;
+                }
+                old = grown;
+                cap *= 2;
+            }
+            old[no++] = key;
+        }
+        matryoshka_iter_destroy(it);
+        /* The in-place batches take no workspace: with the run copied
+           up front, the delete cannot go ahead without the insert. */
+        int32_t *run = malloc(n * sizeof(int32_t) + 1);
+        if (!run) {
+            free(old);
+            return false;
+        }
+        if (n > 0)
+            memcpy(run, keys, n * sizeof(int32_t));
+        size_t deleted = matryoshka_delete_batch_inplace(tree, old, no);
+        size_t inserted = matryoshka_insert_batch_inplace(tree, run, n);
+        free(run);
+        free(old);
+        return deleted == no && inserted == n;
+    }
+
+    /* One splice per leaf parent the range touches, each re-descending
+       since the previous one may have split or merged inodes. */
+    mt_path_t path[MT_MAX_HEIGHT];
+    int64_t cur = lo;
+    size_t done = 0;
+    while (cur < hi) {
+        int64_t ub = (int64_t)INT32_MAX + 1;
+        mt_node_t *node = tree->root;
+        for (int i = 0; i < tree->height; i++) {
+            mt_inode_t *in = &node->inode;
+            int idx = mt_inode_search(in, (int32_t)cur);
+            if (i < tree->height - 1 && idx < in->nkeys)
+                ub = mt_inode_key(in, idx);
+            path[i].node = in;
+            path[i].idx = idx;
+            node = mt_untag(in->children[idx]);
+        }
+        int64_t e = (hi < ub) ? hi : ub;
+        size_t cnt = 0;
+        while (done + cnt < n && keys[done + cnt] < e)
+            cnt++;
+        if (!replace_in_parent(tree, path, cur, e, keys + done, cnt))
+            return false;
+        done += cnt;
+        cur = e;
+    }
+    return true;
+}
+
+/* ── Online conversion ────────────────────────────────────────── */
+
+/* Whether any page of a superpage still has the old layout. */
+static bool sp_stale(const matryoshka_tree_t *tree, mt_node_t *sp_node)
+{
+    mt_lnode_t *last = mt_sp_last_leaf(sp_node);
+    for (mt_lnode_t *p = mt_sp_first_leaf(sp_node); ; p = p->header.next) {
+        if (p->header.flags != layout_flags(&tree->hier, p))
+            return true;
+        if (p == last)
+            return false;
+    }
+}
+
+/* Rebuild a superpage in place with the tree's hierarchy.  Its key
+   range is unchanged, so only the links to its neighbours need fixing. */
+static bool convert_sp(matryoshka_tree_t *tree, mt_node_t *sp_node)
+{
+    mt_sp_header_t *sp = (mt_sp_header_t *)sp_node;
+    int32_t *keys = ws_split(tree, sp->nkeys);
+    if (!keys) return false;
+    int n = mt_sp_extract_sorted(sp_node, keys);
+
+    mt_sp_header_t *prev = sp->prev, *next = sp->next;
+    mt_sp_bulk_load(sp_node, keys, n, &tree->hier);
+    sp->prev = prev;
+    sp->next = next;
+    if (prev && prev->nkeys > 0) {
+        mt_lnode_t *plast = mt_sp_last_leaf((void *)prev);
+        mt_lnode_t *first = mt_sp_first_leaf(sp_node);
+        plast->header.next = first;
+        first->header.prev = plast;
+    }
+    if (next && next->nkeys > 0) {
+        mt_lnode_t *last = mt_sp_last_leaf(sp_node);
+        mt_lnode_t *nfirst = mt_sp_first_leaf((void *)next);
+        last->header.next = nfirst;
+        nfirst->header.prev = last;
+    }
+    ws_release(tree, keys);
+    return true;
+}
+
+bool matryoshka_convert(matryoshka_tree_t *tree, const mt_hierarchy_t *hier)
+{
+    if (!tree || !hier) return false;
+    /* The outer tree holds leaves of one kind, and superpage splits and
+       merges assume one page capacity throughout. */
+    if (hier->use_superpages != tree->hier.use_superpages ||
+        hier->leaf_alloc != tree->hier.leaf_alloc)
+        return false;
+    if (hier->use_superpages &&
+        (hier->page_max_keys != tree->hier.page_max_keys ||
+         hier->sp_max_keys != tree->hier.sp_max_keys))
+        return false;
+
+    tree->hier = *hier;
+    tree->converting = true;
+    tree->convert_at = INT32_MIN;
+    return true;
+}
+
+bool matryoshka_convert_step(matryoshka_tree_t *tree, size_t max_leaves)
+{
+    if (!tree || !tree->converting) return true;
+
+    mt_path_t path[MT_MAX_HEIGHT];
+    for (size_t visited = 0;
+         visited < max_leaves && tree->convert_at <= INT32_MAX; visited++) {
+        mt_node_t *node = find_leaf_node(tree->root, tree->height,
+                                         (int32_t)tree->convert_at, path);
+        int h = tree->height;
+        int64_t e = (h > 0) ? child_upper(path, h - 1, path[h - 1].idx)
+                            : (int64_t)INT32_MAX + 1;
+
+        /* Inner nodes follow compress_inodes from their first leaf on;
+           edits keep those behind the cursor packed. */
+        for (int l = h - 1; l >= 0 && path[l].idx == 0; l--) {
+            if (tree->hier.compress_inodes)
+                mt_inode_narrow(path[l].node);
+            else
+                mt_inode_widen(path[l].node);
+        }
+
+        if (tree->hier.use_superpages) {
+            if (sp_stale(tree, node) && !convert_sp(tree, node))
+                return false;
+        } else if (leaf_stale(tree, &node->lnode)) {
+            if (!replace_in_parent(tree, path, e, e, NULL, 0))
+                return false;
+        }
+        tree->convert_at = e;
+    }
+
+    if (tree->convert_at > INT32_MAX)
+        tree->converting = false;
+    return !tree->converting;
+}
+
 /* ── Iteration ────────────────────────────────────────────────── */
 
 /* Load sorted keys from the current leaf into the iterator's buffer. */
@@ -0,0 +1,202 @@
+/*
+ * publish.c — Publishing tree images to reader processes.
+ *
+ * A prefix names a control page, <prefix>.ctl, and the images it points
+ * at, <prefix>.<generation>.img.  The writer saves each new version
+ * under a temporary name and renames it into place, so a reader never
+ * sees a partial image, then switches the control page's generation
+ * under its seqlock.  Readers map the control page read-only and
+ * compare generations on each matryoshka_reader_current; only a change
+ * costs an attach.  The writer unlinks the image it replaced at once:
+ * readers that still map it keep its pages until they detach, and a
+ * reader that has read the old generation but not yet opened the file
+ * finds it gone and reads the control page again.
+ */
+
+#include "matryoshka_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PUB_PATH_MAX 4096
+
+struct matryoshka_reader {
+    char               *prefix;
+    const mt_pub_ctl_t *ctl;          /* read-only mapping */
+    matryoshka_image_t *img;          /* current version, NULL if none */
+    uint64_t            generation;   /* of img */
+};
+
+static bool pub_path(char *out, const char *prefix, uint64_t gen,
+                     const char *suffix)
+{
+    int len = gen ? snprintf(out, PUB_PATH_MAX, "%s.%" PRIu64 "%s",
+                             prefix, gen, suffix)
+                  : snprintf(out, PUB_PATH_MAX, "%s%s", prefix, suffix);
+    if (len < 0 || len >= PUB_PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    return true;
+}
+
+/* ── Writer ────────────────────────────────────────────────── */
+
+bool matryoshka_publish(const matryoshka_tree_t *tree, const char *prefix)
+{
+    char ctl_path[PUB_PATH_MAX], tmp[PUB_PATH_MAX], path[PUB_PATH_MAX];
+    if (!pub_path(ctl_path, prefix, 0, ".ctl"))
+        return false;
+
+    int fd = open(ctl_path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+    mt_pub_ctl_t *ctl = MAP_FAILED;
+    if (ftruncate(fd, MT_PAGE_SIZE) == 0)
+        ctl = mmap(NULL, MT_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    int err = errno;
+    close(fd);
+    if (ctl == MAP_FAILED) {
+        errno = err;
+        return false;
+    }
+    if (memcmp(ctl->magic, MT_PUB_MAGIC, sizeof(ctl->magic)) != 0) {
+        memset(ctl, 0, sizeof(*ctl));
+        memcpy(ctl->magic, MT_PUB_MAGIC, sizeof(ctl->magic));
+    }
+
+    uint64_t old = ctl->generation;
+    uint64_t gen = old + 1;
+    bool ok = pub_path(tmp, prefix, gen, ".img.tmp") &&
+              pub_path(path, prefix, gen, ".img") &&
+              matryoshka_image_save(tree, tmp);
+    if (ok && rename(tmp, path) != 0) {
+        err = errno;
+        unlink(tmp);
+        errno = err;
+        ok = false;
+    }
+
+    if (ok) {
+        uint64_t seq = ctl->seq;
+        __atomic_store_n(&ctl->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&ctl->generation, gen, __ATOMIC_RELAXED);
+        __atomic_store_n(&ctl->n, (uint64_t)tree->n, __ATOMIC_RELAXED);
+        __atomic_store_n(&ctl->seq, seq + 2, __ATOMIC_RELEASE);
+        if (old && pub_path(path, prefix, old, ".img"))
+            unlink(path);
+    }
+    err = errno;
+    munmap(ctl, MT_PAGE_SIZE);
+    errno = err;
+    return ok;
+}
+
+/* ── Reader ────────────────────────────────────────────────── */
+
+matryoshka_reader_t *matryoshka_reader_open(const char *prefix)
+{
+    char ctl_path[PUB_PATH_MAX];
+    if (!pub_path(ctl_path, prefix, 0, ".ctl"))
+        return NULL;
+    int fd = open(ctl_path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    /* A writer creates the file and then sizes it: a short one is not
+       ready yet, and mapping it would fault past EOF. */
+    struct stat st;
+    void *ctl = MAP_FAILED;
+    if (fstat(fd, &st) == 0) {
+        if (st.st_size >= MT_PAGE_SIZE)
+            ctl = mmap(NULL, MT_PAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        else
+            errno = EAGAIN;
+    }
+    int err = errno;
+    close(fd);
+    if (ctl == MAP_FAILED) {
+        errno = err;
+        return NULL;
+    }
+    /* Zeroed until the writer stamps it; anything else is not ours. */
+    const mt_pub_ctl_t *page = ctl;
+    if (memcmp(page->magic, MT_PUB_MAGIC, sizeof(page->magic)) != 0) {
+        static const char zero[sizeof(page->magic)];
+        err = memcmp(page->magic, zero, sizeof(zero)) == 0 ? EAGAIN : EINVAL;
+        munmap(ctl, MT_PAGE_SIZE);
+        errno = err;
+        return NULL;
+    }
+
+    matryoshka_reader_t *r = calloc(1, sizeof(*r));
+    if (r)
+        r->prefix = strdup(prefix);
+    if (!r || !r->prefix) {
+        free(r);
+        munmap(ctl, MT_PAGE_SIZE);
+        errno = ENOMEM;
+        return NULL;
+    }
+    r->ctl = ctl;
+    return r;
+}
+
+/* Consistent (generation, n) from the control page. */
+static void ctl_read(const mt_pub_ctl_t *ctl, uint64_t *gen, uint64_t *n)
+{
+    for (;;) {
+        uint64_t s = __atomic_load_n(&ctl->seq, __ATOMIC_ACQUIRE);
+        *gen = __atomic_load_n(&ctl->generation, __ATOMIC_RELAXED);
+        *n = __atomic_load_n(&ctl->n, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (!(s & 1) && __atomic_load_n(&ctl->seq, __ATOMIC_RELAXED) == s)
+            return;
+        _mm_pause();
+    }
+}
+
+const matryoshka_image_t *matryoshka_reader_current(matryoshka_reader_t *r)
+{
+    uint64_t gen, n, tried = 0;
+    for (;;) {
+        ctl_read(r->ctl, &gen, &n);
+        if (gen == 0 || gen == r->generation || gen == tried)
+            return r->img;   /* unchanged, or the new one is unreadable */
+
+        char path[PUB_PATH_MAX];
+        matryoshka_image_t *img = pub_path(path, r->prefix, gen, ".img")
+                                ? matryoshka_image_attach(path) : NULL;
+        if (img && matryoshka_image_size(img) == n) {
+            matryoshka_image_detach(r->img);
+            r->img = img;
+            r->generation = gen;
+            return img;
+        }
+        /* Gone already (superseded) or not what the page describes:
+           look again, but give up on a generation that stays bad. */
+        matryoshka_image_detach(img);
+        tried = gen;
+    }
+}
+
+uint64_t matryoshka_reader_generation(const matryoshka_reader_t *r)
+{
+    return r->generation;
+}
+
+void matryoshka_reader_close(matryoshka_reader_t *r)
+{
+    if (!r) return;
+    matryoshka_image_detach(r->img);
+    munmap((void *)r->ctl, MT_PAGE_SIZE);
+    free(r->prefix);
+    free(r);
+}
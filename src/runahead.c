@@ -0,0 +1,183 @@
+/*
+ * runahead.c — Helper-thread runahead for lookup streams.
+ *
+ * A caller that has to search its keys one at a time, in order, can
+ * start a helper on the sibling hyperthread of its core.  The helper
+ * reads the same key array up to `distance` keys ahead of the caller's
+ * reported position and walks each key down the tree: it reads the
+ * outer internal nodes and the page's CL internal nodes and prefetches
+ * the CL leaf, so the caller's own search finds those lines in the L1
+ * and L2 the two hyperthreads share.  The helper never writes the tree
+ * and never holds the caller up; if it falls behind, it skips to the
+ * caller's position rather than warm lines already used.
+ */
+
+#define _GNU_SOURCE
+#include "matryoshka_internal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RUNAHEAD_DISTANCE 256   /* default keys ahead */
+#define RUNAHEAD_SPINS    1024  /* idle pauses before yielding the CPU */
+
+struct matryoshka_runahead {
+    const matryoshka_tree_t *tree;
+    const int32_t           *keys;
+    size_t                   n;
+    size_t                   distance;
+    size_t                   walked;     /* set by the helper on exit */
+    bool                     stop;
+    pthread_t                thread;
+    _Alignas(64) size_t      pos;        /* caller's position, own line */
+};
+
+/* Walk `key` to its CL leaf: read what the descent needs, prefetch the
+   leaf line. */
+static void runahead_walk(const matryoshka_tree_t *tree, int32_t key)
+{
+    mt_node_t *node = tree->root;
+    for (int i = 0; i < tree->height; i++)
+        node = mt_untag(node->inode.children[mt_inode_search(&node->inode,
+                                                             key)]);
+    if (tree->hier.use_superpages) {
+        const mt_sp_header_t *hdr = (const mt_sp_header_t *)node;
+        const char *sp = (const char *)node;
+        if (hdr->nkeys == 0)
+            return;
+        const char *p = sp + (size_t)hdr->root_page * MT_PAGE_SIZE;
+        for (int l = hdr->sub_height; l > 0; l--) {
+            const mt_sp_inode_t *in = (const mt_sp_inode_t *)p;
+            p = sp + (size_t)in->children[mt_sp_inode_search(in, key)]
+                     * MT_PAGE_SIZE;
+        }
+        node = (mt_node_t *)p;
+    }
+    mt_page_prefetch_key(&node->lnode, key);
+}
+
+static void *runahead_main(void *arg)
+{
+    matryoshka_runahead_t *r = arg;
+    size_t next = 0, walked = 0;
+    unsigned idle = 0;
+
+    while (!__atomic_load_n(&r->stop, __ATOMIC_RELAXED)) {
+        size_t pos = __atomic_load_n(&r->pos, __ATOMIC_RELAXED);
+        if (pos > r->n)
+            pos = r->n;
+        size_t limit = (r->n - pos > r->distance) ? pos + r->distance : r->n;
+        if (next < pos)
+            next = pos;
+        if (next >= limit) {
+            if (pos >= r->n)
+                break;
+            /* Far enough ahead: leave the core's issue slots to the
+               caller, and the CPU too if it is not a hyperthread. */
+            if (++idle % RUNAHEAD_SPINS == 0)
+                sched_yield();
+            else
+                _mm_pause();
+            continue;
+        }
+        idle = 0;
+        runahead_walk(r->tree, r->keys[next++]);
+        walked++;
+    }
+    r->walked = walked;
+    return NULL;
+}
+
+/* First SMT sibling of `cpu` from sysfs, or -1.  The list reads like
+   "3,67" or "2-3". */
+static int smt_sibling(int cpu)
+{
+    char path[96];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list",
+             cpu);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    int sibling = -1, lo, hi;
+    char sep;
+    while (sibling < 0 && fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+            if (fscanf(f, "%d", &hi) != 1)
+                break;
+            if (fscanf(f, "%c", &sep) != 1)
+                sep = '\n';
+        }
+        for (int c = lo; c <= hi && sibling < 0; c++)
+            if (c != cpu)
+                sibling = c;
+        if (sep != ',')
+            break;
+    }
+    fclose(f);
+    return sibling;
+}
+
+matryoshka_runahead_t *matryoshka_runahead_start(const matryoshka_tree_t *tree,
+                                                 const int32_t *keys,
+                                                 size_t n, size_t distance,
+                                                 int cpu)
+{
+    if (!tree || (!keys && n > 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (cpu < 0) {
+        int self = sched_getcpu();
+        cpu = (self >= 0) ? smt_sibling(self) : -1;
+        if (cpu < 0) {
+            errno = ENODEV;
+            return NULL;
+        }
+    }
+
+    matryoshka_runahead_t *r = aligned_alloc(64, sizeof(*r));
+    if (!r)
+        return NULL;
+    memset(r, 0, sizeof(*r));
+    r->tree = tree;
+    r->keys = keys;
+    r->n = n;
+    r->distance = distance ? distance : RUNAHEAD_DISTANCE;
+
+    pthread_attr_t attr;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_attr_init(&attr);
+    if (!err)
+        err = pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    if (!err)
+        err = pthread_create(&r->thread, &attr, runahead_main, r);
+    pthread_attr_destroy(&attr);
+    if (err) {
+        free(r);
+        errno = err;
+        return NULL;
+    }
+    return r;
+}
+
+void matryoshka_runahead_advance(matryoshka_runahead_t *r, size_t pos)
+{
+    __atomic_store_n(&r->pos, pos, __ATOMIC_RELAXED);
+}
+
+size_t matryoshka_runahead_stop(matryoshka_runahead_t *r)
+{
+    if (!r) return 0;
+    __atomic_store_n(&r->stop, true, __ATOMIC_RELAXED);
+    pthread_join(r->thread, NULL);
+    size_t walked = r->walked;
+    free(r);
+    return walked;
+}
@@ -0,0 +1,657 @@
+/*
+ * scan.c — Predicate-filtered range scans.
+ *
+ * A filtered scan walks leaf pages through header.next like the
+ * iterator, but never materialises a page's sorted key array.  Each CL
+ * leaf is one cache line of up to 15 sorted keys; the range bounds and
+ * the predicate are evaluated over the whole line with SIMD compares
+ * and the matching lanes are compacted straight into the output.
+ *
+ * Z-order scans test Morton keys against a rectangle the same way, a
+ * line at a time, and jump over the stretches of the Z curve that lie
+ * outside the rectangle with fresh descents.
+ */
+
+#include "matryoshka_internal.h"
+#include <string.h>
+
+/* ── Scan context ──────────────────────────────────────────── */
+
+typedef struct scan_ctx {
+    int32_t  lo, hi;
+    matryoshka_pred_kind_t kind;
+
+    /* MASK */
+    int32_t  mask, value;
+
+    /* MOD: key ≡ r (mod m) is tested on u = key + 2^31 as
+       u ≥ rbias && rotr((u - rbias) · inv, shift) ≤ lim, the
+       multiply-by-inverse divisibility test for m = d · 2^shift. */
+    uint32_t inv, lim, shift, rbias;
+
+    /* RANGES: cursor advances monotonically as the scan ascends. */
+    const matryoshka_range_t *ranges;
+    size_t   nranges, rpos;
+
+    /* ZBOX: bounds on key & MT_ZX and key & MT_ZY, in key space, so
+       both compare as signed (see zbox_bounds). */
+    int32_t  zx_lo, zx_hi, zy_lo, zy_hi;
+} scan_ctx_t;
+
+/* ── Morton keys ───────────────────────────────────────────── */
+
+#define MT_ZX 0x55555555u   /* x bits of a Morton code */
+#define MT_ZY 0xAAAAAAAAu   /* y bits, the top one included */
+
+static inline uint32_t morton_spread(uint32_t v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+static inline uint32_t morton_compact(uint32_t v)
+{
+    v &= 0x55555555u;
+    v = (v | (v >> 1)) & 0x33333333u;
+    v = (v | (v >> 2)) & 0x0F0F0F0Fu;
+    v = (v | (v >> 4)) & 0x00FF00FFu;
+    v = (v | (v >> 8)) & 0x0000FFFFu;
+    return v;
+}
+
+static inline uint32_t morton_code(uint16_t x, uint16_t y)
+{
+    return morton_spread(x) | morton_spread(y) << 1;
+}
+
+/* Keys are codes with the top bit flipped. */
+static inline int32_t zkey(uint32_t z) { return (int32_t)(z ^ 0x80000000u); }
+static inline uint32_t zcode(int32_t k) { return (uint32_t)k ^ 0x80000000u; }
+
+int32_t matryoshka_morton_key(uint16_t x, uint16_t y)
+{
+    return zkey(morton_code(x, y));
+}
+
+void matryoshka_morton_xy(int32_t key, uint16_t *x, uint16_t *y)
+{
+    uint32_t z = zcode(key);
+    *x = (uint16_t)morton_compact(z);
+    *y = (uint16_t)morton_compact(z >> 1);
+}
+
+/* The x bits of a key are those of its code, and non-negative.  The y
+   bits carry the flipped top bit: key & MT_ZY is (z & MT_ZY) ^ 2^31,
+   which orders as signed just as z & MT_ZY does unsigned. */
+static void zbox_bounds(scan_ctx_t *c, const matryoshka_zbox_t *b)
+{
+    c->zx_lo = (int32_t)morton_spread(b->xlo);
+    c->zx_hi = (int32_t)morton_spread(b->xhi);
+    c->zy_lo = zkey(morton_spread(b->ylo) << 1);
+    c->zy_hi = zkey(morton_spread(b->yhi) << 1);
+}
+
+static inline bool zbox_match(const scan_ctx_t *c, int32_t key)
+{
+    int32_t kx = key & (int32_t)MT_ZX, ky = key & (int32_t)MT_ZY;
+    return kx >= c->zx_lo && kx <= c->zx_hi &&
+           ky >= c->zy_lo && ky <= c->zy_hi;
+}
+
+/* Returns false if the predicate can match nothing. */
+static bool scan_ctx_init(scan_ctx_t *c, int32_t lo, int32_t hi,
+                          const matryoshka_pred_t *pred)
+{
+    memset(c, 0, sizeof(*c));
+    c->lo = lo;
+    c->hi = hi;
+    c->kind = pred ? pred->kind : MATRYOSHKA_PRED_ALL;
+
+    switch (c->kind) {
+    case MATRYOSHKA_PRED_ALL:
+        return true;
+    case MATRYOSHKA_PRED_MASK:
+        c->mask = pred->mask;
+        c->value = pred->value;
+        return (pred->value & ~pred->mask) == 0;
+    case MATRYOSHKA_PRED_MOD: {
+        uint32_t m = pred->modulus;
+        if (m == 0 || pred->remainder >= m)
+            return false;
+        uint32_t shift = (uint32_t)__builtin_ctz(m);
+        uint32_t d = m >> shift;
+        uint32_t inv = d;                   /* Newton: 3 → 48 bits */
+        for (int i = 0; i < 4; i++)
+            inv *= 2u - d * inv;
+        c->inv = inv;
+        c->shift = shift;
+        c->lim = UINT32_MAX / m;
+        c->rbias = (uint32_t)(((uint64_t)pred->remainder + 0x80000000u) % m);
+        return true;
+    }
+    case MATRYOSHKA_PRED_RANGES:
+        c->ranges = pred->ranges;
+        c->nranges = pred->ranges ? pred->nranges : 0;
+        return c->nranges > 0;
+    case MATRYOSHKA_PRED_ZBOX:
+        if (!pred->zbox || pred->zbox->xlo > pred->zbox->xhi ||
+            pred->zbox->ylo > pred->zbox->yhi)
+            return false;
+        zbox_bounds(c, pred->zbox);
+        return true;
+    }
+    return false;
+}
+
+#if !defined(__AVX512F__) && !defined(__AVX2__)
+static inline bool mod_match(const scan_ctx_t *c, int32_t key)
+{
+    uint32_t u = (uint32_t)key ^ 0x80000000u;
+    uint32_t t = (u - c->rbias) * c->inv;
+    t = (t >> c->shift) | (t << ((32 - c->shift) & 31));
+    return u >= c->rbias && t <= c->lim;
+}
+#endif
+
+/* ── Per-line filter ───────────────────────────────────────── */
+
+/* Evaluate bounds and predicate over one CL leaf and write the matching
+   keys, in order, to buf[] (room for 16).  Returns the match count.
+   Loads are masked to nkeys lanes: the key array ends flush with the
+   cache line, which may be the last one in the page. */
+static int filter_line(const scan_ctx_t *c, const mt_cl_leaf_t *cl,
+                       int32_t *buf)
+{
+    int n = cl->nkeys;
+    int32_t last = cl->keys[n - 1];
+
+#if defined(__AVX512F__)
+    __mmask16 live = (__mmask16)((1u << n) - 1);
+    __m512i k = _mm512_maskz_loadu_epi32(live, cl->keys);
+    __mmask16 m = live
+        & _mm512_cmpge_epi32_mask(k, _mm512_set1_epi32(c->lo))
+        & _mm512_cmple_epi32_mask(k, _mm512_set1_epi32(c->hi));
+
+    switch (c->kind) {
+    case MATRYOSHKA_PRED_ALL:
+        break;
+    case MATRYOSHKA_PRED_MASK:
+        m &= _mm512_cmpeq_epi32_mask(
+                 _mm512_and_si512(k, _mm512_set1_epi32(c->mask)),
+                 _mm512_set1_epi32(c->value));
+        break;
+    case MATRYOSHKA_PRED_MOD: {
+        __m512i rb = _mm512_set1_epi32((int32_t)c->rbias);
+        __m512i u = _mm512_xor_si512(k, _mm512_set1_epi32(INT32_MIN));
+        __m512i t = _mm512_mullo_epi32(_mm512_sub_epi32(u, rb),
+                                       _mm512_set1_epi32((int32_t)c->inv));
+        t = _mm512_rorv_epi32(t, _mm512_set1_epi32((int32_t)c->shift));
+        m &= _mm512_cmpge_epu32_mask(u, rb)
+           & _mm512_cmple_epu32_mask(t, _mm512_set1_epi32((int32_t)c->lim));
+        break;
+    }
+    case MATRYOSHKA_PRED_RANGES: {
+        __mmask16 any = 0;
+        for (size_t j = c->rpos;
+             j < c->nranges && c->ranges[j].lo <= last; j++)
+            any |= _mm512_cmpge_epi32_mask(k, _mm512_set1_epi32(c->ranges[j].lo))
+                 & _mm512_cmple_epi32_mask(k, _mm512_set1_epi32(c->ranges[j].hi));
+        m &= any;
+        break;
+    }
+    case MATRYOSHKA_PRED_ZBOX: {
+        __m512i kx = _mm512_and_si512(k, _mm512_set1_epi32((int32_t)MT_ZX));
+        __m512i ky = _mm512_and_si512(k, _mm512_set1_epi32((int32_t)MT_ZY));
+        m &= _mm512_cmpge_epi32_mask(kx, _mm512_set1_epi32(c->zx_lo))
+           & _mm512_cmple_epi32_mask(kx, _mm512_set1_epi32(c->zx_hi))
+           & _mm512_cmpge_epi32_mask(ky, _mm512_set1_epi32(c->zy_lo))
+           & _mm512_cmple_epi32_mask(ky, _mm512_set1_epi32(c->zy_hi));
+        break;
+    }
+    }
+
+    _mm512_mask_compressstoreu_epi32(buf, m, k);
+    return __builtin_popcount(m);
+
+#elif defined(__AVX2__)
+    __m256i lo = _mm256_set1_epi32(c->lo);
+    __m256i hi = _mm256_set1_epi32(c->hi);
+    __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    uint32_t bits = 0;
+
+    for (int h = 0; h < n; h += 8) {
+        __m256i live = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - h), lane);
+        __m256i k = _mm256_maskload_epi32(cl->keys + h, live);
+        __m256i m = _mm256_andnot_si256(
+            _mm256_or_si256(_mm256_cmpgt_epi32(lo, k),
+                            _mm256_cmpgt_epi32(k, hi)), live);
+
+        switch (c->kind) {
+        case MATRYOSHKA_PRED_ALL:
+            break;
+        case MATRYOSHKA_PRED_MASK:
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(
+                    _mm256_and_si256(k, _mm256_set1_epi32(c->mask)),
+                    _mm256_set1_epi32(c->value)));
+            break;
+        case MATRYOSHKA_PRED_MOD: {
+            __m256i rb = _mm256_set1_epi32((int32_t)c->rbias);
+            __m256i lim = _mm256_set1_epi32((int32_t)c->lim);
+            __m256i u = _mm256_xor_si256(k, _mm256_set1_epi32(INT32_MIN));
+            __m256i t = _mm256_mullo_epi32(_mm256_sub_epi32(u, rb),
+                                           _mm256_set1_epi32((int32_t)c->inv));
+            t = _mm256_or_si256(
+                    _mm256_srlv_epi32(t, _mm256_set1_epi32((int32_t)c->shift)),
+                    _mm256_sllv_epi32(t, _mm256_set1_epi32(
+                                             (int32_t)(32 - c->shift))));
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(
+                    _mm256_max_epu32(u, rb), u));
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(
+                    _mm256_min_epu32(t, lim), t));
+            break;
+        }
+        case MATRYOSHKA_PRED_RANGES: {
+            __m256i any = _mm256_setzero_si256();
+            for (size_t j = c->rpos;
+                 j < c->nranges && c->ranges[j].lo <= last; j++) {
+                __m256i out = _mm256_or_si256(
+                    _mm256_cmpgt_epi32(_mm256_set1_epi32(c->ranges[j].lo), k),
+                    _mm256_cmpgt_epi32(k, _mm256_set1_epi32(c->ranges[j].hi)));
+                any = _mm256_or_si256(any, _mm256_xor_si256(
+                          out, _mm256_set1_epi32(-1)));
+            }
+            m = _mm256_and_si256(m, any);
+            break;
+        }
+        case MATRYOSHKA_PRED_ZBOX: {
+            __m256i kx = _mm256_and_si256(k, _mm256_set1_epi32((int32_t)MT_ZX));
+            __m256i ky = _mm256_and_si256(k, _mm256_set1_epi32((int32_t)MT_ZY));
+            __m256i out = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_cmpgt_epi32(_mm256_set1_epi32(c->zx_lo), kx),
+                    _mm256_cmpgt_epi32(kx, _mm256_set1_epi32(c->zx_hi))),
+                _mm256_or_si256(
+                    _mm256_cmpgt_epi32(_mm256_set1_epi32(c->zy_lo), ky),
+                    _mm256_cmpgt_epi32(ky, _mm256_set1_epi32(c->zy_hi))));
+            m = _mm256_andnot_si256(out, m);
+            break;
+        }
+        }
+        bits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(m)) << h;
+    }
+
+#else
+    __m128i lo = _mm_set1_epi32(c->lo);
+    __m128i hi = _mm_set1_epi32(c->hi);
+    uint32_t bits = 0;
+
+    for (int q = 0; q < n; q += 4) {
+        /* Lanes past nkeys hold stale bytes and are masked off below.
+           The last quad would overrun the line, so load keys[11..14]
+           and shift keys[12..14] down instead. */
+        __m128i k = (q < 12)
+            ? _mm_loadu_si128((const __m128i *)(cl->keys + q))
+            : _mm_srli_si128(_mm_loadu_si128((const __m128i *)
+                                             (cl->keys + 11)), 4);
+        __m128i m = _mm_or_si128(_mm_cmplt_epi32(k, lo),
+                                 _mm_cmpgt_epi32(k, hi));
+        m = _mm_xor_si128(m, _mm_set1_epi32(-1));
+
+        switch (c->kind) {
+        case MATRYOSHKA_PRED_ALL:
+        case MATRYOSHKA_PRED_MOD:
+            break;
+        case MATRYOSHKA_PRED_MASK:
+            m = _mm_and_si128(m, _mm_cmpeq_epi32(
+                    _mm_and_si128(k, _mm_set1_epi32(c->mask)),
+                    _mm_set1_epi32(c->value)));
+            break;
+        case MATRYOSHKA_PRED_RANGES: {
+            __m128i any = _mm_setzero_si128();
+            for (size_t j = c->rpos;
+                 j < c->nranges && c->ranges[j].lo <= last; j++) {
+                __m128i out = _mm_or_si128(
+                    _mm_cmplt_epi32(k, _mm_set1_epi32(c->ranges[j].lo)),
+                    _mm_cmpgt_epi32(k, _mm_set1_epi32(c->ranges[j].hi)));
+                any = _mm_or_si128(any, _mm_xor_si128(out, _mm_set1_epi32(-1)));
+            }
+            m = _mm_and_si128(m, any);
+            break;
+        }
+        case MATRYOSHKA_PRED_ZBOX: {
+            __m128i kx = _mm_and_si128(k, _mm_set1_epi32((int32_t)MT_ZX));
+            __m128i ky = _mm_and_si128(k, _mm_set1_epi32((int32_t)MT_ZY));
+            __m128i out = _mm_or_si128(
+                _mm_or_si128(_mm_cmplt_epi32(kx, _mm_set1_epi32(c->zx_lo)),
+                             _mm_cmpgt_epi32(kx, _mm_set1_epi32(c->zx_hi))),
+                _mm_or_si128(_mm_cmplt_epi32(ky, _mm_set1_epi32(c->zy_lo)),
+                             _mm_cmpgt_epi32(ky, _mm_set1_epi32(c->zy_hi))));
+            m = _mm_andnot_si128(out, m);
+            break;
+        }
+        }
+        bits |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(m)) << q;
+    }
+    bits &= (1u << n) - 1;
+
+    /* SSE2 has no 32-bit multiply; test the divisibility per lane. */
+    if (c->kind == MATRYOSHKA_PRED_MOD) {
+        for (int i = 0; i < n; i++)
+            if (!mod_match(c, cl->keys[i]))
+                bits &= ~(1u << i);
+    }
+#endif
+
+#if !defined(__AVX512F__)
+    /* Branchless compaction: every lane is stored, only matches advance. */
+    int cnt = 0;
+    for (int i = 0; i < n; i++) {
+        buf[cnt] = cl->keys[i];
+        cnt += (int)((bits >> i) & 1);
+    }
+    return cnt;
+#endif
+}
+
+/* ── Public API ────────────────────────────────────────────── */
+
+/* The leaf page that should contain `key`. */
+static const mt_lnode_t *scan_find_page(const matryoshka_tree_t *tree,
+                                        int32_t key)
+{
+    mt_node_t *node = tree->root;
+    for (int i = 0; i < tree->height; i++) {
+        int idx = mt_inode_search(&node->inode, key);
+        node = mt_untag(node->inode.children[idx]);
+    }
+    return tree->hier.use_superpages ? mt_sp_find_leaf(node, key)
+                                     : &node->lnode;
+}
+
+size_t matryoshka_scan_filtered(const matryoshka_tree_t *tree,
+                                 int32_t lo, int32_t hi,
+                                 const matryoshka_pred_t *pred,
+                                 int32_t *out, size_t cap)
+{
+    if (!tree || tree->n == 0 || cap == 0 || lo > hi)
+        return 0;
+
+    scan_ctx_t c;
+    if (!scan_ctx_init(&c, lo, hi, pred))
+        return 0;
+
+    const mt_lnode_t *page = scan_find_page(tree, lo);
+
+    const mt_cl_leaf_t *lines[MT_PAGE_SLOTS];
+    int32_t buf[16];
+    size_t n = 0;
+
+    for (; page; page = page->header.next) {
+        if (page->header.next)
+            __builtin_prefetch(page->header.next, 0, 0);
+
+        int nl = mt_page_cl_leaves(page, lines);
+        for (int i = 0; i < nl; i++) {
+            const mt_cl_leaf_t *cl = lines[i];
+            if (cl->nkeys == 0 || cl->keys[cl->nkeys - 1] < lo)
+                continue;
+            if (cl->keys[0] > hi)
+                return n;
+
+            if (c.kind == MATRYOSHKA_PRED_RANGES) {
+                while (c.rpos < c.nranges &&
+                       c.ranges[c.rpos].hi < cl->keys[0])
+                    c.rpos++;
+                if (c.rpos == c.nranges)
+                    return n;
+                if (c.ranges[c.rpos].lo > cl->keys[cl->nkeys - 1])
+                    continue;
+            }
+
+            size_t m = (size_t)filter_line(&c, cl, buf);
+            if (m > cap - n)
+                m = cap - n;
+            memcpy(out + n, buf, m * sizeof(int32_t));
+            n += m;
+            if (n == cap)
+                return n;
+        }
+    }
+    return n;
+}
+
+/* ── Multi-range scan ──────────────────────────────────────── */
+
+/* Range starts descended together.  Each level issues this many
+   independent node loads before any of them is waited on. */
+#define MT_SCAN_GROUP 16
+
+/* Append the keys of [lo, hi] to out[n..cap), starting at `page`.
+   Returns the new output count. */
+static size_t scan_range(const mt_lnode_t *page, int32_t lo, int32_t hi,
+                         int32_t *out, size_t n, size_t cap)
+{
+    scan_ctx_t c;
+    scan_ctx_init(&c, lo, hi, NULL);
+
+    const mt_cl_leaf_t *lines[MT_PAGE_SLOTS];
+    int32_t buf[16];
+
+    for (; page; page = page->header.next) {
+        bool past;
+        int nl = mt_page_cl_range(page, lo, hi, lines, &past);
+        if (!past && page->header.next)
+            __builtin_prefetch(page->header.next, 0, 0);
+
+        for (int i = 0; i < nl; i++) {
+            const mt_cl_leaf_t *cl = lines[i];
+            if (cl->nkeys == 0 || cl->keys[cl->nkeys - 1] < lo)
+                continue;
+            if (cl->keys[0] > hi)
+                return n;
+
+            size_t m = (size_t)filter_line(&c, cl, buf);
+            if (m > cap - n)
+                m = cap - n;
+            memcpy(out + n, buf, m * sizeof(int32_t));
+            n += m;
+            if (n == cap)
+                return n;
+        }
+        if (past)
+            break;
+    }
+    return n;
+}
+
+size_t matryoshka_scan_ranges(const matryoshka_tree_t *tree,
+                               const matryoshka_range_t *ranges,
+                               size_t nranges, int32_t *out, size_t cap,
+                               size_t *ends)
+{
+    size_t n = 0;
+    size_t r = 0;
+    if (!tree || tree->n == 0 || cap == 0)
+        goto done;
+
+    for (; r < nranges; r += MT_SCAN_GROUP) {
+        const matryoshka_range_t *g = ranges + r;
+        size_t gn = nranges - r < MT_SCAN_GROUP ? nranges - r : MT_SCAN_GROUP;
+        mt_node_t *node[MT_SCAN_GROUP];
+        int64_t    ub[MT_SCAN_GROUP];    /* exclusive bound of node[i] */
+
+        for (size_t i = 0; i < gn; i++) {
+            node[i] = tree->root;
+            ub[i] = INT64_MAX;
+        }
+
+        /* Descend level by level.  A start that sits in the same node
+           as the previous one, and below the bound of the child that
+           one took, takes that child too without searching. */
+        for (int level = 0; level < tree->height; level++) {
+            bool last = (level == tree->height - 1);
+            mt_node_t *prev_in = NULL;
+            for (size_t i = 0; i < gn; i++) {
+                mt_node_t *in = node[i];
+                int32_t lo = g[i].lo;
+                if (in == prev_in && lo >= g[i - 1].lo && lo < ub[i - 1]) {
+                    node[i] = node[i - 1];
+                    ub[i] = ub[i - 1];
+                    continue;
+                }
+                prev_in = in;
+
+                int idx = mt_inode_search(&in->inode, lo);
+                if (idx < in->inode.nkeys) {
+                    int32_t sep = mt_inode_key(&in->inode, idx);
+                    if (sep < ub[i]) ub[i] = sep;
+                }
+                mt_node_t *raw = in->inode.children[idx];
+                node[i] = mt_untag(raw);
+                __builtin_prefetch(node[i], 0, 1);
+                if (last && !tree->hier.use_superpages &&
+                    mt_ptr_root_slot(raw) > 0)
+                    __builtin_prefetch(
+                        &node[i]->lnode.slots[mt_ptr_root_slot(raw) - 1], 0, 1);
+            }
+        }
+
+        const mt_lnode_t *page[MT_SCAN_GROUP];
+        for (size_t i = 0; i < gn; i++) {
+            page[i] = tree->hier.use_superpages
+                      ? mt_sp_find_leaf(node[i], g[i].lo) : &node[i]->lnode;
+            __builtin_prefetch(page[i], 0, 1);
+        }
+
+        for (size_t i = 0; i < gn; i++) {
+            if (n < cap && g[i].lo <= g[i].hi)
+                n = scan_range(page[i], g[i].lo, g[i].hi, out, n, cap);
+            if (ends) ends[r + i] = n;
+        }
+        if (n == cap) {
+            r += gn;
+            break;
+        }
+    }
+
+done:
+    if (ends)
+        for (; r < nranges; r++)
+            ends[r] = n;
+    return n;
+}
+
+/* ── Z-order scan ──────────────────────────────────────────── */
+
+/* Tropf and Herzog's split of the Z-range [zmin, zmax] of a box at a
+   code z strictly inside the range but outside the box: *litmax is the
+   largest in-box code below z and *bigmin the smallest above it.  From
+   the top bit down, the range narrows to the half z's prefix lies in,
+   recording the nearest in-box code of the half it leaves. */
+static void zdivide(uint32_t z, uint32_t zmin, uint32_t zmax,
+                    uint32_t *litmax, uint32_t *bigmin)
+{
+    *litmax = zmin;
+    *bigmin = zmax;
+    for (int bit = 31; bit >= 0; bit--) {
+        uint32_t b = 1u << bit;
+        /* The lower bits of b's own dimension. */
+        uint32_t below = ((bit & 1) ? MT_ZY : MT_ZX) & (b - 1);
+        switch (((z & b) ? 4 : 0) | ((zmin & b) ? 2 : 0) |
+                ((zmax & b) ? 1 : 0)) {
+        case 1:         /* z in the low half of a split range */
+            *bigmin = (zmin | b) & ~below;
+            zmax = (zmax & ~b) | below;
+            break;
+        case 3:         /* the rest of the range lies above z */
+            *bigmin = zmin;
+            return;
+        case 4:         /* ... or below it */
+            *litmax = zmax;
+            return;
+        case 5:         /* z in the high half */
+            *litmax = (zmax & ~b) | below;
+            zmin = (zmin | b) & ~below;
+            break;
+        default:        /* 0, 7: no split here; 2, 6: zmin > zmax */
+            break;
+        }
+    }
+}
+
+size_t matryoshka_scan_zbox(const matryoshka_tree_t *tree,
+                             const matryoshka_zbox_t *box, int32_t from,
+                             int32_t *out, size_t cap)
+{
+    if (!tree || tree->n == 0 || cap == 0 || !box)
+        return 0;
+
+    uint32_t zmin = morton_code(box->xlo, box->ylo);
+    uint32_t zmax = morton_code(box->xhi, box->yhi);
+    matryoshka_pred_t pred = { .kind = MATRYOSHKA_PRED_ZBOX, .zbox = box };
+    scan_ctx_t c;
+    if (!scan_ctx_init(&c, zkey(zmin), zkey(zmax), &pred) || from > c.hi)
+        return 0;
+    if (from > c.lo)
+        c.lo = from;
+
+    const mt_cl_leaf_t *lines[MT_PAGE_SLOTS];
+    int32_t buf[16];
+    size_t n = 0;
+    const mt_lnode_t *page = scan_find_page(tree, c.lo);
+
+    while (page) {
+        bool past, seek = false;
+        int nl = mt_page_cl_range(page, c.lo, c.hi, lines, &past);
+        if (!past && page->header.next)
+            __builtin_prefetch(page->header.next, 0, 0);
+
+        for (int i = 0; i < nl && !seek; i++) {
+            const mt_cl_leaf_t *cl = lines[i];
+            if (cl->nkeys == 0 || cl->keys[cl->nkeys - 1] < c.lo)
+                continue;
+            if (cl->keys[0] > c.hi)
+                return n;
+
+            /* A line that ends outside the box is the last one before
+               the curve leaves it; it holds a match only if LITMAX
+               reaches back into it. */
+            int32_t last = cl->keys[cl->nkeys - 1];
+            uint32_t lit = 0, big = 0;
+            bool any = true;
+            if (last < c.hi && !zbox_match(&c, last)) {
+                zdivide(zcode(last), zmin, zmax, &lit, &big);
+                any = lit >= zcode(cl->keys[0] > c.lo ? cl->keys[0] : c.lo);
+                seek = true;
+            }
+            if (any) {
+                size_t m = (size_t)filter_line(&c, cl, buf);
+                if (m > cap - n)
+                    m = cap - n;
+                memcpy(out + n, buf, m * sizeof(int32_t));
+                n += m;
+                if (n == cap)
+                    return n;
+            }
+            if (seek)
+                c.lo = zkey(big);
+        }
+
+        if (seek) {
+            /* Back into the box at BIGMIN: search this page again if
+               it reaches that far, else descend to it afresh. */
+            const mt_cl_leaf_t *tail = lines[nl - 1];
+            if (tail->nkeys == 0 || tail->keys[tail->nkeys - 1] < c.lo)
+                page = scan_find_page(tree, c.lo);
+            continue;
+        }
+        if (past)
+            return n;
+        page = page->header.next;
+    }
+    return n;
+}
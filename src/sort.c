@@ -0,0 +1,84 @@
+/*
+ * sort.c — In-place key sort for batch operations.
+ *
+ * An American-flag (in-place MSD radix) sort on the key bits, one byte
+ * per pass from the top, with insertion sort for small buckets.  It
+ * allocates nothing (glibc qsort may malloc a merge buffer), and runs in
+ * O(n) passes over the keys instead of O(n log n) comparisons.  Each of
+ * the four levels of recursion keeps two 256-entry size_t tables on the
+ * stack, 4 KiB per level and 16 KiB in all on LP64.
+ */
+
+#include "matryoshka_internal.h"
+
+#define SORT_SMALL 32
+
+static inline uint32_t sort_bits(int32_t k)
+{
+    return (uint32_t)k ^ 0x80000000u;   /* signed order as unsigned */
+}
+
+static void insertion_sort(int32_t *a, size_t n)
+{
+    for (size_t i = 1; i < n; i++) {
+        int32_t x = a[i];
+        size_t j = i;
+        while (j > 0 && a[j - 1] > x) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = x;
+    }
+}
+
+static void flag_sort(int32_t *a, size_t n, int shift)
+{
+    if (n <= SORT_SMALL) {
+        insertion_sort(a, n);
+        return;
+    }
+
+    size_t count[256] = {0};
+    for (size_t i = 0; i < n; i++)
+        count[(sort_bits(a[i]) >> shift) & 0xFF]++;
+
+    size_t head[256], pos = 0;
+    for (int b = 0; b < 256; b++) {
+        head[b] = pos;
+        pos += count[b];
+    }
+
+    /* Cycle each misplaced key to its bucket's next free position.  A
+       bucket ends where the next one started, so its end is a running
+       sum of the counts rather than a third table. */
+    size_t end = 0;
+    for (int b = 0; b < 256; b++) {
+        end += count[b];
+        while (head[b] < end) {
+            int32_t x = a[head[b]];
+            int d = (int)((sort_bits(x) >> shift) & 0xFF);
+            while (d != b) {
+                int32_t y = a[head[d]];
+                a[head[d]++] = x;
+                x = y;
+                d = (int)((sort_bits(x) >> shift) & 0xFF);
+            }
+            a[head[b]++] = x;
+        }
+    }
+
+    if (shift == 0)
+        return;
+    size_t start = 0;
+    for (int b = 0; b < 256; b++) {
+        if (count[b] > 1)
+            flag_sort(a + start, count[b], shift - 8);
+        start += count[b];
+    }
+}
+
+void mt_sort_keys(int32_t *keys, size_t n)
+{
+    if (n > 1)
+        flag_sort(keys, n, 24);
+}
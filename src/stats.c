@@ -0,0 +1,70 @@
+/*
+ * stats.c — Tree shape and memory statistics.
+ *
+ * A full walk of the outer tree: internal nodes recursively, then every
+ * leaf page (inside superpages too) for key counts, CL slot usage and
+ * the fill histogram.  Meant for periodic sampling by soak benchmarks
+ * and monitoring, not for hot paths.
+ */
+
+#include "matryoshka_internal.h"
+#include <string.h>
+
+static void stats_page(const matryoshka_tree_t *tree, const mt_lnode_t *page,
+                       matryoshka_stats_t *out)
+{
+    int cap = tree->hier.page_max_keys;
+    int b = cap > 0 ? (int)((int64_t)page->header.nkeys *
+                            MATRYOSHKA_FILL_BUCKETS / cap) : 0;
+    if (b >= MATRYOSHKA_FILL_BUCKETS) b = MATRYOSHKA_FILL_BUCKETS - 1;
+
+    out->pages++;
+    out->cl_slots += page->header.nslots_used;
+    out->fill[b]++;
+}
+
+static void stats_leaf(const matryoshka_tree_t *tree, mt_node_t *leaf,
+                       matryoshka_stats_t *out)
+{
+    out->leaves++;
+    if (!tree->hier.use_superpages) {
+        stats_page(tree, &leaf->lnode, out);
+        return;
+    }
+
+    /* Page leaves of a superpage are chained in key order. */
+    mt_lnode_t *last = mt_sp_last_leaf(leaf);
+    for (mt_lnode_t *p = mt_sp_first_leaf(leaf); p; p = p->header.next) {
+        stats_page(tree, p, out);
+        if (p == last) break;
+    }
+}
+
+static void stats_subtree(const matryoshka_tree_t *tree, mt_node_t *node,
+                          int level, matryoshka_stats_t *out)
+{
+    if (level == tree->height) {
+        stats_leaf(tree, node, out);
+        return;
+    }
+    out->inodes++;
+    for (int i = 0; i <= node->inode.nkeys; i++)
+        stats_subtree(tree, mt_untag(node->inode.children[i]), level + 1, out);
+}
+
+void matryoshka_stats(const matryoshka_tree_t *tree, matryoshka_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!tree) return;
+
+    out->keys = tree->n;
+    out->height = tree->height;
+    if (tree->root)
+        stats_subtree(tree, tree->root, 0, out);
+    out->node_bytes = out->inodes * MT_PAGE_SIZE +
+                      out->leaves * tree->hier.leaf_alloc;
+
+    if (tree->alloc)
+        for (const mt_arena_t *a = tree->alloc->arenas; a; a = a->next)
+            out->arena_bytes += a->size;
+}
@@ -72,7 +72,7 @@ static void sp_page_free(mt_sp_header_t *hdr, int idx)
 
 /* Binary search in a page-level internal node.
    Returns child index i such that children[i] should be followed. */
-static int sp_inode_search(const mt_sp_inode_t *node, int32_t key)
+int mt_sp_inode_search(const mt_sp_inode_t *node, int32_t key)
 {
     int lo = 0, hi = node->nkeys;
     while (lo < hi) {
@@ -131,7 +131,7 @@ static int sp_find_leaf(const void *sp, int32_t key,
     for (int i = 0; i < height; i++) {
         const mt_sp_inode_t *inode =
             (const mt_sp_inode_t *)sp_page_c(sp, page_idx);
-        int ci = sp_inode_search(inode, key);
+        int ci = mt_sp_inode_search(inode, key);
         path[*path_len].page_idx = (uint16_t)page_idx;
         path[*path_len].child_idx = (uint16_t)ci;
         (*path_len)++;
@@ -203,17 +203,8 @@ bool mt_sp_search_key(const void *sp, int32_t key, int32_t *result)
     if (page->header.prev) {
         const mt_lnode_t *prev = page->header.prev;
         if (prev->header.nkeys > 0) {
-            /* Get max key of previous page via rightmost CL leaf. */
-            int slot = prev->header.root_slot;
-            const mt_cl_slot_t *s = &prev->slots[slot - 1];
-            while (s->type == MT_CL_INTERNAL) {
-                slot = s->inode.children[s->inode.nkeys];
-                s = &prev->slots[slot - 1];
-            }
-            if (s->leaf.nkeys > 0) {
-                if (result) *result = s->leaf.keys[s->leaf.nkeys - 1];
-                return true;
-            }
+            if (result) *result = mt_page_max_key(prev);
+            return true;
         }
     }
 
@@ -314,13 +305,9 @@ mt_status_t mt_sp_insert(void *sp, int32_t key, const mt_hierarchy_t *hier)
         memset(new_inode, 0, MT_PAGE_SIZE);
         new_inode->type = 2;
 
-        /* Build merged arrays on heap (too large for stack). */
-        int32_t *all_keys = malloc((size_t)(pn + 1) * sizeof(int32_t));
-        uint16_t *all_ch = malloc((size_t)(pn + 2) * sizeof(uint16_t));
-        if (!all_keys || !all_ch) {
-            free(all_keys); free(all_ch);
-            return MT_PAGE_FULL;
-        }
+        /* Merged arrays: one page's worth, on the stack. */
+        int32_t all_keys[MT_SP_MAX_IKEYS + 1];
+        uint16_t all_ch[MT_SP_MAX_IKEYS + 2];
 
         memcpy(all_keys, parent->keys, (size_t)pos * sizeof(int32_t));
         all_keys[pos] = sep;
@@ -347,7 +334,6 @@ mt_status_t mt_sp_insert(void *sp, int32_t key, const mt_hierarchy_t *hier)
                (size_t)(right_keys + 1) * sizeof(uint16_t));
         new_inode->nkeys = (uint16_t)right_keys;
 
-        free(all_keys); free(all_ch);
         right_page = (uint16_t)new_inode_idx;
     }
 
@@ -384,6 +370,19 @@ mt_status_t mt_sp_delete(void *sp, int32_t key, const mt_hierarchy_t *hier)
 
     hdr->nkeys--;
 
+    /* Tight separators inside the superpage too (see tighten_separator
+       in matryoshka.c). */
+    if (hier->tight_separators && page->header.nkeys > 0) {
+        for (int l = path_len - 1; l >= 0; l--) {
+            if (path[l].child_idx == 0)
+                continue;
+            mt_sp_inode_t *in = (mt_sp_inode_t *)sp_page(sp, path[l].page_idx);
+            if (in->keys[path[l].child_idx - 1] == key)
+                in->keys[path[l].child_idx - 1] = mt_page_min_key(page);
+            break;
+        }
+    }
+
     if (status == MT_OK || path_len == 0)
         goto check_sp_underflow;
 
@@ -565,10 +564,13 @@ int mt_sp_extract_sorted(const void *sp, int32_t *out)
 
 /* ── Bulk load ───────────────────────────────────────────────── */
 
-void mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
-                      const mt_hierarchy_t *hier)
+static void sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
+                         const mt_hierarchy_t *hier, bool stream)
 {
-    memset(sp, 0, MT_SP_SIZE);
+    /* Streaming: only the header page is cleared through the cache.
+       Unallocated pages are left as they are, like pages freed by
+       deletes: whoever takes one with sp_page_alloc initialises it. */
+    memset(sp, 0, stream ? MT_PAGE_SIZE : MT_SP_SIZE);
     mt_sp_header_t *hdr = sp_hdr(sp);
     hdr->type = MT_NODE_LEAF;
     hdr->page_bitmap[0] = 1;  /* bit 0 = header */
@@ -588,20 +590,36 @@ void mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
     int keys_per = nkeys / nleaves;
     int extra = nkeys % nleaves;
 
-    uint16_t *leaf_pages = malloc((size_t)nleaves * sizeof(uint16_t));
-    int32_t *seps = malloc((size_t)nleaves * sizeof(int32_t));
-    if (!leaf_pages || !seps) {
-        free(leaf_pages); free(seps);
+    /* Page indices and separators of one level; each level is built
+       over the one below in place, since parent p never reads past
+       child p.  A superpage has at most MT_SP_PAGES of either. */
+    uint16_t pages[MT_SP_PAGES] = {0};
+    int32_t seps[MT_SP_PAGES];
+    if (nleaves >= (int)MT_SP_PAGES)
         return;
+
+    if (stream) {
+        /* Place every leaf first so each page is streamed with its links. */
+        for (int i = 0; i < nleaves; i++)
+            pages[i] = (uint16_t)sp_page_alloc(hdr);
     }
 
     int offset = 0;
     for (int i = 0; i < nleaves; i++) {
         int k = keys_per + (i < extra ? 1 : 0);
-        int pidx = sp_page_alloc(hdr);
-        mt_lnode_t *page = (mt_lnode_t *)sp_page(sp, pidx);
-        mt_page_bulk_load(page, keys + offset, k, hier);
-        leaf_pages[i] = (uint16_t)pidx;
+        if (stream) {
+            mt_lnode_t *prev = (i > 0)
+                ? (mt_lnode_t *)sp_page(sp, pages[i - 1]) : NULL;
+            mt_lnode_t *next = (i < nleaves - 1)
+                ? (mt_lnode_t *)sp_page(sp, pages[i + 1]) : NULL;
+            mt_page_bulk_load_nt((mt_lnode_t *)sp_page(sp, pages[i]),
+                                 keys + offset, k, hier, prev, next);
+        } else {
+            int pidx = sp_page_alloc(hdr);
+            mt_lnode_t *page = (mt_lnode_t *)sp_page(sp, pidx);
+            mt_page_bulk_load(page, keys + offset, k, hier);
+            pages[i] = (uint16_t)pidx;
+        }
         seps[i] = keys[offset];
         offset += k;
     }
@@ -609,24 +627,15 @@ void mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
     hdr->nkeys = (uint32_t)nkeys;
 
     /* Link page leaves within superpage. */
-    for (int i = 0; i < nleaves; i++) {
-        mt_lnode_t *page = (mt_lnode_t *)sp_page(sp, leaf_pages[i]);
+    for (int i = 0; i < nleaves && !stream; i++) {
+        mt_lnode_t *page = (mt_lnode_t *)sp_page(sp, pages[i]);
         page->header.prev = (i > 0)
-            ? (mt_lnode_t *)sp_page(sp, leaf_pages[i - 1]) : NULL;
+            ? (mt_lnode_t *)sp_page(sp, pages[i - 1]) : NULL;
         page->header.next = (i < nleaves - 1)
-            ? (mt_lnode_t *)sp_page(sp, leaf_pages[i + 1]) : NULL;
-    }
-
-    if (nleaves == 1) {
-        hdr->root_page = leaf_pages[0];
-        hdr->sub_height = 0;
-        free(leaf_pages); free(seps);
-        return;
+            ? (mt_lnode_t *)sp_page(sp, pages[i + 1]) : NULL;
     }
 
     /* Build page-level internals bottom-up. */
-    uint16_t *cur_pages = leaf_pages;
-    int32_t *cur_seps = seps;
     int level_count = nleaves;
     int height = 0;
 
@@ -635,8 +644,6 @@ void mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
         int num_parents = (level_count + cap - 1) / cap;
         if (num_parents == 0) num_parents = 1;
 
-        uint16_t *next_pages = malloc((size_t)num_parents * sizeof(uint16_t));
-        int32_t *next_seps = malloc((size_t)num_parents * sizeof(int32_t));
         int children_per = level_count / num_parents;
         int extra_c = level_count % num_parents;
         int ci = 0;
@@ -648,48 +655,50 @@ void mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
             memset(inode, 0, MT_PAGE_SIZE);
             inode->type = 2;
 
-            inode->children[0] = cur_pages[ci];
+            inode->children[0] = pages[ci];
             for (int j = 1; j < nc; j++) {
-                inode->keys[j - 1] = cur_seps[ci + j];
-                inode->children[j] = cur_pages[ci + j];
+                inode->keys[j - 1] = seps[ci + j];
+                inode->children[j] = pages[ci + j];
             }
             inode->nkeys = (uint16_t)(nc - 1);
 
-            next_pages[p] = (uint16_t)pidx;
-            next_seps[p] = cur_seps[ci];
+            pages[p] = (uint16_t)pidx;
+            seps[p] = seps[ci];
             ci += nc;
         }
 
-        free(cur_pages); free(cur_seps);
-        cur_pages = next_pages;
-        cur_seps = next_seps;
         level_count = num_parents;
         height++;
     }
 
-    hdr->root_page = cur_pages[0];
+    hdr->root_page = pages[0];
     hdr->sub_height = (uint8_t)height;
-    free(cur_pages); free(cur_seps);
 }
 
-/* ── Split ───────────────────────────────────────────────────── */
+void mt_sp_bulk_load(void *sp, const int32_t *keys, int nkeys,
+                      const mt_hierarchy_t *hier)
+{
+    sp_bulk_load(sp, keys, nkeys, hier, false);
+}
 
-int32_t mt_sp_split(void *sp, void *new_sp, const mt_hierarchy_t *hier)
+void mt_sp_bulk_load_nt(void *sp, const int32_t *keys, int nkeys,
+                         const mt_hierarchy_t *hier)
 {
-    int total = (int)sp_hdr(sp)->nkeys;
-    int32_t *all_keys = malloc((size_t)total * sizeof(int32_t));
-    if (!all_keys) return 0;
+    sp_bulk_load(sp, keys, nkeys, hier, true);
+}
+
+/* ── Split ───────────────────────────────────────────────────── */
 
-    int n = mt_sp_extract_sorted(sp, all_keys);
+int32_t mt_sp_split(void *sp, void *new_sp, const mt_hierarchy_t *hier,
+                    int32_t *scratch)
+{
+    int n = mt_sp_extract_sorted(sp, scratch);
     int left_n = n / 2;
     int right_n = n - left_n;
 
-    mt_sp_bulk_load(sp, all_keys, left_n, hier);
-    mt_sp_bulk_load(new_sp, all_keys + left_n, right_n, hier);
-
-    int32_t sep = all_keys[left_n];
-    free(all_keys);
-    return sep;
+    mt_sp_bulk_load(sp, scratch, left_n, hier);
+    mt_sp_bulk_load(new_sp, scratch + left_n, right_n, hier);
+    return scratch[left_n];
 }
 
 /* ── Min key ─────────────────────────────────────────────────── */
@@ -711,15 +720,7 @@ int32_t mt_sp_max_key(const void *sp)
 
     int leaf_idx = sp_rightmost_leaf(sp);
     const mt_lnode_t *page = (const mt_lnode_t *)sp_page_c(sp, leaf_idx);
-
-    /* Walk to rightmost CL leaf within the page. */
-    int slot = page->header.root_slot;
-    const mt_cl_slot_t *s = &page->slots[slot - 1];
-    while (s->type == MT_CL_INTERNAL) {
-        slot = s->inode.children[s->inode.nkeys];
-        s = &page->slots[slot - 1];
-    }
-    return (s->leaf.nkeys > 0) ? s->leaf.keys[s->leaf.nkeys - 1] : INT32_MIN;
+    return mt_page_max_key(page);
 }
 
 /* ── Iterator helpers ────────────────────────────────────────── */
@@ -743,3 +744,85 @@ mt_lnode_t *mt_sp_find_leaf(void *sp, int32_t key)
     int leaf_idx = sp_find_leaf(sp, key, path, &path_len);
     return (mt_lnode_t *)sp_page(sp, leaf_idx);
 }
+
+/* ── Explain ─────────────────────────────────────────────────── */
+
+/* Touch the binary search probes of mt_sp_inode_search and the child
+   followed. */
+static void sp_inode_touch(const mt_sp_inode_t *node, int32_t key, int ci,
+                           mt_explain_ctx_t *x)
+{
+    mt_explain_touch(x, &node->nkeys, sizeof(node->nkeys));
+    int lo = 0, hi = node->nkeys;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        mt_explain_touch(x, &node->keys[mid], sizeof(node->keys[0]));
+        if (node->keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    mt_explain_touch(x, &node->children[ci], sizeof(node->children[0]));
+}
+
+/* mt_sp_search_key, one timed step per page visited. */
+bool mt_sp_explain(const void *sp, int32_t key, int32_t *result,
+                   mt_explain_ctx_t *x)
+{
+    const mt_sp_header_t *hdr = sp_hdr_c(sp);
+    uint64_t t = mt_explain_clock();
+    uint32_t nkeys = __atomic_load_n(&hdr->nkeys, __ATOMIC_RELAXED);
+    t = mt_explain_since(x, t);
+    int page_idx = hdr->root_page;
+    mt_explain_step(x, MATRYOSHKA_STEP_SUPERPAGE, MATRYOSHKA_PATH_SEARCH,
+                    sp, page_idx, -1, t);
+    mt_explain_touch(x, hdr, offsetof(mt_sp_header_t, page_bitmap));
+    if (nkeys == 0)
+        return false;
+
+    for (int i = 0; i < hdr->sub_height; i++) {
+        const mt_sp_inode_t *inode =
+            (const mt_sp_inode_t *)sp_page_c(sp, page_idx);
+        t = mt_explain_clock();
+        int ci = mt_sp_inode_search(inode, key);
+        t = mt_explain_since(x, t);
+        mt_explain_step(x, MATRYOSHKA_STEP_SP_INODE, MATRYOSHKA_PATH_SEARCH,
+                        inode, page_idx, ci, t);
+        sp_inode_touch(inode, key, ci, x);
+        page_idx = inode->children[ci];
+    }
+
+    const mt_lnode_t *page = (const mt_lnode_t *)sp_page_c(sp, page_idx);
+    if (mt_page_explain(page, key, result, x))
+        return true;
+    if (page->header.prev && page->header.prev->header.nkeys > 0) {
+        *result = mt_explain_prev_page(x, page->header.prev);
+        return true;
+    }
+    return false;
+}
+
+/* Fallback to the previous superpage's maximum (mt_sp_max_key). */
+int32_t mt_sp_explain_max(const void *sp, mt_explain_ctx_t *x)
+{
+    uint64_t t = mt_explain_clock();
+    int32_t max = mt_sp_max_key(sp);
+    t = mt_explain_since(x, t);
+    mt_explain_step(x, MATRYOSHKA_STEP_PREV_LEAF, MATRYOSHKA_PATH_SEARCH,
+                    sp, -1, -1, t);
+
+    const mt_sp_header_t *hdr = sp_hdr_c(sp);
+    mt_explain_touch(x, hdr, offsetof(mt_sp_header_t, page_bitmap));
+    int page_idx = hdr->root_page;
+    for (int i = 0; i < hdr->sub_height; i++) {
+        const mt_sp_inode_t *inode =
+            (const mt_sp_inode_t *)sp_page_c(sp, page_idx);
+        mt_explain_touch(x, &inode->nkeys, sizeof(inode->nkeys));
+        mt_explain_touch(x, &inode->children[inode->nkeys],
+                         sizeof(inode->children[0]));
+        page_idx = inode->children[inode->nkeys];
+    }
+    mt_page_touch_max((const mt_lnode_t *)sp_page_c(sp, page_idx), x);
+    x->out->prev_leaf = true;
+    return max;
+}
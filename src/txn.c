@@ -0,0 +1,566 @@
+/*
+ * txn.c — Optimistic multi-key transactions.
+ *
+ * Concurrency control has two parts.
+ *
+ * The outer tree's shape (internal nodes, leaf pointers, the root) is
+ * guarded by a gate.  Reads and ordinary commits hold it shared, which
+ * costs one uncontended increment on a per-thread-slot counter; splits
+ * and merges hold it exclusively, and every exclusive section bumps the
+ * gate's SMO count.  Under the shared gate no leaf moves or is freed.
+ *
+ * Leaf contents are guarded by version locks, striped by leaf address:
+ * even = unlocked, odd = latched, and unlocking after a change adds 2.
+ * A read copies the leaf page between two loads of its stripe and keeps
+ * the copy only if they match, then records (stripe, version).  A
+ * commit latches the stripes of its write set in index order, checks
+ * the read set, applies each leaf's writes to a staged copy with the
+ * page-level primitives, and publishes the copies before unlocking.  A
+ * write that would split or merge a leaf makes nothing visible: the
+ * commit drops its latches and re-runs under the exclusive gate with
+ * the ordinary insert and delete.  A transaction whose reads span an
+ * exclusive section aborts, since keys may have moved between leaves.
+ */
+
+#include "matryoshka_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ── Domain ────────────────────────────────────────────────── */
+
+#define MT_TXN_READERS      64          /* gate reader counters */
+#define MT_TXN_STRIPE_BITS  10
+#define MT_TXN_STRIPES      (1u << MT_TXN_STRIPE_BITS)
+
+typedef struct {
+    _Alignas(MT_CL_SIZE) uint64_t v;
+} mt_txn_line_t;
+
+struct mt_txn_domain {
+    _Alignas(MT_CL_SIZE) uint32_t writer;   /* 1 while held exclusively */
+    _Alignas(MT_CL_SIZE) uint64_t smo;      /* exclusive sections so far */
+    mt_txn_line_t readers[MT_TXN_READERS];
+    mt_txn_line_t stripes[MT_TXN_STRIPES];
+};
+
+typedef struct {
+    int32_t  key;
+    uint8_t  insert;
+    uint32_t seq;
+} mt_txn_op_t;
+
+typedef struct {
+    uint32_t stripe;
+    uint64_t version;
+} mt_txn_read_t;
+
+struct matryoshka_txn {
+    matryoshka_tree_t    *tree;
+    struct mt_txn_domain *dom;
+    uint64_t              smo;      /* gate SMO count at the first read */
+    mt_txn_op_t          *ops;
+    size_t                nops, cap_ops;
+    mt_txn_read_t        *reads;
+    size_t                nreads, cap_reads;
+    bool                  failed;   /* a call ran out of memory */
+};
+
+static uint32_t txn_next_reader;
+static _Thread_local int txn_reader = -1;
+
+void mt_txn_domain_destroy(struct mt_txn_domain *dom)
+{
+    free(dom);
+}
+
+static struct mt_txn_domain *txn_domain(matryoshka_tree_t *tree)
+{
+    struct mt_txn_domain *dom = __atomic_load_n(&tree->txn, __ATOMIC_ACQUIRE);
+    if (dom) return dom;
+
+    dom = aligned_alloc(MT_CL_SIZE, sizeof(*dom));
+    if (!dom) return NULL;
+    memset(dom, 0, sizeof(*dom));
+    struct mt_txn_domain *expected = NULL;
+    if (!__atomic_compare_exchange_n(&tree->txn, &expected, dom, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(dom);
+        dom = expected;
+    }
+    return dom;
+}
+
+static inline uint32_t txn_stripe(const void *leaf)
+{
+    uint64_t h = ((uint64_t)(uintptr_t)leaf >> 12) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> (64 - MT_TXN_STRIPE_BITS));
+}
+
+/* ── Gate ──────────────────────────────────────────────────── */
+
+static void gate_enter(struct mt_txn_domain *dom)
+{
+    if (txn_reader < 0)
+        txn_reader = (int)(__atomic_fetch_add(&txn_next_reader, 1,
+                                              __ATOMIC_RELAXED)
+                           % MT_TXN_READERS);
+    uint64_t *cnt = &dom->readers[txn_reader].v;
+
+    for (;;) {
+        __atomic_fetch_add(cnt, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&dom->writer, __ATOMIC_SEQ_CST) == 0)
+            return;
+        __atomic_fetch_sub(cnt, 1, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&dom->writer, __ATOMIC_ACQUIRE))
+            _mm_pause();
+    }
+}
+
+static void gate_exit(struct mt_txn_domain *dom)
+{
+    __atomic_fetch_sub(&dom->readers[txn_reader].v, 1, __ATOMIC_RELEASE);
+}
+
+static void gate_enter_exclusive(struct mt_txn_domain *dom)
+{
+    uint32_t free_ = 0;
+    while (!__atomic_compare_exchange_n(&dom->writer, &free_, 1, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        free_ = 0;
+        _mm_pause();
+    }
+    for (int i = 0; i < MT_TXN_READERS; i++)
+        while (__atomic_load_n(&dom->readers[i].v, __ATOMIC_ACQUIRE))
+            _mm_pause();
+}
+
+static void gate_exit_exclusive(struct mt_txn_domain *dom)
+{
+    __atomic_store_n(&dom->smo, dom->smo + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&dom->writer, 0, __ATOMIC_RELEASE);
+}
+
+/* ── Version locks ─────────────────────────────────────────── */
+
+/* Current version of a stripe, waiting out any latch holder. */
+static uint64_t stripe_read_begin(struct mt_txn_domain *dom, uint32_t s)
+{
+    uint64_t v;
+    while ((v = __atomic_load_n(&dom->stripes[s].v, __ATOMIC_ACQUIRE)) & 1)
+        _mm_pause();
+    return v;
+}
+
+/* True if nothing was latched or changed since stripe_read_begin. */
+static bool stripe_read_valid(struct mt_txn_domain *dom, uint32_t s,
+                              uint64_t v)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&dom->stripes[s].v, __ATOMIC_RELAXED) == v;
+}
+
+static void stripe_lock(struct mt_txn_domain *dom, uint32_t s)
+{
+    for (;;) {
+        uint64_t v = stripe_read_begin(dom, s);
+        if (__atomic_compare_exchange_n(&dom->stripes[s].v, &v, v | 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+/* Release a latch; `changed` moves the stripe to a new version. */
+static void stripe_unlock(struct mt_txn_domain *dom, uint32_t s, bool changed)
+{
+    uint64_t v = dom->stripes[s].v;
+    __atomic_store_n(&dom->stripes[s].v, changed ? v + 1 : v - 1,
+                     __ATOMIC_RELEASE);
+}
+
+/* ── Leaf lookup (shared gate held) ────────────────────────── */
+
+/* Outer leaf for `key`, and the parent slot that points at it. */
+static mt_node_t *txn_find_leaf(const matryoshka_tree_t *tree, int32_t key,
+                                mt_node_t ***slot)
+{
+    mt_node_t **link = NULL;
+    mt_node_t *node = tree->root;
+    for (int i = 0; i < tree->height; i++) {
+        int idx = mt_inode_search(&node->inode, key);
+        link = &node->inode.children[idx];
+        node = mt_untag(__atomic_load_n(link, __ATOMIC_RELAXED));
+    }
+    if (slot) *slot = link;
+    return node;
+}
+
+static inline mt_lnode_t *sp_page_at(void *sp, int idx)
+{
+    return (mt_lnode_t *)((char *)sp + (size_t)idx * MT_PAGE_SIZE);
+}
+
+/* Membership of `key` in the outer leaf, read from copies taken under
+   stripe `s`.  Returns false in *ok if a writer got in the way. */
+static bool leaf_contains(const matryoshka_tree_t *tree, mt_node_t *leaf,
+                          int32_t key, struct mt_txn_domain *dom, uint32_t s,
+                          uint64_t v, bool *ok)
+{
+    _Alignas(MT_CL_SIZE) union {
+        mt_lnode_t    page;
+        mt_sp_inode_t inode;
+    } copy;
+
+    *ok = false;
+    mt_lnode_t *page = &leaf->lnode;
+    if (tree->hier.use_superpages) {
+        /* Each index read is validated before it is followed. */
+        mt_sp_header_t *hdr = (mt_sp_header_t *)leaf;
+        int idx = __atomic_load_n(&hdr->root_page, __ATOMIC_RELAXED);
+        int height = __atomic_load_n(&hdr->sub_height, __ATOMIC_RELAXED);
+        if (!stripe_read_valid(dom, s, v)) return false;
+        for (int i = 0; i < height; i++) {
+            memcpy(&copy.inode, sp_page_at(leaf, idx), MT_PAGE_SIZE);
+            if (!stripe_read_valid(dom, s, v)) return false;
+            idx = copy.inode.children[mt_sp_inode_search(&copy.inode, key)];
+        }
+        page = sp_page_at(leaf, idx);
+    }
+    memcpy(&copy.page, page, MT_PAGE_SIZE);
+    if (!stripe_read_valid(dom, s, v)) return false;
+    *ok = true;
+    return mt_page_contains(&copy.page, key);
+}
+
+/* ── Transaction API ───────────────────────────────────────── */
+
+matryoshka_txn_t *matryoshka_txn_begin(matryoshka_tree_t *tree)
+{
+    if (!tree) return NULL;
+    struct mt_txn_domain *dom = txn_domain(tree);
+    if (!dom) return NULL;
+    matryoshka_txn_t *txn = calloc(1, sizeof(*txn));
+    if (!txn) return NULL;
+    txn->tree = tree;
+    txn->dom = dom;
+    return txn;
+}
+
+void matryoshka_txn_abort(matryoshka_txn_t *txn)
+{
+    txn->nops = 0;
+    txn->nreads = 0;
+    txn->failed = false;
+}
+
+void matryoshka_txn_destroy(matryoshka_txn_t *txn)
+{
+    if (!txn) return;
+    free(txn->ops);
+    free(txn->reads);
+    free(txn);
+}
+
+static bool txn_push_op(matryoshka_txn_t *txn, int32_t key, bool insert)
+{
+    if (txn->nops == txn->cap_ops) {
+        size_t cap = txn->cap_ops ? txn->cap_ops * 2 : 16;
+        mt_txn_op_t *ops = realloc(txn->ops, cap * sizeof(*ops));
+        if (!ops) {
+            txn->failed = true;
+            return false;
+        }
+        txn->ops = ops;
+        txn->cap_ops = cap;
+    }
+    txn->ops[txn->nops] = (mt_txn_op_t){ key, insert, (uint32_t)txn->nops };
+    txn->nops++;
+    return true;
+}
+
+bool matryoshka_txn_insert(matryoshka_txn_t *txn, int32_t key)
+{
+    return txn_push_op(txn, key, true);
+}
+
+bool matryoshka_txn_delete(matryoshka_txn_t *txn, int32_t key)
+{
+    return txn_push_op(txn, key, false);
+}
+
+bool matryoshka_txn_contains(matryoshka_txn_t *txn, int32_t key)
+{
+    /* The transaction's own latest write to `key` decides. */
+    for (size_t i = txn->nops; i-- > 0; )
+        if (txn->ops[i].key == key)
+            return txn->ops[i].insert;
+
+    matryoshka_tree_t *tree = txn->tree;
+    struct mt_txn_domain *dom = txn->dom;
+    if (txn->nreads == txn->cap_reads) {
+        size_t cap = txn->cap_reads ? txn->cap_reads * 2 : 16;
+        mt_txn_read_t *r = realloc(txn->reads, cap * sizeof(*r));
+        if (!r) {
+            /* The answer could not be recorded for validation: fail
+               the commit rather than let it rest on an unchecked read. */
+            txn->failed = true;
+            return false;
+        }
+        txn->reads = r;
+        txn->cap_reads = cap;
+    }
+
+    gate_enter(dom);
+    if (txn->nreads == 0)
+        txn->smo = __atomic_load_n(&dom->smo, __ATOMIC_RELAXED);
+    mt_node_t *leaf = txn_find_leaf(tree, key, NULL);
+    uint32_t s = txn_stripe(leaf);
+    bool found, ok;
+    uint64_t v;
+    do {
+        v = stripe_read_begin(dom, s);
+        found = leaf_contains(tree, leaf, key, dom, s, v, &ok);
+    } while (!ok);
+    gate_exit(dom);
+
+    txn->reads[txn->nreads++] = (mt_txn_read_t){ s, v };
+    return found;
+}
+
+/* ── Commit ────────────────────────────────────────────────── */
+
+/* Writes to one outer leaf: ops[first .. first + n). */
+typedef struct {
+    mt_node_t  *leaf;
+    mt_node_t **link;       /* parent slot, NULL at the root */
+    uint32_t    stripe;
+    size_t      first, n;
+} mt_txn_group_t;
+
+static int cmp_op(const void *a, const void *b)
+{
+    const mt_txn_op_t *x = a, *y = b;
+    if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Keep only the last write to each key, in key order. */
+static void txn_collapse(matryoshka_txn_t *txn)
+{
+    qsort(txn->ops, txn->nops, sizeof(*txn->ops), cmp_op);
+    size_t m = 0;
+    for (size_t i = 0; i < txn->nops; i++) {
+        if (m > 0 && txn->ops[m - 1].key == txn->ops[i].key)
+            m--;
+        txn->ops[m++] = txn->ops[i];
+    }
+    txn->nops = m;
+}
+
+/* Read set unchanged?  `held` lists the stripes this commit latched. */
+static bool txn_validate(const matryoshka_txn_t *txn, const uint32_t *held,
+                         size_t nheld)
+{
+    struct mt_txn_domain *dom = txn->dom;
+    if (txn->nreads > 0 &&
+        __atomic_load_n(&dom->smo, __ATOMIC_RELAXED) != txn->smo)
+        return false;
+    for (size_t i = 0; i < txn->nreads; i++) {
+        const mt_txn_read_t *r = &txn->reads[i];
+        uint64_t v = __atomic_load_n(&dom->stripes[r->stripe].v,
+                                     __ATOMIC_ACQUIRE);
+        if (v == r->version)
+            continue;
+        if (v != (r->version | 1) ||
+            !bsearch(&r->stripe, held, nheld, sizeof(*held), cmp_u32))
+            return false;
+    }
+    return true;
+}
+
+/* Apply one page's writes to `stage`.  Returns the key count change,
+   or sets *smo if a write needs a split or merge. */
+static int stage_page(const matryoshka_tree_t *tree, mt_lnode_t *stage,
+                      const mt_txn_op_t *ops, size_t n, bool rebalance,
+                      bool *smo)
+{
+    int delta = 0;
+    for (size_t i = 0; i < n && !*smo; i++) {
+        mt_status_t st = ops[i].insert
+            ? mt_page_insert(stage, ops[i].key, &tree->hier)
+            : mt_page_delete(stage, ops[i].key, &tree->hier);
+        if (st == MT_OK)
+            delta += ops[i].insert ? 1 : -1;
+        else if (st == MT_PAGE_FULL || (st == MT_UNDERFLOW && rebalance))
+            *smo = true;
+        else if (st == MT_UNDERFLOW)
+            delta--;
+    }
+    return delta;
+}
+
+typedef struct {
+    mt_lnode_t *page;       /* destination */
+    mt_sp_header_t *sp;     /* its superpage, or NULL */
+    int delta;
+} mt_txn_stage_t;
+
+/* Shared-gate commit.  Returns 1 on success, 0 on conflict, -1 if a
+   write needs exclusive access (nothing was made visible). */
+static int txn_commit_shared(matryoshka_txn_t *txn)
+{
+    matryoshka_tree_t *tree = txn->tree;
+    struct mt_txn_domain *dom = txn->dom;
+    size_t nops = txn->nops;
+    bool sp = tree->hier.use_superpages;
+
+    mt_txn_group_t *groups = malloc(nops * sizeof(*groups));
+    uint32_t *held = malloc(nops * sizeof(*held));
+    if (!groups || !held) {
+        free(groups); free(held);
+        return -1;
+    }
+
+    gate_enter(dom);
+
+    /* Ops are in key order, so each leaf's writes are contiguous. */
+    size_t ng = 0;
+    for (size_t i = 0; i < nops; i++) {
+        mt_node_t **link;
+        mt_node_t *leaf = txn_find_leaf(tree, txn->ops[i].key, &link);
+        if (ng > 0 && groups[ng - 1].leaf == leaf) {
+            groups[ng - 1].n++;
+            continue;
+        }
+        groups[ng] = (mt_txn_group_t){ leaf, link, txn_stripe(leaf), i, 1 };
+        held[ng] = groups[ng].stripe;
+        ng++;
+    }
+
+    /* One staging page per page written: a page leaf per group, or up
+       to one per op for a superpage, never more than it has pages. */
+    size_t nstage = 0;
+    for (size_t g = 0; g < ng; g++) {
+        size_t most = sp ? MT_SP_SIZE / MT_PAGE_SIZE - 1 : 1;
+        nstage += groups[g].n < most ? groups[g].n : most;
+    }
+    mt_txn_stage_t *st = malloc(nstage * sizeof(*st));
+    mt_lnode_t *stage = aligned_alloc(MT_PAGE_SIZE, nstage * MT_PAGE_SIZE);
+    if (!st || !stage) {
+        gate_exit(dom);
+        free(groups); free(held); free(st); free(stage);
+        return -1;
+    }
+
+    /* Latch in stripe order; distinct leaves may share a stripe. */
+    qsort(held, ng, sizeof(*held), cmp_u32);
+    size_t nheld = 0;
+    for (size_t i = 0; i < ng; i++)
+        if (nheld == 0 || held[nheld - 1] != held[i])
+            held[nheld++] = held[i];
+    for (size_t i = 0; i < nheld; i++)
+        stripe_lock(dom, held[i]);
+
+    int result = txn_validate(txn, held, nheld) ? 1 : 0;
+
+    /* Stage every page before publishing any. */
+    size_t ns = 0;
+    bool smo = false;
+    for (size_t g = 0; g < ng && result && !smo; g++) {
+        const mt_txn_op_t *ops = txn->ops + groups[g].first;
+        size_t n = groups[g].n;
+        if (!sp) {
+            mt_lnode_t *s = &stage[ns];
+            memcpy(s, &groups[g].leaf->lnode, MT_PAGE_SIZE);
+            st[ns++] = (mt_txn_stage_t){
+                &groups[g].leaf->lnode, NULL,
+                stage_page(tree, s, ops, n, tree->height > 0, &smo) };
+            continue;
+        }
+
+        /* Superpage: one stage per page leaf written. */
+        mt_sp_header_t *hdr = (mt_sp_header_t *)groups[g].leaf;
+        int64_t keys = hdr->nkeys;
+        for (size_t i = 0; i < n && !smo; ) {
+            mt_lnode_t *page = mt_sp_find_leaf(hdr, ops[i].key);
+            size_t j = i + 1;
+            while (j < n && mt_sp_find_leaf(hdr, ops[j].key) == page)
+                j++;
+            mt_lnode_t *s = &stage[ns];
+            memcpy(s, page, MT_PAGE_SIZE);
+            st[ns] = (mt_txn_stage_t){
+                page, hdr,
+                stage_page(tree, s, ops + i, j - i, hdr->sub_height > 0,
+                           &smo) };
+            keys += st[ns++].delta;
+            i = j;
+        }
+        if (keys < tree->hier.min_sp_keys && tree->height > 0)
+            smo = true;
+    }
+    if (smo)
+        result = -1;
+
+    /* Publish: still latched, so readers see all pages or none. */
+    int64_t total = 0;
+    if (result == 1) {
+        for (size_t i = 0; i < ns; i++) {
+            memcpy(st[i].page, &stage[i], MT_PAGE_SIZE);
+            if (st[i].sp)
+                st[i].sp->nkeys += (uint32_t)st[i].delta;
+            total += st[i].delta;
+        }
+        for (size_t g = 0; g < ng && !sp; g++)
+            if (groups[g].link)
+                __atomic_store_n(groups[g].link,
+                                 mt_tag_leaf_ptr(groups[g].leaf),
+                                 __ATOMIC_RELAXED);
+        __atomic_fetch_add(&tree->n, (size_t)total, __ATOMIC_RELAXED);
+    }
+    for (size_t i = 0; i < nheld; i++)
+        stripe_unlock(dom, held[i], result == 1);
+    gate_exit(dom);
+
+    free(groups); free(held); free(st); free(stage);
+    return result;
+}
+
+/* Exclusive commit: nothing else runs, so the ordinary insert and
+   delete may split and merge. */
+static bool txn_commit_exclusive(matryoshka_txn_t *txn)
+{
+    struct mt_txn_domain *dom = txn->dom;
+    gate_enter_exclusive(dom);
+    bool ok = txn_validate(txn, NULL, 0);
+    if (ok) {
+        for (size_t i = 0; i < txn->nops; i++) {
+            if (txn->ops[i].insert)
+                matryoshka_insert(txn->tree, txn->ops[i].key);
+            else
+                matryoshka_delete(txn->tree, txn->ops[i].key);
+        }
+    }
+    gate_exit_exclusive(dom);
+    return ok;
+}
+
+bool matryoshka_txn_commit(matryoshka_txn_t *txn)
+{
+    bool ok = !txn->failed;             /* if not, apply nothing */
+    if (ok && txn->nops > 0) {
+        txn_collapse(txn);
+        int r = txn_commit_shared(txn);
+        ok = (r < 0) ? txn_commit_exclusive(txn) : (r == 1);
+    } else if (ok && txn->nreads > 0) {
+        gate_enter(txn->dom);
+        ok = txn_validate(txn, NULL, 0);
+        gate_exit(txn->dom);
+    }
+    matryoshka_txn_abort(txn);
+    return ok;
+}
@@ -6,6 +6,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include "matryoshka.h"
 #include "matryoshka_internal.h"
 
@@ -1113,6 +1119,1797 @@ static void test_eytz_large_insert_delete(void)
     PASS();
 }
 
+/* ── Page colouring ───────────────────────────────────────────── */
+
+static void test_color_insert_delete(void)
+{
+    TEST(color_insert_delete_20000);
+    mt_hierarchy_t h;
+    mt_hierarchy_init_default(&h);
+    h.color_pages = true;
+    matryoshka_tree_t *t = matryoshka_create_with(&h);
+
+    /* Pseudo-random order exercises CL splits, merges and page splits. */
+    uint32_t x = 12345;
+    for (int i = 0; i < 20000; i++) {
+        x = x * 1103515245u + 12345u;
+        matryoshka_insert(t, (int32_t)(x >> 8) % 100000);
+    }
+    for (int32_t k = 0; k < 100000; k += 3)
+        matryoshka_delete(t, k);
+
+    matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+    size_t count = 0;
+    int32_t key, prev = INT32_MIN;
+    while (matryoshka_iter_next(it, &key)) {
+        if (count > 0) ASSERT(key > prev, "not increasing");
+        ASSERT(key % 3 != 0, "deleted key present");
+        int32_t r;
+        ASSERT(matryoshka_search(t, key, &r) && r == key, "search miss");
+        ASSERT(matryoshka_search(t, key + 1, &r) && r >= key,
+               "predecessor too small");
+        prev = key; count++;
+    }
+    matryoshka_iter_destroy(it);
+    ASSERT(count == matryoshka_size(t), "iterator count != size");
+
+    matryoshka_destroy(t);
+    PASS();
+}
+
+static void test_color_layouts(void)
+{
+    TEST(color_fence_eytz_bulk_load);
+    int n = 50000;
+    int32_t *keys = malloc((size_t)n * sizeof(int32_t));
+    for (int i = 0; i < n; i++) keys[i] = i * 2;
+
+    for (int v = 0; v < 2; v++) {
+        mt_hierarchy_t h;
+        if (v == 0) mt_hierarchy_init_fence(&h);
+        else        mt_hierarchy_init_eytzinger(&h);
+        h.color_pages = true;
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, (size_t)n, &h);
+
+        /* Leaves must actually be spread over several colours. */
+        mt_inode_t *in = &t->root->inode;
+        while (t->height > 1 && in->children[0]->inode.type == MT_NODE_INTERNAL)
+            in = &in->children[0]->inode;
+        uint64_t seen = 0;
+        for (int c = 0; c <= in->nkeys; c++) {
+            mt_lnode_t *leaf = &mt_untag(in->children[c])->lnode;
+            seen |= 1ULL << (leaf->header.flags >> MT_PAGE_COLOR_SHIFT);
+        }
+        ASSERT(__builtin_popcountll(seen) > 1, "all leaves share a colour");
+
+        for (int i = 0; i < n; i++) {
+            int32_t r;
+            ASSERT(matryoshka_contains(t, keys[i]), "key missing");
+            ASSERT(matryoshka_search(t, keys[i] + 1, &r) && r == keys[i],
+                   "wrong predecessor");
+        }
+        for (int i = 0; i < n; i += 2)
+            ASSERT(matryoshka_delete(t, keys[i]), "delete failed");
+        for (int i = 0; i < n; i++)
+            ASSERT(matryoshka_contains(t, keys[i]) == (i % 2 == 1),
+                   "wrong membership after delete");
+        matryoshka_destroy(t);
+    }
+    free(keys);
+    PASS();
+}
+
+/* ── Separator compression ────────────────────────────────────── */
+
+static void test_compress_dense(void)
+{
+    TEST(compress_inodes_dense_then_wide);
+    mt_hierarchy_t h;
+    mt_hierarchy_init_default(&h);
+    h.compress_inodes = true;
+    matryoshka_tree_t *t = matryoshka_create_with(&h);
+
+    /* 60000 keys in a 16-bit span: the root must switch to 16-bit. */
+    uint32_t x = 777;
+    for (int i = 0; i < 60000; i++) {
+        x = x * 1103515245u + 12345u;
+        matryoshka_insert(t, 1000000 + (int32_t)((x >> 8) % 60000));
+    }
+    ASSERT(t->height >= 1, "tree too shallow");
+    ASSERT(t->root->inode.key16, "root not compressed");
+
+    for (int32_t k = 1000000; k < 1060000; k++) {
+        int32_t r;
+        if (matryoshka_contains(t, k))
+            ASSERT(matryoshka_search(t, k, &r) && r == k, "search miss");
+    }
+    int32_t r;
+    ASSERT(!matryoshka_search(t, 999999, &r), "found below min");
+    ASSERT(matryoshka_search(t, INT32_MAX, &r) && r < 1060000,
+           "max predecessor wrong");
+
+    /* Keys far outside the span force the root back to 32-bit. */
+    for (int32_t k = 0; k < 20000; k++)
+        matryoshka_insert(t, INT32_MIN + k * 7);
+    ASSERT(!t->root->inode.key16, "wide root still compressed");
+    for (int32_t k = 0; k < 20000; k++)
+        ASSERT(matryoshka_delete(t, INT32_MIN + k * 7), "delete wide failed");
+
+    size_t count = 0;
+    int32_t key, prev = INT32_MIN;
+    matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+    while (matryoshka_iter_next(it, &key)) {
+        if (count > 0) ASSERT(key > prev, "not increasing");
+        ASSERT(key >= 1000000 && key < 1060000, "stray key");
+        prev = key; count++;
+    }
+    matryoshka_iter_destroy(it);
+    ASSERT(count == matryoshka_size(t), "iterator count != size");
+
+    matryoshka_destroy(t);
+    PASS();
+}
+
+static void test_compress_mixed(void)
+{
+    TEST(compress_inodes_mixed_200000);
+    mt_hierarchy_t h;
+    mt_hierarchy_init_default(&h);
+    h.compress_inodes = true;
+    int n = 200000;
+    int32_t *keys = malloc((size_t)n * sizeof(int32_t));
+    for (int i = 0; i < n; i++) keys[i] = i;  /* dense, multi-level */
+    matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, (size_t)n, &h);
+
+    /* Interleave sparse keys so splits and merges cross both widths. */
+    for (int i = 0; i < 50000; i++)
+        matryoshka_insert(t, n + i * 40000);
+    for (int i = 0; i < n; i += 2)
+        ASSERT(matryoshka_delete(t, keys[i]), "delete failed");
+    for (int i = 0; i < 50000; i += 2)
+        ASSERT(matryoshka_delete(t, n + i * 40000), "delete sparse failed");
+
+    for (int i = 0; i < n; i++)
+        ASSERT(matryoshka_contains(t, keys[i]) == (i % 2 == 1),
+               "wrong membership");
+    for (int i = 0; i < 50000; i++) {
+        int32_t k = n + i * 40000, r;
+        ASSERT(matryoshka_contains(t, k) == (i % 2 == 1),
+               "wrong sparse membership");
+        ASSERT(matryoshka_search(t, k + 1, &r) &&
+               r == (i % 2 ? k : (i ? k - 40000 : n - 1)),
+               "wrong predecessor");
+    }
+    ASSERT(matryoshka_size(t) == (size_t)(n / 2 + 25000), "size mismatch");
+
+    matryoshka_destroy(t);
+    free(keys);
+    PASS();
+}
+
+/* ── Filtered scan ────────────────────────────────────────────── */
+
+static bool pred_ref(const matryoshka_pred_t *p, int32_t k)
+{
+    switch (p->kind) {
+    case MATRYOSHKA_PRED_ALL:  return true;
+    case MATRYOSHKA_PRED_MASK: return (k & p->mask) == p->value;
+    case MATRYOSHKA_PRED_MOD: {
+        int64_t r = (int64_t)k % p->modulus;
+        if (r < 0) r += p->modulus;
+        return r == (int64_t)p->remainder;
+    }
+    case MATRYOSHKA_PRED_RANGES:
+        for (size_t i = 0; i < p->nranges; i++)
+            if (k >= p->ranges[i].lo && k <= p->ranges[i].hi) return true;
+        return false;
+    case MATRYOSHKA_PRED_ZBOX: {
+        uint16_t x, y;
+        matryoshka_morton_xy(k, &x, &y);
+        return x >= p->zbox->xlo && x <= p->zbox->xhi &&
+               y >= p->zbox->ylo && y <= p->zbox->yhi;
+    }
+    }
+    return false;
+}
+
+static void test_scan_filtered(void)
+{
+    TEST(scan_filtered_vs_iterator);
+    static const matryoshka_range_t rs[] = {
+        { -90000, -80000 }, { -5, 5 }, { 1000, 1000 }, { 30000, 45000 },
+        { 99990, INT32_MAX }
+    };
+    /* Keys near zero are codes near 2^31: y's top bit flips there. */
+    static const matryoshka_zbox_t zb = { 0x0000, 0x7F00, 0x01FF, 0x80FF };
+    matryoshka_pred_t preds[] = {
+        { .kind = MATRYOSHKA_PRED_ALL },
+        { .kind = MATRYOSHKA_PRED_MASK, .mask = 0x0F0, .value = 0x030 },
+        { .kind = MATRYOSHKA_PRED_MOD, .modulus = 7, .remainder = 3 },
+        { .kind = MATRYOSHKA_PRED_MOD, .modulus = 24, .remainder = 0 },
+        { .kind = MATRYOSHKA_PRED_RANGES, .ranges = rs, .nranges = 5 },
+        { .kind = MATRYOSHKA_PRED_ZBOX, .zbox = &zb },
+    };
+    size_t cap = 300000;
+    int32_t *got = malloc(cap * sizeof(int32_t));
+
+    for (int v = 0; v < 3; v++) {
+        mt_hierarchy_t h;
+        if (v == 0)      mt_hierarchy_init_default(&h);
+        else if (v == 1) mt_hierarchy_init_eytzinger(&h);
+        else             mt_hierarchy_init_superpage(&h);
+        matryoshka_tree_t *t = matryoshka_create_with(&h);
+        uint32_t x = 99;
+        for (int i = 0; i < 80000; i++) {
+            x = x * 1103515245u + 12345u;
+            matryoshka_insert(t, (int32_t)(x >> 8) % 200000 - 100000);
+        }
+
+        for (size_t p = 0; p < sizeof(preds) / sizeof(preds[0]); p++) {
+            int32_t lo = (p & 1) ? -50000 : INT32_MIN;
+            int32_t hi = (p & 1) ? 60000 : INT32_MAX;
+            size_t n = matryoshka_scan_filtered(t, lo, hi, &preds[p],
+                                                got, cap);
+            size_t want = 0;
+            int32_t key;
+            matryoshka_iter_t *it = matryoshka_iter_from(t, lo);
+            while (matryoshka_iter_next(it, &key) && key <= hi) {
+                if (!pred_ref(&preds[p], key)) continue;
+                ASSERT(want < n && got[want] == key, "scan mismatch");
+                want++;
+            }
+            matryoshka_iter_destroy(it);
+            ASSERT(n == want, "scan count mismatch");
+        }
+
+        /* Truncation and resume from last + 1. */
+        size_t total = 0, n;
+        int32_t lo = INT32_MIN, prev = INT32_MIN;
+        while ((n = matryoshka_scan_filtered(t, lo, INT32_MAX, &preds[2],
+                                             got, 37)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                ASSERT(total == 0 || got[i] > prev, "resume not increasing");
+                prev = got[i];
+                total++;
+            }
+            if (n < 37 || prev == INT32_MAX) break;
+            lo = prev + 1;
+        }
+        ASSERT(total == matryoshka_scan_filtered(t, INT32_MIN, INT32_MAX,
+                                                  &preds[2], got, cap),
+               "resumed total mismatch");
+        matryoshka_destroy(t);
+    }
+    free(got);
+    PASS();
+}
+
+/* ── Gap search ───────────────────────────────────────────────── */
+
+static void test_first_absent(void)
+{
+    TEST(first_absent_vs_contains);
+    for (int v = 0; v < 3; v++) {
+        mt_hierarchy_t h;
+        if (v == 0)      mt_hierarchy_init_default(&h);
+        else if (v == 1) mt_hierarchy_init_eytzinger(&h);
+        else             mt_hierarchy_init_superpage(&h);
+        matryoshka_tree_t *t = matryoshka_create_with(&h);
+
+        /* Dense ids with sparse holes, plus a tail touching INT32_MAX. */
+        for (int32_t k = -1000; k < 150000; k++)
+            if (k % 4099 != 17 && k != 99999)
+                matryoshka_insert(t, k);
+        for (int32_t i = 40; i >= 0; i--)
+            matryoshka_insert(t, INT32_MAX - i);
+
+        int32_t r, want = 150000;
+        for (int32_t x = 150099; x >= -1100; x--) {
+            if (!matryoshka_contains(t, x)) want = x;
+            if (x % 7 == 0) {
+                ASSERT(matryoshka_first_absent(t, x, &r), "no gap found");
+                ASSERT(r == want, "wrong gap");
+            }
+        }
+        ASSERT(matryoshka_first_absent(t, INT32_MAX - 100, &r) &&
+               r == INT32_MAX - 100, "gap below tail");
+        ASSERT(!matryoshka_first_absent(t, INT32_MAX - 40, &r),
+               "tail reported a gap");
+
+        /* Allocate ids: each gap is returned once, then filled. */
+        int32_t next = -1000;
+        for (int i = 0; i < 38; i++) {
+            ASSERT(matryoshka_first_absent(t, next, &r), "alloc failed");
+            ASSERT(!matryoshka_contains(t, r), "allocated a present id");
+            matryoshka_insert(t, r);
+            next = r;
+        }
+        ASSERT(matryoshka_first_absent(t, -1000, &r) && r == 150000,
+               "holes not filled in order");
+        matryoshka_destroy(t);
+    }
+
+    matryoshka_tree_t *e = matryoshka_create();
+    int32_t r;
+    ASSERT(matryoshka_first_absent(e, 5, &r) && r == 5, "empty tree");
+    matryoshka_destroy(e);
+    PASS();
+}
+
+/* ── Range replace ────────────────────────────────────────────── */
+
+static void test_replace_range(void)
+{
+    TEST(replace_range_vs_reference);
+    enum { DOM = 400000 };
+    uint8_t *ref = calloc(DOM, 1);
+    int32_t *run = malloc(DOM * sizeof(int32_t));
+
+    for (int v = 0; v < 3; v++) {
+        mt_hierarchy_t h;
+        if (v == 0)      mt_hierarchy_init_default(&h);
+        else if (v == 1) mt_hierarchy_init_fence(&h);
+        else             mt_hierarchy_init_superpage(&h);
+        h.compress_inodes = (v == 0);
+        memset(ref, 0, DOM);
+        matryoshka_tree_t *t = matryoshka_create_with(&h);
+        uint32_t x = 4242;
+        for (int i = 0; i < 150000; i++) {
+            x = x * 1103515245u + 12345u;
+            int32_t k = (int32_t)((x >> 8) % DOM);
+            matryoshka_insert(t, k);
+            ref[k] = 1;
+        }
+
+        /* Widths from one page to several leaf parents; densities from
+           empty (pure range delete) to full (forces page splits). */
+        for (int r = 0; r < 40; r++) {
+            x = x * 1103515245u + 12345u;
+            int32_t lo = (int32_t)((x >> 8) % DOM);
+            x = x * 1103515245u + 12345u;
+            int32_t w = (int32_t)((x >> 8) % (r % 4 == 0 ? 300000 : 5000)) + 1;
+            int32_t hi = lo + w > DOM ? DOM : lo + w;
+            int step = 1 + r % 5 * (r % 3);
+            size_t n = 0;
+            for (int32_t k = lo + r % 2; k < hi && r % 7 != 3; k += step)
+                run[n++] = k;
+
+            ASSERT(matryoshka_replace_range(t, lo, hi, run, n),
+                   "replace rejected");
+            memset(ref + lo, 0, (size_t)(hi - lo));
+            for (size_t i = 0; i < n; i++) ref[run[i]] = 1;
+        }
+
+        size_t count = 0;
+        for (int32_t k = 0; k < DOM; k++) {
+            count += ref[k];
+            if (k % 3 == 0 || ref[k])
+                ASSERT(matryoshka_contains(t, k) == (bool)ref[k],
+                       "membership mismatch");
+        }
+        ASSERT(matryoshka_size(t) == count, "size mismatch");
+        matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+        int32_t key, prev = -1;
+        size_t seen = 0;
+        while (matryoshka_iter_next(it, &key)) {
+            ASSERT(key > prev && ref[key], "iteration mismatch");
+            prev = key;
+            seen++;
+        }
+        matryoshka_iter_destroy(it);
+        ASSERT(seen == count, "iteration count mismatch");
+
+        /* Unsorted or out-of-range runs are rejected untouched. */
+        int32_t bad[2] = { 10, 5 };
+        ASSERT(!matryoshka_replace_range(t, 0, 100, bad, 2), "unsorted ok");
+        ASSERT(!matryoshka_replace_range(t, 0, 8, bad, 1), "out of range ok");
+        ASSERT(matryoshka_size(t) == count, "rejected call changed tree");
+        matryoshka_destroy(t);
+    }
+    free(run);
+    free(ref);
+    PASS();
+}
+
+/* ── Access heatmap ───────────────────────────────────────────── */
+
+static void test_heatmap(void)
+{
+    TEST(heatmap_sampling);
+    int n = 100000;
+    int32_t *keys = malloc((size_t)n * sizeof(int32_t));
+    for (int i = 0; i < n; i++) keys[i] = i * 4;
+    matryoshka_tree_t *t = matryoshka_bulk_load(keys, (size_t)n);
+
+    /* Period 1 samples every operation, so bucket totals are exact. */
+    ASSERT(matryoshka_heatmap_enable(t, 1), "enable failed");
+    for (int i = 0; i < 30000; i++)
+        matryoshka_contains(t, 200000 + (i % 1000) * 4);   /* hot range */
+    for (int i = 0; i < 2000; i++)
+        matryoshka_contains(t, (i * 197) % (n * 4));
+    for (int i = 0; i < 500; i++)
+        matryoshka_insert(t, -1 - i);
+
+    uint64_t rd[MATRYOSHKA_HEAT_BUCKETS], wr[MATRYOSHKA_HEAT_BUCKETS];
+    matryoshka_heatmap_buckets(t, rd, wr);
+    uint64_t sr = 0, sw = 0;
+    for (int b = 0; b < MATRYOSHKA_HEAT_BUCKETS; b++) { sr += rd[b]; sw += wr[b]; }
+    ASSERT(sr == 32000 && sw == 500, "bucket totals wrong");
+    ASSERT(wr[127] == 500 && rd[128] == 32000, "wrong bucket");
+
+    size_t nl = matryoshka_heatmap_leaves(t, NULL, 0);
+    ASSERT(nl > 1, "expected several leaves");
+    matryoshka_heat_leaf_t *rows = malloc(nl * sizeof(*rows));
+    ASSERT(matryoshka_heatmap_leaves(t, rows, nl) == nl, "row count");
+    size_t hot = 0;
+    uint64_t lr = 0;
+    for (size_t i = 0; i < nl; i++) {
+        ASSERT(rows[i].lo <= rows[i].hi, "bad extent");
+        if (i > 0) ASSERT(rows[i].lo >= rows[i - 1].lo, "rows not ordered");
+        if (rows[i].reads > rows[hot].reads) hot = i;
+        lr += rows[i].reads;
+    }
+    ASSERT(lr <= sr, "leaf reads exceed samples");
+    ASSERT(rows[hot].hi >= 200000 && rows[hot].lo < 204000,
+           "hottest leaf outside hot range");
+    free(rows);
+
+    matryoshka_heatmap_reset(t);
+    matryoshka_heatmap_buckets(t, rd, wr);
+    ASSERT(rd[128] == 0 && wr[127] == 0, "reset left counts");
+
+    /* Coarse period: roughly 1 in 64 operations is sampled. */
+    ASSERT(matryoshka_heatmap_enable(t, 64), "re-enable failed");
+    for (int i = 0; i < 64000; i++)
+        matryoshka_contains(t, (i * 4) % (n * 4));
+    matryoshka_heatmap_buckets(t, rd, wr);
+    ASSERT(rd[128] > 700 && rd[128] < 1300, "sampling rate off");
+
+    ASSERT(matryoshka_heatmap_enable(t, 0), "disable failed");
+    ASSERT(matryoshka_heatmap_leaves(t, NULL, 0) == 0, "disabled export");
+    matryoshka_destroy(t);
+    free(keys);
+    PASS();
+}
+
+/* ── Statistics ───────────────────────────────────────────────── */
+
+static void test_stats(void)
+{
+    TEST(stats_shape_and_fill);
+    int n = 200000;
+    int32_t *keys = malloc((size_t)n * sizeof(int32_t));
+    for (int i = 0; i < n; i++) keys[i] = i * 2;
+    matryoshka_tree_t *t = matryoshka_bulk_load(keys, (size_t)n);
+
+    matryoshka_stats_t s;
+    matryoshka_stats(t, &s);
+    ASSERT(s.keys == (size_t)n, "key count");
+    ASSERT(s.height >= 1 && s.inodes >= 1, "expected internal nodes");
+    ASSERT(s.pages == s.leaves, "page tree: one page per leaf");
+    ASSERT(s.pages * 855 >= (size_t)n, "too few pages for the keys");
+    ASSERT(s.node_bytes == (s.inodes + s.leaves) * 4096, "node bytes");
+    uint64_t sum = 0, high = 0;
+    for (int b = 0; b < MATRYOSHKA_FILL_BUCKETS; b++) sum += s.fill[b];
+    for (int b = 5; b < MATRYOSHKA_FILL_BUCKETS; b++) high += s.fill[b];
+    ASSERT(sum == s.pages, "fill histogram total");
+    ASSERT(high * 10 >= s.pages * 9, "bulk-loaded pages should be full");
+
+    /* Thin to one key in four: fill must move to the low buckets. */
+    for (int i = 0; i < n; i++)
+        if (i % 4) matryoshka_delete(t, i * 2);
+    matryoshka_stats(t, &s);
+    ASSERT(s.keys == (size_t)n / 4, "key count after delete");
+    high = 0;
+    for (int b = 5; b < MATRYOSHKA_FILL_BUCKETS; b++) high += s.fill[b];
+    ASSERT(high * 2 < s.pages, "fill did not drop");
+    matryoshka_destroy(t);
+
+    /* Superpage leaves hold many pages each. */
+    mt_hierarchy_t h;
+    mt_hierarchy_init_fence_sp(&h);
+    t = matryoshka_bulk_load_with(keys, (size_t)n, &h);
+    matryoshka_stats(t, &s);
+    ASSERT(s.keys == (size_t)n && s.leaves >= 1, "sp shape");
+    ASSERT(s.pages > s.leaves, "sp pages not counted");
+    ASSERT(s.node_bytes >= s.leaves * (2u << 20), "sp node bytes");
+    matryoshka_destroy(t);
+
+    matryoshka_stats(NULL, &s);
+    ASSERT(s.keys == 0 && s.pages == 0, "NULL tree");
+    free(keys);
+    PASS();
+}
+
+/* ── Clear ────────────────────────────────────────────────────── */
+
+static void test_clear(void)
+{
+    TEST(clear_keep_and_release);
+    mt_hierarchy_t hs[2];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_fence_sp(&hs[1]);
+
+    for (int v = 0; v < 2; v++) {
+        matryoshka_tree_t *t = matryoshka_create_with(&hs[v]);
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < 300000; i++)
+                matryoshka_insert(t, (int32_t)(((int64_t)i * 7919) % 1000003));
+            ASSERT(matryoshka_size(t) == 300000, "size before clear");
+
+            matryoshka_stats_t before, after;
+            matryoshka_stats(t, &before);
+            ASSERT(matryoshka_clear(t, true), "clear failed");
+            matryoshka_stats(t, &after);
+            ASSERT(matryoshka_size(t) == 0 && after.height == 0, "not empty");
+            ASSERT(after.arena_bytes == before.arena_bytes, "arenas dropped");
+            ASSERT(!matryoshka_contains(t, 7919), "stale key visible");
+            int32_t r;
+            ASSERT(!matryoshka_search(t, 1000000, &r), "stale predecessor");
+        }
+
+        /* Reuse must not grow the arenas beyond the first round. */
+        matryoshka_stats_t kept;
+        for (int i = 0; i < 300000; i++)
+            matryoshka_insert(t, i * 3);
+        matryoshka_stats(t, &kept);
+        matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+        int32_t k, expect = 0;
+        size_t cnt = 0;
+        while (matryoshka_iter_next(it, &k)) {
+            if (k != expect) break;
+            expect += 3;
+            cnt++;
+        }
+        matryoshka_iter_destroy(it);
+        ASSERT(cnt == 300000, "reused tree contents wrong");
+
+        ASSERT(matryoshka_clear(t, false), "clear failed");
+        matryoshka_stats_t rel;
+        matryoshka_stats(t, &rel);
+        ASSERT(rel.arena_bytes < kept.arena_bytes, "arenas not released");
+        ASSERT(matryoshka_insert(t, 5) && matryoshka_contains(t, 5),
+               "insert after release");
+        ASSERT(matryoshka_size(t) == 1, "size after release");
+        matryoshka_destroy(t);
+    }
+    PASS();
+}
+
+/* ── Streaming bulk build ─────────────────────────────────────── */
+
+static void test_stream_build(void)
+{
+    TEST(stream_bulk_build);
+    mt_hierarchy_t hs[2];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_fence_sp(&hs[1]);
+
+    for (int v = 0; v < 2; v++) {
+        /* Just enough full leaves to cross the streaming threshold. */
+        int max_lkeys = hs[v].use_superpages ? hs[v].sp_max_keys
+                                             : hs[v].page_max_keys;
+        size_t n = (MT_STREAM_BUILD_BYTES / hs[v].leaf_alloc) *
+                   (size_t)max_lkeys;
+        int32_t *keys = malloc(n * sizeof(int32_t));
+        for (size_t i = 0; i < n; i++)
+            keys[i] = (int32_t)(i * 2);
+
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, n, &hs[v]);
+        ASSERT(t && matryoshka_size(t) == n, "size after streamed build");
+        for (size_t i = 0; i < n; i += 9973) {
+            int32_t r;
+            ASSERT(matryoshka_contains(t, keys[i]), "key missing");
+            ASSERT(matryoshka_search(t, keys[i] + 1, &r) && r == keys[i],
+                   "predecessor wrong");
+        }
+
+        /* The iterator follows the leaf links written by the build. */
+        matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+        int32_t k;
+        size_t cnt = 0;
+        while (matryoshka_iter_next(it, &k) && k == keys[cnt])
+            cnt++;
+        matryoshka_iter_destroy(it);
+        ASSERT(cnt == n, "iteration over streamed leaves");
+
+        ASSERT(matryoshka_insert(t, 1) && matryoshka_delete(t, 0),
+               "update after streamed build");
+        ASSERT(matryoshka_contains(t, 1) && !matryoshka_contains(t, 0),
+               "update not visible");
+        matryoshka_destroy(t);
+        free(keys);
+    }
+    PASS();
+}
+
+/* ── Explain ──────────────────────────────────────────────────── */
+
+static void test_explain(void)
+{
+    TEST(explain_matches_search);
+    mt_hierarchy_t hs[4];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_fence(&hs[1]);
+    mt_hierarchy_init_eytzinger(&hs[2]);
+    mt_hierarchy_init_fence_sp(&hs[3]);
+
+    size_t n = 300000;
+    int32_t *keys = malloc(n * sizeof(int32_t));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int32_t)(i * 3);
+
+    for (int v = 0; v < 4; v++) {
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, n, &hs[v]);
+        bool fence = false, eytz = false;
+        uint32_t seed = 12345;
+        for (int q = 0; q < 2000; q++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t key = (int32_t)(seed % (n * 3 + 100)) - 50;
+            int32_t want = 0;
+            bool found = matryoshka_search(t, key, &want);
+
+            matryoshka_explain_t r;
+            ASSERT(matryoshka_explain(t, key, &r) == found, "found differs");
+            ASSERT(r.found == found && (!found || r.result == want),
+                   "predecessor differs");
+            ASSERT(r.nsteps > t->height && r.lines > 0, "empty report");
+
+            int inodes = 0;
+            uint32_t lines = 0;
+            uint64_t cycles = 0;
+            for (int i = 0; i < r.nsteps; i++) {
+                inodes += r.steps[i].kind == MATRYOSHKA_STEP_INODE;
+                lines += r.steps[i].lines;
+                cycles += r.steps[i].cycles;
+            }
+            ASSERT(inodes == t->height, "one step per outer level");
+            ASSERT(lines == r.lines && cycles == r.cycles, "totals");
+            fence |= r.fence;
+            eytz |= r.eytz;
+        }
+        ASSERT(fence == (v == 1 || v == 3), "fence path not reported");
+        ASSERT(eytz == (v == 2), "eytzinger path not reported");
+
+        /* Drop the first key of the second leaf: its separator stays, so
+           the search lands on that leaf and falls back to header.prev. */
+        if (!hs[v].use_superpages && t->height > 0) {
+            const mt_node_t *nd = t->root;
+            for (int i = 1; i < t->height; i++)
+                nd = nd->inode.children[0];
+            int32_t sep = mt_inode_key(&nd->inode, 0);
+            matryoshka_delete(t, sep);
+            matryoshka_explain_t r;
+            ASSERT(matryoshka_explain(t, sep, &r) && r.result == sep - 3,
+                   "predecessor across leaves");
+            ASSERT(r.prev_leaf &&
+                   r.steps[r.nsteps - 1].kind == MATRYOSHKA_STEP_PREV_LEAF,
+                   "prev-leaf fallback not reported");
+        }
+        matryoshka_destroy(t);
+    }
+    free(keys);
+    PASS();
+}
+
+/* ── Multi-range scan ─────────────────────────────────────────── */
+
+static void test_scan_ranges(void)
+{
+    TEST(scan_ranges_match_reference);
+    enum { DOMAIN = 1 << 20, NR = 600 };
+    mt_hierarchy_t hs[3];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_fence_sp(&hs[2]);
+
+    char *present = malloc(DOMAIN);
+    matryoshka_range_t *rg = malloc(NR * sizeof(*rg));
+    size_t *ends = malloc(NR * sizeof(size_t));
+    size_t out_cap = 4u << 20;
+    int32_t *out = malloc(out_cap * sizeof(int32_t));
+    int32_t *want = malloc(out_cap * sizeof(int32_t));
+
+    for (int v = 0; v < 3; v++) {
+        /* Churned tree, so separators no longer match the keys. */
+        matryoshka_tree_t *t = matryoshka_create_with(&hs[v]);
+        memset(present, 0, DOMAIN);
+        uint32_t seed = 99 + (uint32_t)v;
+        for (int i = 0; i < 300000; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t k = (int32_t)((seed >> 4) % DOMAIN);
+            matryoshka_insert(t, k);
+            present[k] = 1;
+        }
+        for (int32_t k = 0; k < DOMAIN; k += 3) {
+            matryoshka_delete(t, k);
+            present[k] = 0;
+        }
+
+        /* Ascending small ranges, then shuffled, overlapping, empty
+           and wide ones. */
+        for (int i = 0; i < NR; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t lo, w = (int32_t)(seed >> 20) % 64;
+            if (i < NR / 2)
+                lo = i * (DOMAIN / (NR / 2)) + (int32_t)(seed % 97);
+            else
+                lo = (int32_t)((seed >> 3) % DOMAIN) - 100;
+            if (i % 50 == 7) w = 40000;
+            if (i % 61 == 3) w = -5;
+            rg[i].lo = lo;
+            rg[i].hi = lo + w;
+        }
+
+        size_t nw = 0;
+        for (int i = 0; i < NR; i++)
+            for (int64_t k = rg[i].lo; k <= rg[i].hi; k++)
+                if (k >= 0 && k < DOMAIN && present[k])
+                    want[nw++] = (int32_t)k;
+
+        size_t got = matryoshka_scan_ranges(t, rg, NR, out, out_cap, ends);
+        ASSERT(got == nw && ends[NR - 1] == nw, "key count");
+        ASSERT(memcmp(out, want, nw * sizeof(int32_t)) == 0, "keys differ");
+        for (int i = 0; i < NR; i++) {
+            size_t b = i ? ends[i - 1] : 0;
+            ASSERT(ends[i] >= b, "ends not monotone");
+            if (ends[i] > b)
+                ASSERT(out[b] >= rg[i].lo && out[ends[i] - 1] <= rg[i].hi,
+                       "key outside its range");
+        }
+
+        /* Truncation: the remaining ranges all end at cap. */
+        size_t cap = nw / 2;
+        got = matryoshka_scan_ranges(t, rg, NR, out, cap, ends);
+        ASSERT(got == cap && ends[NR - 1] == cap, "truncated count");
+        ASSERT(memcmp(out, want, cap * sizeof(int32_t)) == 0,
+               "truncated keys differ");
+        matryoshka_destroy(t);
+    }
+    free(present); free(rg); free(ends); free(out); free(want);
+    PASS();
+}
+
+/* ── Transactions ─────────────────────────────────────────────── */
+
+static void test_txn_basic(void)
+{
+    TEST(txn_basic);
+    matryoshka_tree_t *t = matryoshka_create();
+    for (int32_t k = 0; k < 20000; k += 2)
+        matryoshka_insert(t, k);
+
+    /* Move 10 -> 11, reading its own writes along the way. */
+    matryoshka_txn_t *a = matryoshka_txn_begin(t);
+    ASSERT(matryoshka_txn_contains(a, 10), "10 missing");
+    ASSERT(matryoshka_txn_delete(a, 10) && matryoshka_txn_insert(a, 11),
+           "buffer write");
+    ASSERT(!matryoshka_txn_contains(a, 10), "own delete not seen");
+    ASSERT(matryoshka_txn_contains(a, 11), "own insert not seen");
+    ASSERT(matryoshka_contains(t, 10) && !matryoshka_contains(t, 11),
+           "write visible before commit");
+    ASSERT(matryoshka_txn_commit(a), "commit failed");
+    ASSERT(!matryoshka_contains(t, 10) && matryoshka_contains(t, 11),
+           "commit not applied");
+    ASSERT(matryoshka_size(t) == 10000, "size changed");
+
+    /* A write to a leaf read by another transaction makes it abort. */
+    matryoshka_txn_t *b = matryoshka_txn_begin(t);
+    ASSERT(matryoshka_txn_contains(a, 100), "100 missing");
+    matryoshka_txn_insert(a, 20001);
+    matryoshka_txn_insert(b, 101);
+    ASSERT(matryoshka_txn_commit(b), "unrelated commit failed");
+    ASSERT(!matryoshka_txn_commit(a), "stale read committed");
+    ASSERT(!matryoshka_contains(t, 20001), "aborted write applied");
+
+    /* Aborted state is gone; enough inserts to force splits. */
+    for (int32_t k = 1; k < 20000; k += 2)
+        matryoshka_txn_insert(a, k);
+    ASSERT(matryoshka_txn_commit(a), "bulk commit failed");
+    ASSERT(matryoshka_size(t) == 19999, "bulk commit size");
+    for (int32_t k = 0; k < 20000; k++)
+        ASSERT(matryoshka_contains(t, k) == (k != 10), "bulk key wrong");
+
+    matryoshka_txn_destroy(a);
+    matryoshka_txn_destroy(b);
+    matryoshka_destroy(t);
+    PASS();
+}
+
+enum { TXN_DOMAIN = 1 << 16, TXN_KEYS = TXN_DOMAIN / 4 };
+
+typedef struct {
+    matryoshka_tree_t *tree;
+    uint32_t seed;
+    int moves, commits;
+} txn_worker_t;
+
+/* Random moves of a present key to an absent one. */
+static void *txn_worker(void *arg)
+{
+    txn_worker_t *w = arg;
+    matryoshka_txn_t *txn = matryoshka_txn_begin(w->tree);
+    for (int i = 0; i < w->moves; i++) {
+        w->seed = w->seed * 1103515245u + 12345u;
+        int32_t from = (int32_t)((w->seed >> 8) % TXN_DOMAIN);
+        w->seed = w->seed * 1103515245u + 12345u;
+        int32_t to = (int32_t)((w->seed >> 8) % TXN_DOMAIN);
+        if (!matryoshka_txn_contains(txn, from) ||
+            matryoshka_txn_contains(txn, to)) {
+            matryoshka_txn_abort(txn);
+            continue;
+        }
+        matryoshka_txn_delete(txn, from);
+        matryoshka_txn_insert(txn, to);
+        w->commits += matryoshka_txn_commit(txn);
+    }
+    matryoshka_txn_destroy(txn);
+    return NULL;
+}
+
+static void test_txn_concurrent(void)
+{
+    TEST(txn_concurrent_moves_preserve_size);
+    enum { NT = 4 };
+    mt_hierarchy_t hs[2];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_fence_sp(&hs[1]);
+
+    for (int v = 0; v < 2; v++) {
+        /* Dense bottom quarter, so moves shift keys upward and leaves
+           split and merge while the threads run. */
+        matryoshka_tree_t *t = matryoshka_create_with(&hs[v]);
+        for (int32_t k = 0; k < TXN_KEYS; k++)
+            matryoshka_insert(t, k);
+
+        pthread_t th[NT];
+        txn_worker_t w[NT];
+        for (int i = 0; i < NT; i++) {
+            w[i] = (txn_worker_t){ t, 7u + (uint32_t)(i * 31 + v), 20000, 0 };
+            pthread_create(&th[i], NULL, txn_worker, &w[i]);
+        }
+        int commits = 0;
+        for (int i = 0; i < NT; i++) {
+            pthread_join(th[i], NULL);
+            commits += w[i].commits;
+        }
+        ASSERT(commits > 0, "no move committed");
+        ASSERT(matryoshka_size(t) == TXN_KEYS, "size changed");
+        size_t n = 0;
+        for (int32_t k = 0; k < TXN_DOMAIN; k++)
+            n += matryoshka_contains(t, k);
+        ASSERT(n == TXN_KEYS, "contents disagree with size");
+        matryoshka_destroy(t);
+    }
+    PASS();
+}
+
+/* ── Pipelined lookup ─────────────────────────────────────────── */
+
+static void test_lookup_step(void)
+{
+    TEST(lookup_step_matches_search);
+    enum { NL = 8, NQ = 20000 };
+    mt_hierarchy_t hs[3];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_fence_sp(&hs[2]);
+
+    for (int v = 0; v < 3; v++) {
+        /* Churned, with emptied leaves, so the prev-leaf fallbacks run. */
+        matryoshka_tree_t *t = matryoshka_create_with(&hs[v]);
+        uint32_t seed = 5 + (uint32_t)v;
+        for (int i = 0; i < 100000; i++) {
+            seed = seed * 1103515245u + 12345u;
+            matryoshka_insert(t, (int32_t)((seed >> 4) % 4000000) + 1000);
+        }
+        for (int32_t k = 2000000; k < 2300000; k++)
+            matryoshka_delete(t, k);
+
+        /* NL lookups in flight, advanced round-robin. */
+        matryoshka_lookup_t lk[NL];
+        int32_t q = 0;
+        int issued = 0, checked = 0, steps = 0;
+        for (int i = 0; i < NL; i++) {
+            seed = seed * 1103515245u + 12345u;
+            matryoshka_lookup_start(t, (int32_t)(seed >> 9) % 4100000, &lk[i]);
+            issued++;
+        }
+        while (checked < NQ) {
+            for (int i = 0; i < NL; i++) {
+                matryoshka_prefetch(t, lk[i].key, i % 3 - 1);
+                steps++;
+                if (!matryoshka_lookup_step(&lk[i]))
+                    continue;
+                int32_t want;
+                bool f = matryoshka_search(t, lk[i].key, &want);
+                ASSERT(lk[i].found == f, "found differs");
+                ASSERT(!f || lk[i].result == want, "result differs");
+                checked++;
+                seed = seed * 1103515245u + 12345u;
+                q = (int32_t)(seed >> 9) % 4100000;
+                if (issued % 97 == 0) q = INT32_MIN;
+                matryoshka_lookup_start(t, q, &lk[i]);
+                issued++;
+            }
+        }
+        ASSERT(steps < NQ * 16, "too many steps");
+        matryoshka_destroy(t);
+    }
+
+    /* Empty tree: done at start. */
+    matryoshka_tree_t *t = matryoshka_create();
+    matryoshka_lookup_t lk;
+    matryoshka_lookup_start(t, 7, &lk);
+    ASSERT(lk.done && !lk.found && matryoshka_lookup_step(&lk), "empty");
+    matryoshka_prefetch(t, 7, -1);
+    matryoshka_destroy(t);
+    PASS();
+}
+
+/* ── Workspace ────────────────────────────────────────────────── */
+
+static int cmp_i32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void test_sort_keys(void)
+{
+    TEST(sort_keys_matches_qsort);
+    enum { N = 100000 };
+    int32_t *a = malloc(N * sizeof(int32_t));
+    int32_t *b = malloc(N * sizeof(int32_t));
+    uint32_t seed = 17;
+    size_t sizes[] = { 0, 1, 2, 31, 33, 257, 5000, N };
+    for (int v = 0; v < 3; v++) {
+        for (size_t si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++) {
+            size_t n = sizes[si];
+            for (size_t i = 0; i < n; i++) {
+                seed = seed * 1103515245u + 12345u;
+                /* Full range, few distinct values, shared high bytes. */
+                a[i] = v == 0 ? (int32_t)(seed ^ (seed << 13))
+                     : v == 1 ? (int32_t)(seed >> 28) - 8
+                              : (int32_t)(seed >> 16) - 30000;
+            }
+            memcpy(b, a, n * sizeof(int32_t));
+            mt_sort_keys(a, n);
+            qsort(b, n, sizeof(int32_t), cmp_i32);
+            ASSERT(memcmp(a, b, n * sizeof(int32_t)) == 0, "order differs");
+        }
+    }
+    free(a); free(b);
+    PASS();
+}
+
+static void test_workspace(void)
+{
+    TEST(workspace_splits_merges_batches);
+    enum { DOMAIN = 1 << 21, NB = 150000 };
+    mt_hierarchy_t hs[2];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_fence_sp(&hs[1]);
+
+    char *present = calloc(DOMAIN, 1);
+    int32_t *keys = malloc(NB * sizeof(int32_t));
+    int32_t *init = malloc((DOMAIN / 4) * sizeof(int32_t));
+    for (int v = 0; v < 2; v++) {
+        /* Every fourth key; batches then fill superpages until they
+           split and empty them until they merge.  Page leaves need far
+           fewer keys for the same. */
+        int32_t dom = v ? DOMAIN : DOMAIN / 8;
+        int nb = v ? NB : NB / 8;
+        memset(present, 0, DOMAIN);
+        size_t ni = 0;
+        for (int32_t k = 0; k < dom; k += 4) {
+            init[ni++] = k;
+            present[k] = 1;
+        }
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(init, ni, &hs[v]);
+        size_t size = matryoshka_workspace_size(t, NB);
+        ASSERT(size >= NB * sizeof(int32_t), "workspace too small");
+        int32_t *ws = malloc(size);
+        memset(ws, 0xA5, size);
+        matryoshka_set_workspace(t, ws, size);
+
+        uint32_t seed = 3 + (uint32_t)v;
+        for (int round = 0; round < 6; round++) {
+            bool ins = round < 3, inplace = round & 1;
+            size_t want = 0;
+            for (int i = 0; i < nb; i++) {
+                seed = seed * 1103515245u + 12345u;
+                int32_t k = (int32_t)((seed >> 4) % (uint32_t)dom);
+                if (ins && round == 0) k %= dom / 4;
+                keys[i] = k;
+            }
+            for (int i = 0; i < nb; i++)
+                if (present[keys[i]] != ins) {
+                    present[keys[i]] = ins;
+                    want++;
+                }
+            size_t got = ins
+                ? (inplace ? matryoshka_insert_batch_inplace(t, keys, nb)
+                           : matryoshka_insert_batch(t, keys, nb))
+                : (inplace ? matryoshka_delete_batch_inplace(t, keys, nb)
+                           : matryoshka_delete_batch(t, keys, nb));
+            ASSERT(got == want, "batch count");
+
+            if (inplace)
+                for (int i = 1; i < nb; i++)
+                    ASSERT(keys[i - 1] <= keys[i], "keys not left sorted");
+        }
+        for (int32_t k = dom / 2 + 1; k < dom; k += 4) {
+            if (present[k]) {
+                matryoshka_delete(t, k);
+                present[k] = 0;
+            }
+        }
+
+        size_t n = 0;
+        for (int32_t k = 0; k < dom; k++) {
+            ASSERT(matryoshka_contains(t, k) == present[k], "contents");
+            n += present[k];
+        }
+        ASSERT(matryoshka_size(t) == n, "size");
+        ASSERT(ws[ws[0] == (int32_t)0xA5A5A5A5 ? size / 4 - 1 : 0] !=
+               (int32_t)0xA5A5A5A5, "workspace unused");
+        matryoshka_set_workspace(t, NULL, 0);
+        matryoshka_insert_batch(t, keys, 1000);
+        matryoshka_destroy(t);
+        free(ws);
+    }
+    free(present); free(keys); free(init);
+    PASS();
+}
+
+static void test_batch_across_inodes(void)
+{
+    TEST(batch_last_child_upper_bound);
+    /* Height 2: a batch whose keys run past the last child of a
+       non-rightmost inode must re-descend, not stay in that leaf. */
+    enum { N = 1 << 21, NB = 4000 };
+    int32_t *init = malloc((N / 2) * sizeof(int32_t));
+    for (int32_t i = 0; i < N / 2; i++)
+        init[i] = 2 * i;
+    matryoshka_tree_t *t = matryoshka_bulk_load(init, N / 2);
+    ASSERT(t->height >= 2, "tree too shallow");
+
+    int32_t keys[NB];
+    uint32_t seed = 11;
+    for (int i = 0; i < NB; i++) {
+        seed = seed * 1103515245u + 12345u;
+        keys[i] = (int32_t)((seed >> 4) % N) | 1;
+    }
+    size_t want = 0;
+    int32_t sorted[NB];
+    memcpy(sorted, keys, sizeof(keys));
+    qsort(sorted, NB, sizeof(int32_t), cmp_i32);
+    for (int i = 0; i < NB; i++)
+        want += (i == 0 || sorted[i] != sorted[i - 1]);
+
+    ASSERT(matryoshka_insert_batch(t, keys, NB) == want, "insert count");
+    for (int i = 0; i < NB; i++)
+        ASSERT(matryoshka_contains(t, keys[i]), "inserted key missing");
+    ASSERT(matryoshka_size(t) == N / 2 + want, "size after insert");
+    ASSERT(matryoshka_delete_batch(t, keys, NB) == want, "delete count");
+    for (int i = 0; i < NB; i++)
+        ASSERT(!matryoshka_contains(t, keys[i]), "deleted key present");
+    ASSERT(matryoshka_size(t) == N / 2, "size after delete");
+    matryoshka_destroy(t);
+    free(init);
+    PASS();
+}
+
+/* ── Tight separators ─────────────────────────────────────────── */
+
+static void test_tight_separators(void)
+{
+    TEST(tight_separators_no_prev_leaf);
+    enum { NQ = 20000 };
+    mt_hierarchy_t hs[4];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_fence_sp(&hs[2]);
+    mt_hierarchy_init_default(&hs[3]);
+    for (int v = 0; v < 3; v++)
+        hs[v].tight_separators = true;
+
+    int32_t n = 600000;
+    int32_t *init = malloc((size_t)n * sizeof(int32_t));
+    char *present = malloc((size_t)2 * n + 2);
+    for (int v = 0; v < 4; v++) {
+        /* Even keys, then churn: a third deleted one by one or in
+           batches, odd keys inserted. */
+        int32_t m = hs[v].use_superpages ? n : n / 4;
+        memset(present, 0, (size_t)2 * m + 2);
+        for (int32_t i = 0; i < m; i++) {
+            init[i] = 2 * i;
+            present[2 * i] = 1;
+        }
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(init, (size_t)m,
+                                                         &hs[v]);
+        uint32_t seed = 21 + (uint32_t)v;
+        int32_t batch[256];
+        int nb = 0;
+        for (int i = 0; i < m / 3; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t k = (int32_t)((seed >> 4) % (uint32_t)(2 * m));
+            if (i % 4 == 3) {
+                matryoshka_insert(t, k | 1);
+                present[k | 1] = 1;
+            } else if (i % 2) {
+                matryoshka_delete(t, k);
+                present[k] = 0;
+            } else {
+                batch[nb++] = k & ~1;
+                present[k & ~1] = 0;
+                if (nb == 256) {
+                    matryoshka_delete_batch(t, batch, 256);
+                    nb = 0;
+                }
+            }
+        }
+        matryoshka_delete_batch(t, batch, (size_t)nb);
+
+        int32_t lo = 0;
+        while (!present[lo]) lo++;
+        int fallbacks = 0;
+        for (int q = 0; q < NQ; q++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t key = lo + (int32_t)((seed >> 4) % (uint32_t)(2 * m - lo));
+            int32_t want = key;
+            while (want >= 0 && !present[want]) want--;
+            matryoshka_explain_t ex;
+            bool f = matryoshka_explain(t, key, &ex);
+            ASSERT(f && ex.result == want, "wrong predecessor");
+            fallbacks += ex.prev_leaf;
+        }
+        if (v < 3)
+            ASSERT(fallbacks == 0, "search fell back to the previous leaf");
+        else
+            ASSERT(fallbacks > 0, "loose separators never fell back");
+        matryoshka_destroy(t);
+    }
+    free(init); free(present);
+    PASS();
+}
+
+/* ── Tree images ──────────────────────────────────────────────── */
+
+/* Write n keys to a new temporary file; returns its path in `path`. */
+static bool write_key_file(char *path, const int32_t *keys, size_t n)
+{
+    strcpy(path, "/tmp/matryoshka-test-XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    bool ok = write(fd, keys, n * sizeof(int32_t))
+              == (ssize_t)(n * sizeof(int32_t));
+    close(fd);
+    return ok;
+}
+
+static void test_build_image(void)
+{
+    TEST(build_image_roundtrip);
+    /* Eytzinger pages hold 240 keys, so N keys give a height-2 tree;
+       superpages hold ~436K, so the fence_sp image has three. */
+    enum { N = 1000000, NQ = 20000 };
+    int32_t *keys = malloc(N * sizeof(int32_t));
+    uint32_t seed = 5;
+    for (int i = 0; i < N; i++) {
+        seed = seed * 1103515245u + 12345u;
+        keys[i] = (int32_t)(seed ^ (seed >> 15));
+        if (i % 10 == 0)
+            keys[i] = keys[i / 2];                 /* duplicates */
+    }
+    int32_t *sorted = malloc(N * sizeof(int32_t));
+    memcpy(sorted, keys, N * sizeof(int32_t));
+    qsort(sorted, N, sizeof(int32_t), cmp_i32);
+    size_t nu = 0;
+    for (size_t i = 0; i < N; i++)
+        if (nu == 0 || sorted[i] != sorted[nu - 1])
+            sorted[nu++] = sorted[i];
+
+    char kpath[64], ipath[64];
+    ASSERT(write_key_file(kpath, keys, N), "write key file");
+    strcpy(ipath, "/tmp/matryoshka-test-XXXXXX");
+    int ifd = mkstemp(ipath);
+    ASSERT(ifd >= 0, "image path");
+    close(ifd);
+
+    mt_hierarchy_t hs[3];
+    mt_hierarchy_init_default(&hs[0]);
+    hs[0].compress_inodes = true;
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_fence_sp(&hs[2]);
+    /* Small runs and several threads, so the merge sees many runs. */
+    matryoshka_build_opts_t opts = { .mem_bytes = 1 << 20, .threads = 3 };
+
+    for (int h = 0; h < 3; h++) {
+        size_t n = 0;
+        ASSERT(matryoshka_build_image(kpath, ipath, &hs[h], &opts, &n),
+               "build failed");
+        ASSERT(n == nu, "build key count");
+        matryoshka_tree_t *t = matryoshka_image_load(ipath);
+        ASSERT(t != NULL, "load failed");
+        ASSERT(matryoshka_size(t) == nu, "loaded size");
+        ASSERT(h != 1 || t->height == 2, "eytzinger image height");
+
+        matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+        size_t cnt = 0;
+        int32_t k;
+        while (matryoshka_iter_next(it, &k) && cnt < nu && k == sorted[cnt])
+            cnt++;
+        matryoshka_iter_destroy(it);
+        ASSERT(cnt == nu, "iteration differs from sorted input");
+
+        for (int q = 0; q < NQ; q++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t x = (int32_t)seed;
+            size_t lo = 0, hi = nu;          /* first index > x */
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                if (sorted[mid] <= x) lo = mid + 1; else hi = mid;
+            }
+            int32_t r;
+            bool found = matryoshka_search(t, x, &r);
+            ASSERT(found == (lo > 0), "search found");
+            ASSERT(!found || r == sorted[lo - 1], "search result");
+        }
+
+        /* The loaded tree is an ordinary mutable tree. */
+        for (int i = 0; i < 2000; i++)
+            matryoshka_delete(t, sorted[i * 7]);
+        for (int i = 0; i < 2000; i++)
+            ASSERT(matryoshka_insert(t, sorted[i * 7]), "reinsert");
+        ASSERT(matryoshka_size(t) == nu, "size after churn");
+        matryoshka_destroy(t);
+    }
+
+    /* Empty input gives an empty tree; a partial key is rejected. */
+    ASSERT(truncate(kpath, 0) == 0, "truncate");
+    size_t n = 1;
+    ASSERT(matryoshka_build_image(kpath, ipath, &hs[2], &opts, &n), "empty");
+    matryoshka_tree_t *t = matryoshka_image_load(ipath);
+    ASSERT(t && n == 0 && matryoshka_size(t) == 0, "empty image");
+    ASSERT(matryoshka_insert(t, 9) && matryoshka_contains(t, 9),
+           "insert into empty image");
+    matryoshka_destroy(t);
+    ASSERT(truncate(kpath, 6) == 0, "truncate");
+    ASSERT(!matryoshka_build_image(kpath, ipath, &hs[0], &opts, NULL) &&
+           errno == EINVAL, "odd-sized key file accepted");
+    ASSERT(matryoshka_image_load(kpath) == NULL && errno == EINVAL,
+           "key file loaded as image");
+
+    unlink(kpath);
+    unlink(ipath);
+    free(sorted);
+    free(keys);
+    PASS();
+}
+
+static void test_image_attach(void)
+{
+    TEST(image_save_attach_publish);
+    enum { N = 600000, NQ = 20000 };
+    int32_t *keys = malloc(N * sizeof(int32_t));
+    for (int i = 0; i < N; i++)
+        keys[i] = 4 * i;
+
+    char dir[] = "/tmp/matryoshka-pub-XXXXXX";
+    ASSERT(mkdtemp(dir) != NULL, "mkdtemp");
+    char prefix[64], path[96];
+    snprintf(prefix, sizeof(prefix), "%s/idx", dir);
+    snprintf(path, sizeof(path), "%s/saved.img", dir);
+
+    mt_hierarchy_t hs[2];
+    mt_hierarchy_init_default(&hs[0]);
+    hs[0].compress_inodes = true;
+    mt_hierarchy_init_fence_sp(&hs[1]);
+    uint32_t seed = 9;
+    for (int h = 0; h < 2; h++) {
+        /* Churn first, so leaves are partly full and links irregular. */
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, N, &hs[h]);
+        for (int i = 0; i < 50000; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t k = (int32_t)((seed >> 2) % (4u * N));
+            if (k & 1) matryoshka_insert(t, k);
+            else matryoshka_delete(t, k);
+        }
+        ASSERT(matryoshka_image_save(t, path), "save");
+
+        matryoshka_tree_t *l = matryoshka_image_load(path);
+        matryoshka_stats_t a, b;
+        matryoshka_stats(t, &a);
+        matryoshka_stats(l, &b);
+        ASSERT(a.keys == b.keys && a.height == b.height &&
+               a.inodes == b.inodes && a.leaves == b.leaves &&
+               a.pages == b.pages && a.cl_slots == b.cl_slots,
+               "loaded tree differs in shape");
+        matryoshka_destroy(l);
+
+        matryoshka_image_t *img = matryoshka_image_attach(path);
+        ASSERT(img && matryoshka_image_size(img) == matryoshka_size(t),
+               "attach");
+        for (int q = 0; q < NQ; q++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t x = (int32_t)((seed >> 2) % (4u * N + 8)) - 4;
+            int32_t r1 = 0, r2 = 0;
+            bool f1 = matryoshka_search(t, x, &r1);
+            bool f2 = matryoshka_image_search(img, x, &r2);
+            ASSERT(f1 == f2 && r1 == r2, "image search differs");
+            ASSERT(matryoshka_contains(t, x) ==
+                   matryoshka_image_contains(img, x), "image contains");
+        }
+        matryoshka_image_detach(img);
+        matryoshka_destroy(t);
+    }
+    unlink(path);
+
+    /* Publication: a reader follows new versions, in this process and
+       in another one. */
+    ASSERT(matryoshka_reader_open(prefix) == NULL, "reader before publish");
+    /* A control file not yet sized by its writer, or not a control
+       page at all, is refused rather than mapped. */
+    snprintf(path, sizeof(path), "%s.ctl", prefix);
+    int cfd = open(path, O_RDWR | O_CREAT, 0644);
+    ASSERT(cfd >= 0, "create control file");
+    ASSERT(matryoshka_reader_open(prefix) == NULL && errno == EAGAIN,
+           "unsized control file accepted");
+    char junk[4096];
+    memset(junk, 'x', sizeof(junk));
+    ASSERT(write(cfd, junk, sizeof(junk)) == (ssize_t)sizeof(junk), "write");
+    close(cfd);
+    ASSERT(matryoshka_reader_open(prefix) == NULL && errno == EINVAL,
+           "foreign control file accepted");
+    unlink(path);
+    matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, 1000, &hs[0]);
+    ASSERT(matryoshka_publish(t, prefix), "publish 1");
+    matryoshka_reader_t *r = matryoshka_reader_open(prefix);
+    ASSERT(r != NULL, "reader open");
+    const matryoshka_image_t *img = matryoshka_reader_current(r);
+    ASSERT(img && matryoshka_reader_generation(r) == 1 &&
+           matryoshka_image_size(img) == 1000, "generation 1");
+    ASSERT(matryoshka_reader_current(r) == img, "unchanged version");
+
+    matryoshka_insert(t, 1);
+    ASSERT(matryoshka_publish(t, prefix), "publish 2");
+    snprintf(path, sizeof(path), "%s.1.img", prefix);
+    ASSERT(access(path, F_OK) != 0, "superseded image not unlinked");
+    img = matryoshka_reader_current(r);
+    ASSERT(matryoshka_reader_generation(r) == 2 &&
+           matryoshka_image_contains(img, 1), "generation 2");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        matryoshka_reader_t *cr = matryoshka_reader_open(prefix);
+        const matryoshka_image_t *ci = cr ? matryoshka_reader_current(cr)
+                                          : NULL;
+        int32_t res;
+        bool ok = ci && matryoshka_image_size(ci) == 1001 &&
+                  matryoshka_image_search(ci, 2, &res) && res == 1;
+        _exit(ok ? 0 : 1);
+    }
+    int status = -1;
+    ASSERT(pid > 0 && waitpid(pid, &status, 0) == pid, "fork");
+    ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+           "child process reader");
+
+    matryoshka_reader_close(r);
+    matryoshka_destroy(t);
+    snprintf(path, sizeof(path), "%s.2.img", prefix);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s.ctl", prefix);
+    unlink(path);
+    rmdir(dir);
+    free(keys);
+    PASS();
+}
+
+/* ── Online conversion ────────────────────────────────────────── */
+
+/* Whether the tree's contents are exactly the keys marked in present[]
+   (0..range), checked by iteration and by predecessor searches. */
+static bool convert_contents_ok(const matryoshka_tree_t *t,
+                                const char *present, int32_t range)
+{
+    matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+    int32_t key, want = -1;
+    size_t count = 0;
+    while (matryoshka_iter_next(it, &key)) {
+        do want++; while (want < range && !present[want]);
+        if (key != want) { matryoshka_iter_destroy(it); return false; }
+        count++;
+    }
+    matryoshka_iter_destroy(it);
+    if (count != matryoshka_size(t))
+        return false;
+    int32_t pred = -1;
+    for (int32_t k = 0; k < range; k += 37) {
+        for (int32_t j = k - 36 > 0 ? k - 36 : 0; j <= k; j++)
+            if (present[j]) pred = j;
+        int32_t r;
+        bool f = matryoshka_search(t, k, &r);
+        if (f != (pred >= 0) || (f && r != pred))
+            return false;
+    }
+    return true;
+}
+
+/* Number of pages (inside superpages too) not in `flags` layout. */
+static size_t convert_stale_pages(const matryoshka_tree_t *t, uint8_t flags)
+{
+    mt_node_t *node = t->root;
+    for (int i = 0; i < t->height; i++)
+        node = mt_untag(node->inode.children[0]);
+    mt_lnode_t *page = t->hier.use_superpages ? mt_sp_first_leaf(node)
+                                              : &node->lnode;
+    size_t stale = 0;
+    for (; page; page = page->header.next)
+        stale += (page->header.flags & MT_PAGE_LAYOUT_MASK) != flags;
+    return stale;
+}
+
+static void test_convert(void)
+{
+    TEST(convert_online);
+    mt_hierarchy_t hs[6];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_fence(&hs[2]);
+    hs[2].compress_inodes = true;
+    mt_hierarchy_init_default(&hs[3]);
+    hs[3].color_pages = true;
+    mt_hierarchy_init_superpage(&hs[4]);
+    mt_hierarchy_init_fence_sp(&hs[5]);
+    const uint8_t flags[6] = { 0, MT_PAGE_FLAG_EYTZ, MT_PAGE_FLAG_FENCE, 0,
+                               0, MT_PAGE_FLAG_FENCE };
+
+    int32_t n = 1000000;
+    int32_t *init = malloc((size_t)n * sizeof(int32_t));
+    char *present = malloc((size_t)2 * n);
+    for (int32_t i = 0; i < n; i++) {
+        init[i] = 2 * i;
+        present[2 * i] = 1;
+        present[2 * i + 1] = 0;
+    }
+
+    /* default -> eytzinger -> fence -> coloured default, then
+       superpage -> fence_sp, editing between steps. */
+    uint32_t seed = 122;
+    for (int first = 0; first < 6; first += 4) {
+        int last = (first == 0) ? 3 : 5;
+        int32_t m = (first == 0) ? n / 12 : n;
+        memset(present, 0, (size_t)2 * m);
+        for (int32_t i = 0; i < m; i++)
+            present[2 * i] = 1;
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(init, (size_t)m,
+                                                         &hs[first]);
+        for (int v = first + 1; v <= last; v++) {
+            ASSERT(matryoshka_convert(t, &hs[v]), "convert refused");
+            int steps = 0;
+            bool done = false;
+            while (!done) {
+                done = matryoshka_convert_step(t, 4);
+                int32_t batch[64];
+                for (int i = 0; i < 64; i++) {
+                    seed = seed * 1103515245u + 12345u;
+                    int32_t k = (int32_t)((seed >> 4) % (uint32_t)(2 * m));
+                    if (i < 64 / 3) {
+                        matryoshka_insert(t, k);
+                        present[k] = 1;
+                    } else if (i < 2 * 64 / 3) {
+                        matryoshka_delete(t, k);
+                        present[k] = 0;
+                    } else {
+                        batch[i - 2 * 64 / 3] = k;
+                    }
+                }
+                int nb = 64 - 2 * 64 / 3;
+                if (steps % 2) {
+                    matryoshka_insert_batch(t, batch, (size_t)nb);
+                    for (int i = 0; i < nb; i++) present[batch[i]] = 1;
+                } else {
+                    matryoshka_delete_batch(t, batch, (size_t)nb);
+                    for (int i = 0; i < nb; i++) present[batch[i]] = 0;
+                }
+                if (++steps % 64 == 0)
+                    ASSERT(convert_contents_ok(t, present, 2 * m),
+                           "contents wrong mid-conversion");
+            }
+            ASSERT(convert_stale_pages(t, flags[v]) == 0,
+                   "pages left in the old layout");
+            ASSERT(convert_contents_ok(t, present, 2 * m),
+                   "contents wrong after conversion");
+        }
+        matryoshka_destroy(t);
+    }
+
+    /* Page and superpage leaves cannot share a tree. */
+    matryoshka_tree_t *t = matryoshka_create_with(&hs[0]);
+    ASSERT(!matryoshka_convert(t, &hs[5]), "page -> superpage accepted");
+    ASSERT(matryoshka_convert_step(t, 1), "refused conversion under way");
+    matryoshka_destroy(t);
+    free(init); free(present);
+    PASS();
+}
+
+/* ── Runahead ─────────────────────────────────────────────────── */
+
+static void test_runahead(void)
+{
+    TEST(runahead_helper);
+    enum { NQ = 200000 };
+    int32_t *qs = malloc(NQ * sizeof(int32_t));
+    mt_hierarchy_t hs[2];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_superpage(&hs[1]);
+    int32_t n = 600000;
+    int32_t *keys = malloc((size_t)n * sizeof(int32_t));
+    for (int32_t i = 0; i < n; i++)
+        keys[i] = 3 * i;
+    uint32_t seed = 123;
+    for (int q = 0; q < NQ; q++) {
+        seed = seed * 1103515245u + 12345u;
+        qs[q] = (int32_t)((seed >> 4) % (uint32_t)(3 * n + 5)) - 2;
+    }
+
+    for (int v = 0; v < 2; v++) {
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, (size_t)n,
+                                                         &hs[v]);
+        /* CPU 0 always exists; whether it is a sibling does not matter
+           for the answers. */
+        matryoshka_runahead_t *r =
+            matryoshka_runahead_start(t, qs, NQ, v ? 64 : 0, 0);
+        ASSERT(r, "helper did not start");
+        for (int q = 0; q < NQ; q++) {
+            if (q % 8 == 0)
+                matryoshka_runahead_advance(r, (size_t)q);
+            int32_t res;
+            bool f = matryoshka_search(t, qs[q], &res);
+            int32_t want = qs[q] < 0 ? -1 : qs[q] / 3 * 3;
+            ASSERT(f == (want >= 0) && (!f || res == want),
+                   "wrong predecessor with helper");
+        }
+        matryoshka_runahead_advance(r, NQ);
+        ASSERT(matryoshka_runahead_stop(r) <= NQ, "helper walked too far");
+        matryoshka_destroy(t);
+    }
+
+    /* Stopped early, and on a CPU that may have no sibling. */
+    matryoshka_tree_t *t = matryoshka_create();
+    matryoshka_runahead_t *r = matryoshka_runahead_start(t, qs, NQ, 0, -1);
+    ASSERT(r || errno == ENODEV, "no sibling should give ENODEV");
+    matryoshka_runahead_stop(r);
+    matryoshka_destroy(t);
+    free(keys); free(qs);
+    PASS();
+}
+
+/* ── Portable export ──────────────────────────────────────────── */
+
+/* The tree holds exactly the keys of `want`, in order. */
+static bool export_same(const matryoshka_tree_t *t, const int32_t *want,
+                        size_t n)
+{
+    if (matryoshka_size(t) != n)
+        return false;
+    matryoshka_iter_t *it = matryoshka_iter_from(t, INT32_MIN);
+    size_t cnt = 0;
+    int32_t k;
+    while (matryoshka_iter_next(it, &k) && cnt < n && k == want[cnt])
+        cnt++;
+    matryoshka_iter_destroy(it);
+    return cnt == n;
+}
+
+static void test_export(void)
+{
+    TEST(export_import_roundtrip);
+    enum { N = 400000 };
+    mt_hierarchy_t hs[4];
+    mt_hierarchy_init_default(&hs[0]);
+    hs[0].compress_inodes = true;
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_fence_sp(&hs[2]);
+    mt_hierarchy_init_fence(&hs[3]);
+    hs[3].color_pages = true;
+
+    /* Keys about three apart around zero, then churned, so pages are
+       partly full and the differences need a few bits each. */
+    int32_t *keys = malloc(N * sizeof(int32_t));
+    char *present = calloc(4 * N, 1);
+    for (int i = 0; i < N; i++)
+        keys[i] = 3 * i - 2 * N;
+    char path[64];
+    strcpy(path, "/tmp/matryoshka-test-XXXXXX");
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0, "export path");
+    close(fd);
+
+    uint32_t seed = 124;
+    for (int h = 0; h < 3; h++) {
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(keys, N, &hs[h]);
+        memset(present, 0, 4 * N);
+        for (int i = 0; i < N; i++)
+            present[3 * i] = 1;
+        for (int i = 0; i < N / 4; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int32_t k = (int32_t)((seed >> 4) % (4u * N));
+            if (i % 2) {
+                matryoshka_insert(t, k - 2 * N);
+                present[k] = 1;
+            } else {
+                matryoshka_delete(t, k - 2 * N);
+                present[k] = 0;
+            }
+        }
+        int32_t *want = malloc(4 * N * sizeof(int32_t));
+        size_t nw = 0;
+        for (int32_t k = 0; k < 4 * N; k++)
+            if (present[k])
+                want[nw++] = k - 2 * N;
+
+        ASSERT(matryoshka_export(t, path), "export failed");
+        struct stat st;
+        ASSERT(stat(path, &st) == 0 && (size_t)st.st_size < nw,
+               "export not under a byte per key");
+        matryoshka_destroy(t);
+
+        /* Back into its own layout, and into each of the others. */
+        for (int into = -1; into < 4; into++) {
+            t = matryoshka_import(path, into < 0 ? NULL : &hs[into],
+                                  into == 0 ? 1 : 0);
+            ASSERT(t != NULL, "import failed");
+            ASSERT(export_same(t, want, nw), "imported keys differ");
+            ASSERT(into >= 0 || t->hier.cl_strategy == hs[h].cl_strategy,
+                   "exporting hierarchy not restored");
+            for (int i = 0; i < 1000; i++) {
+                matryoshka_delete(t, want[i * 7]);
+                ASSERT(matryoshka_insert(t, want[i * 7]), "reinsert");
+            }
+            ASSERT(matryoshka_size(t) == nw, "size after churn");
+            matryoshka_destroy(t);
+        }
+
+        /* Several threads decoding neighbouring blocks into the one
+           array a superpage import loads from. */
+        for (int r = 0; r < 8; r++) {
+            t = matryoshka_import(path, &hs[2], 8);
+            ASSERT(t && export_same(t, want, nw),
+                   "threaded superpage import differs");
+            matryoshka_destroy(t);
+        }
+        free(want);
+    }
+
+    /* An empty tree round-trips; a damaged or foreign file does not. */
+    matryoshka_tree_t *t = matryoshka_create();
+    ASSERT(matryoshka_export(t, path), "empty export");
+    matryoshka_destroy(t);
+    t = matryoshka_import(path, &hs[1], 0);
+    ASSERT(t && matryoshka_size(t) == 0, "empty import");
+    ASSERT(matryoshka_insert(t, 5) && matryoshka_contains(t, 5),
+           "insert into empty import");
+    matryoshka_destroy(t);
+
+    t = matryoshka_bulk_load_with(keys, N, &hs[0]);
+    ASSERT(matryoshka_export(t, path), "export failed");
+    matryoshka_destroy(t);
+    fd = open(path, O_WRONLY);
+    uint8_t bad = 33;                    /* first block's first width */
+    ASSERT(pwrite(fd, &bad, 1, sizeof(mt_export_header_t) + 8) == 1,
+           "corrupt");
+    close(fd);
+    ASSERT(matryoshka_import(path, NULL, 0) == NULL && errno == EINVAL,
+           "bad width accepted");
+    ASSERT(truncate(path, 40) == 0, "truncate");
+    ASSERT(matryoshka_import(path, NULL, 0) == NULL && errno == EINVAL,
+           "truncated export accepted");
+    unlink(path);
+    free(keys); free(present);
+    PASS();
+}
+
+/* ── Z-order scan ─────────────────────────────────────────────── */
+
+static void test_scan_zbox(void)
+{
+    TEST(scan_zbox_vs_reference);
+    ASSERT(matryoshka_morton_key(0, 0) == INT32_MIN &&
+           matryoshka_morton_key(0xFFFF, 0xFFFF) == INT32_MAX &&
+           matryoshka_morton_key(1, 0) == INT32_MIN + 1 &&
+           matryoshka_morton_key(0, 1) == INT32_MIN + 2, "morton layout");
+    uint32_t seed = 125;
+    for (int i = 0; i < 1000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint16_t x = (uint16_t)seed, y = (uint16_t)(seed >> 16), px, py;
+        matryoshka_morton_xy(matryoshka_morton_key(x, y), &px, &py);
+        ASSERT(px == x && py == y, "morton round trip");
+    }
+
+    /* Points clustered in a 2048 x 2048 square across the y = 2^15
+       line, where key signs change, plus a sparse scatter elsewhere. */
+    enum { NP = 300000, NQ = 150 };
+    int32_t *all = malloc(NP * sizeof(int32_t));
+    int32_t *out = malloc(NP * sizeof(int32_t));
+    int32_t *want = malloc(NP * sizeof(int32_t));
+    for (int i = 0; i < NP; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint16_t x = (uint16_t)seed, y = (uint16_t)(seed >> 16);
+        if (i % 8) {
+            x = 20000 + x % 2048;
+            y = 31744 + y % 2048;
+        }
+        all[i] = matryoshka_morton_key(x, y);
+    }
+    qsort(all, NP, sizeof(int32_t), cmp_i32);
+    size_t nu = 0;
+    for (size_t i = 0; i < NP; i++)
+        if (nu == 0 || all[i] != all[nu - 1])
+            all[nu++] = all[i];
+    uint16_t *xs = malloc(nu * sizeof(uint16_t));
+    uint16_t *ys = malloc(nu * sizeof(uint16_t));
+    for (size_t i = 0; i < nu; i++)
+        matryoshka_morton_xy(all[i], &xs[i], &ys[i]);
+
+    mt_hierarchy_t hs[3];
+    mt_hierarchy_init_default(&hs[0]);
+    mt_hierarchy_init_eytzinger(&hs[1]);
+    mt_hierarchy_init_superpage(&hs[2]);
+    for (int h = 0; h < 3; h++) {
+        matryoshka_tree_t *t = matryoshka_bulk_load_with(all, nu, &hs[h]);
+        for (int q = 0; q < NQ; q++) {
+            seed = seed * 1103515245u + 12345u;
+            uint32_t r2 = seed * 2654435761u;
+            matryoshka_zbox_t b;
+            if (q % 3) {                   /* inside the cluster */
+                b.xlo = 20000 + seed % 2048;
+                b.ylo = 31744 + (seed >> 11) % 2048;
+                b.xhi = b.xlo + r2 % 600;
+                b.yhi = b.ylo + (r2 >> 16) % 600;
+            } else {                       /* anywhere, any size */
+                b.xlo = (uint16_t)seed;
+                b.ylo = (uint16_t)r2;
+                b.xhi = b.xlo + (uint16_t)((seed >> 16) % (65536u - b.xlo));
+                b.yhi = b.ylo + (uint16_t)((r2 >> 16) % (65536u - b.ylo));
+            }
+            size_t nw = 0;
+            for (size_t i = 0; i < nu; i++)
+                if (xs[i] >= b.xlo && xs[i] <= b.xhi &&
+                    ys[i] >= b.ylo && ys[i] <= b.yhi)
+                    want[nw++] = all[i];
+            size_t got = matryoshka_scan_zbox(t, &b, INT32_MIN, out, NP);
+            ASSERT(got == nw, "zbox count mismatch");
+            ASSERT(memcmp(out, want, nw * sizeof(int32_t)) == 0,
+                   "zbox keys mismatch");
+
+            /* Truncated and resumed from last + 1. */
+            size_t total = 0, n;
+            int32_t from = INT32_MIN;
+            while ((n = matryoshka_scan_zbox(t, &b, from, out, 29)) > 0) {
+                ASSERT(total + n <= nw && memcmp(out, want + total,
+                       n * sizeof(int32_t)) == 0, "resumed zbox mismatch");
+                total += n;
+                if (n < 29 || out[n - 1] == INT32_MAX) break;
+                from = out[n - 1] + 1;
+            }
+            ASSERT(total == nw, "resumed zbox total");
+        }
+        matryoshka_destroy(t);
+    }
+
+    matryoshka_zbox_t empty = { 5, 5, 4, 9 };
+    matryoshka_tree_t *t = matryoshka_bulk_load(all, nu);
+    ASSERT(matryoshka_scan_zbox(t, &empty, INT32_MIN, out, NP) == 0,
+           "inverted box matched");
+    matryoshka_destroy(t);
+    free(all); free(out); free(want); free(xs); free(ys);
+    PASS();
+}
+
 /* ── Main ─────────────────────────────────────────────────────── */
 
 int main(void)
@@ -1172,6 +2969,32 @@ int main(void)
     test_eytz_predecessor();
     test_eytz_iterator();
     test_eytz_large_insert_delete();
+    test_color_insert_delete();
+    test_color_layouts();
+    test_compress_dense();
+    test_compress_mixed();
+    test_scan_filtered();
+    test_first_absent();
+    test_replace_range();
+    test_heatmap();
+    test_stats();
+    test_clear();
+    test_stream_build();
+    test_explain();
+    test_scan_ranges();
+    test_txn_basic();
+    test_txn_concurrent();
+    test_lookup_step();
+    test_sort_keys();
+    test_workspace();
+    test_batch_across_inodes();
+    test_tight_separators();
+    test_build_image();
+    test_image_attach();
+    test_convert();
+    test_runahead();
+    test_export();
+    test_scan_zbox();
 
     printf("\n  %d/%d tests passed.\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;